@@ -0,0 +1,172 @@
+/*
+ * arena.h — arene memoire par execution, avec statistiques par etape
+ * C ANSI C89, en-tete seul (fonctions static), partage par plasma.c,
+ * geo.c et iso.c.
+ *
+ * Un seul bloc est alloue au debut du pipeline, a la taille calculee par
+ * l'outil ; toutes les grilles y sont decoupees (allocation par pointeur
+ * montant, blocs alignes sur 64 octets, une ligne de cache). Les tampons
+ * temporaires d'une etape sont rendus par arena_release, ce qui permet a
+ * l'etape suivante de reutiliser la meme memoire : pas de malloc/free
+ * repetes, pas de fragmentation, et une empreinte maximale connue a
+ * l'avance. Un bloc d'au moins 2 Mio est aligne sur 2 Mio et, sous Linux,
+ * marque madvise(MADV_HUGEPAGE) : pages enormes transparentes, beaucoup
+ * moins de defauts de TLB sur les grandes grilles.
+ *
+ * Premier contact (first_touch) : le noyau place une page sur le noeud NUMA
+ * du thread qui l'ecrit en premier. arena_alloc_rows fait alors ecrire
+ * chaque bande de lignes par le thread qui la traitera ensuite (meme
+ * decoupage en bandes, tn_rows de tune.h, que les boucles de lignes). Seule
+ * la partie du bloc jamais touchee est preparee ; une zone reutilisee par
+ * une etape suivante garde son placement.
+ *
+ * arena_stage ouvre une etape nommee ; arena_report affiche pour chacune
+ * la memoire vivante a l'entree, le pic et la memoire vivante a la sortie
+ * (--mem-stats).
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "trace.h"
+#include "tune.h"
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#define ARENA_ALIGN  ((size_t)64)
+#define ARENA_HUGE   ((size_t)2 << 20)
+#define ARENA_STAGES 16
+
+/* iso.c n'utilise pas les portees temporaires : pas d'avertissement */
+#if defined(__GNUC__)
+#define ARENA_FN static __attribute__((unused))
+#else
+#define ARENA_FN static
+#endif
+
+typedef struct {
+    const char *name;
+    size_t start, peak, end;   /* octets vivants : entree, maximum, sortie */
+} ArenaStage;
+
+typedef struct {
+    void *block;               /* bloc rendu par malloc */
+    unsigned char *base;       /* debut aligne */
+    size_t cap, top, peak, align;
+    size_t touched;            /* octets deja ecrits par arena_alloc_rows */
+    int first_touch;           /* 1 : pages preparees par bandes de threads */
+    int nstages;
+    ArenaStage stages[ARENA_STAGES];
+} Arena;
+
+/* Octets reserves dans l'arene pour un bloc de n octets */
+ARENA_FN size_t arena_size(size_t n) {
+    if (n > (size_t)-1 - (ARENA_ALIGN - 1)) return (size_t)-1;
+    return (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+/* Reserve cap octets. Retourne 0 si OK, -1 si allocation impossible. */
+ARENA_FN int arena_init(Arena *a, size_t cap) {
+    size_t off;
+    a->cap = arena_size(cap);
+    a->align = (a->cap >= ARENA_HUGE) ? ARENA_HUGE : ARENA_ALIGN;
+    a->top = a->peak = a->touched = 0;
+    a->first_touch = 0;
+    a->nstages = 0;
+    a->base = 0;
+    a->block = (a->cap <= (size_t)-1 - a->align) ? malloc(a->cap + a->align) : 0;
+    if (!a->block) return -1;
+    off = (size_t)a->block & (a->align - 1);
+    a->base = (unsigned char*)a->block + (off ? a->align - off : 0);
+#if defined(MADV_HUGEPAGE)
+    if (a->align == ARENA_HUGE) madvise(a->base, a->cap, MADV_HUGEPAGE);
+#endif
+    return 0;
+}
+
+ARENA_FN void arena_free(Arena *a) {
+    free(a->block);
+    a->block = 0;
+    a->base = 0;
+    a->cap = a->top = 0;
+}
+
+/* Bloc de n octets aligne sur 64, 0 si l'arene est pleine */
+ARENA_FN void *arena_alloc(Arena *a, size_t n) {
+    size_t sz = arena_size(n);
+    void *p;
+    if (sz > a->cap - a->top) return 0;
+    p = a->base + a->top;
+    a->top += sz;
+    if (a->top > a->peak) a->peak = a->top;
+    if (a->nstages > 0 && a->top > a->stages[a->nstages - 1].peak) {
+        a->stages[a->nstages - 1].peak = a->top;
+    }
+    return p;
+}
+
+/* Grille de rows lignes de rowbytes octets, traitee par bandes de lignes.
+   Avec first_touch, chaque thread ecrit d'abord ses propres lignes. */
+ARENA_FN void *arena_alloc_rows(Arena *a, size_t rows, size_t rowbytes) {
+    size_t start = a->top;
+    unsigned char *p = (unsigned char*)arena_alloc(a, rows * rowbytes);
+    if (!p || !a->first_touch || a->top <= a->touched) return p;
+    {
+        size_t from = (a->touched > start) ? (a->touched - start) / rowbytes : 0;
+        long y, nr = (long)rows;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            double t0 = tr_begin();
+            long first = -1, count = 0;
+#ifdef _OPENMP
+#pragma omp for schedule(static, tn_rows(nr)) nowait
+#endif
+            for (y = 0; y < nr; ++y) {
+                if ((size_t)y >= from) memset(p + (size_t)y * rowbytes, 0, rowbytes);
+                if (count++ == 0) first = y;
+            }
+            tr_end("band", "touch", t0, first, count);
+        }
+    }
+    a->touched = a->top;
+    return p;
+}
+
+/* Portee de tampons temporaires : mark = arena_mark(), ..., arena_release */
+ARENA_FN size_t arena_mark(const Arena *a) { return a->top; }
+ARENA_FN void arena_release(Arena *a, size_t mark) { if (mark < a->top) a->top = mark; }
+
+/* Ferme l'etape courante et ouvre l'etape name */
+ARENA_FN void arena_stage(Arena *a, const char *name) {
+    ArenaStage *s;
+    if (a->nstages > 0) a->stages[a->nstages - 1].end = a->top;
+    if (a->nstages >= ARENA_STAGES) return;
+    s = &a->stages[a->nstages++];
+    s->name = name;
+    s->start = s->peak = s->end = a->top;
+}
+
+ARENA_FN double arena_mib(size_t n) { return (double)n / (double)((size_t)1 << 20); }
+
+/* Rapport --mem-stats sur f */
+ARENA_FN void arena_report(Arena *a, FILE *f) {
+    int i;
+    if (a->nstages > 0) a->stages[a->nstages - 1].end = a->top;
+    fprintf(f, "memoire : arene %.1f Mio (alignee %lu o), pic %.1f Mio\n",
+            arena_mib(a->cap), (unsigned long)a->align, arena_mib(a->peak));
+    fprintf(f, "  %-18s %12s %12s %12s\n", "etape", "entree Mio", "pic Mio", "sortie Mio");
+    for (i = 0; i < a->nstages; ++i) {
+        const ArenaStage *s = &a->stages[i];
+        fprintf(f, "  %-18s %12.1f %12.1f %12.1f\n", s->name,
+                arena_mib(s->start), arena_mib(s->peak), arena_mib(s->end));
+    }
+}
+
+#endif /* ARENA_H */
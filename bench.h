@@ -0,0 +1,248 @@
+/*
+ * bench.h — microbenchmarks des noyaux (--bench), resultats en JSON
+ * C ANSI C89, en-tete seul (fonctions static), partage par plasma.c,
+ * geo.c, iso.c et fractale.c ; bench.sh compile et lance les quatre.
+ *
+ * Chaque outil declare ses noyaux (une fonction + un contexte) et les
+ * mesure pour chaque cote de grille S (cellules S*S) : BENCH.warmup
+ * executions ignorees, puis BENCH.reps executions chronometrees (temps
+ * mur, comme --timings). Une ligne JSON par noyau et par taille : mediane,
+ * 95e centile et minimum en ms, debits en cellules/s et Mo/s. L'en-tete
+ * note la variante de noyaux (isa.h) : comparer --force-isa avx2 et scalar.
+ *
+ *   --bench[=k1,k2]    mode benchmark, tous les noyaux ou seulement k1,k2
+ *   --bench-sizes L    cotes S, liste (defaut 256,1024,4096 ; jusqu'a 16384)
+ *   --bench-reps N     repetitions mesurees (defaut 5)
+ *   --bench-warmup N   executions de chauffe (defaut 1)
+ *   --bench-baseline F resultats de reference (sortie JSON d'un --bench
+ *                      ou de bench.sh) : chaque mesure recoit baseline_ms
+ *                      et ratio, et une mediane plus lente que la reference
+ *                      de plus de --bench-tolerance PCT % (defaut 10) est
+ *                      marquee "regression" ; code de sortie 1 dans ce cas
+ *
+ * Une taille qui depasse le budget memoire (--max-mem ou memoire physique)
+ * est notee "skipped" au lieu d'etre mesuree. Les sorties texte et PPM
+ * vont vers BENCH_NULL : on mesure le formatage et l'ecriture, pas le
+ * disque.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timing.h"
+#include "isa.h"
+
+#define BENCH_SIZES 8
+
+#if defined(_WIN32)
+#define BENCH_NULL "NUL"
+#else
+#define BENCH_NULL "/dev/null"
+#endif
+
+#if defined(__GNUC__)
+#define BENCH_FN static __attribute__((unused))
+#else
+#define BENCH_FN static
+#endif
+
+typedef void (*BenchFn)(void *ctx);
+
+typedef struct {
+    int on;
+    const char *only;          /* noyaux retenus, liste "a,b", 0 = tous */
+    int warmup, reps;
+    int nsizes;
+    int sizes[BENCH_SIZES];
+    int count;                 /* resultats deja ecrits */
+    const char *tool;
+    const char *baseline;      /* --bench-baseline, 0 = aucune */
+    double tolerance;          /* en % */
+    int regressions;
+} Bench;
+
+static Bench BENCH = { 0, 0, 1, 5, 3, { 256, 1024, 4096 }, 0, 0, 0, 10.0, 0 };
+
+/* Entier lo..hi occupant toute la chaine s */
+BENCH_FN int bench_int(const char *s, long lo, long hi, int *out) {
+    char *e = 0;
+    long v = strtol(s, &e, 10);
+    if (*s == '\0' || *e != '\0' || v < lo || v > hi) return -1;
+    *out = (int)v;
+    return 0;
+}
+
+/* Reconnait les options --bench* a argv[*i] et avance *i.
+   Retourne 1 si l'option est prise, -1 si sa valeur est invalide, 0 sinon. */
+BENCH_FN int bench_parse(int argc, char **argv, int *i) {
+    const char *a = argv[*i];
+    const char *v = (*i + 1 < argc) ? argv[*i + 1] : 0;
+    if (strcmp(a, "--bench") == 0) { BENCH.on = 1; *i += 1; return 1; }
+    if (strncmp(a, "--bench=", 8) == 0) {
+        if (a[8] == '\0') return -1;
+        BENCH.on = 1; BENCH.only = a + 8; *i += 1; return 1;
+    }
+    if (strcmp(a, "--bench-reps") == 0 && v) {
+        if (bench_int(v, 1, 100000, &BENCH.reps) != 0) return -1;
+        *i += 2; return 1;
+    }
+    if (strcmp(a, "--bench-warmup") == 0 && v) {
+        if (bench_int(v, 0, 100000, &BENCH.warmup) != 0) return -1;
+        *i += 2; return 1;
+    }
+    if (strcmp(a, "--bench-baseline") == 0 && v) {
+        BENCH.baseline = v;
+        *i += 2; return 1;
+    }
+    if (strcmp(a, "--bench-tolerance") == 0 && v) {
+        char *e = 0;
+        BENCH.tolerance = strtod(v, &e);
+        if (*e != '\0' || !(BENCH.tolerance >= 0.0)) return -1;
+        *i += 2; return 1;
+    }
+    if (strcmp(a, "--bench-sizes") == 0 && v) {
+        char buf[16];
+        const char *p = v;
+        BENCH.nsizes = 0;
+        while (*p) {
+            size_t n = strcspn(p, ",");
+            if (n == 0 || n >= sizeof(buf) || BENCH.nsizes >= BENCH_SIZES) return -1;
+            memcpy(buf, p, n);
+            buf[n] = '\0';
+            if (bench_int(buf, 2, 65536, &BENCH.sizes[BENCH.nsizes]) != 0) return -1;
+            BENCH.nsizes++;
+            p += n;
+            if (*p == ',') p++;
+        }
+        if (BENCH.nsizes == 0) return -1;
+        *i += 2; return 1;
+    }
+    return 0;
+}
+
+/* 1 si le noyau name fait partie de la selection */
+BENCH_FN int bench_want(const char *name) {
+    const char *p = BENCH.only;
+    size_t n = strlen(name);
+    if (!p) return 1;
+    while (*p) {
+        size_t k = strcspn(p, ",");
+        if (k == n && strncmp(p, name, n) == 0) return 1;
+        p += k;
+        if (*p == ',') p++;
+    }
+    return 0;
+}
+
+BENCH_FN int bench_threads(void) {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+/* Mediane de reference (ms) de tool / name / side dans BENCH.baseline,
+   0 si absente. Lecture ligne a ligne du format ecrit par bench_run. */
+BENCH_FN double bench_baseline(const char *tool, const char *name, int side) {
+    FILE *f;
+    char line[512], cur[64], kern[64];
+    double ms = 0.0;
+    if (!BENCH.baseline) return 0.0;
+    f = fopen(BENCH.baseline, "r");
+    if (!f) return 0.0;
+    cur[0] = '\0';
+    while (fgets(line, sizeof(line), f)) {
+        const char *p = strstr(line, "\"tool\":\"");
+        int sz;
+        double m;
+        if (p && sscanf(p, "\"tool\":\"%63[^\"]", cur) != 1) cur[0] = '\0';
+        p = strstr(line, "{\"kernel\":\"");
+        if (!p || strcmp(cur, tool) != 0) continue;
+        if (sscanf(p, "{\"kernel\":\"%63[^\"]\",\"size\":%d", kern, &sz) != 2) continue;
+        p = strstr(p, "\"median_ms\":");
+        if (p && sscanf(p, "\"median_ms\":%lf", &m) == 1 && sz == side && strcmp(kern, name) == 0) {
+            ms = m;
+            break;
+        }
+    }
+    fclose(f);
+    return ms;
+}
+
+/* En-tete de l'objet JSON de l'outil */
+BENCH_FN void bench_begin(const char *tool, const char *precision) {
+    if (BENCH.baseline) {
+        FILE *f = fopen(BENCH.baseline, "r");
+        if (!f) fprintf(stderr, "bench : reference '%s' illisible, ignoree.\n", BENCH.baseline);
+        else fclose(f);
+    }
+    BENCH.tool = tool;
+    printf("{\"tool\":\"%s\",\"precision\":\"%s\",\"isa\":\"%s\",\"threads\":%d,\"warmup\":%d,\"reps\":%d,\"results\":[",
+           tool, precision, isa_name(), bench_threads(), BENCH.warmup, BENCH.reps);
+    BENCH.count = 0;
+}
+
+/* Ferme l'objet JSON ; retourne le code de sortie (1 si regression) */
+BENCH_FN int bench_end(void) {
+    printf("\n]}\n");
+    fflush(stdout);
+    return BENCH.regressions ? 1 : 0;
+}
+
+/* Taille S non mesuree (reason : "memoire", ...) */
+BENCH_FN void bench_skip(int side, const char *reason) {
+    printf("%s\n{\"size\":%d,\"skipped\":\"%s\"}", BENCH.count++ ? "," : "", side, reason);
+    fflush(stdout);
+}
+
+/* Mesure fn(ctx) : cells cellules et bytes octets traites par execution */
+BENCH_FN void bench_run(const char *name, int side, double cells, double bytes,
+                        BenchFn fn, void *ctx) {
+    double *t, med, p95, base;
+    int r, j;
+    if (!bench_want(name)) return;
+    t = (double*)malloc((size_t)BENCH.reps * sizeof(double));
+    if (!t) { bench_skip(side, "memoire"); return; }
+    for (r = 0; r < BENCH.warmup; ++r) fn(ctx);
+    for (r = 0; r < BENCH.reps; ++r) {
+        double t0 = tr_begin();
+        double w = tm_wall();
+        fn(ctx);
+        t[r] = tm_wall() - w;
+        tr_end("stage", name, t0, (long)r, (long)side);
+    }
+    /* tri par insertion : peu de mesures */
+    for (r = 1; r < BENCH.reps; ++r) {
+        double v = t[r];
+        for (j = r; j > 0 && t[j - 1] > v; --j) t[j] = t[j - 1];
+        t[j] = v;
+    }
+    r = BENCH.reps;
+    med = (r % 2) ? t[r / 2] : 0.5 * (t[r / 2 - 1] + t[r / 2]);
+    j = (95 * r + 99) / 100 - 1;
+    p95 = t[j];
+    printf("%s\n{\"kernel\":\"%s\",\"size\":%d,\"cells\":%.0f,\"median_ms\":%.4f,\"p95_ms\":%.4f,"
+           "\"min_ms\":%.4f,\"mcells_per_s\":%.2f,\"mb_per_s\":%.1f",
+           BENCH.count++ ? "," : "", name, side, cells, 1e3 * med, 1e3 * p95, 1e3 * t[0],
+           tm_rate(cells, med) / 1e6, tm_rate(bytes / 1048576.0, med));
+    base = bench_baseline(BENCH.tool, name, side);
+    if (base > 0.0) {
+        double ratio = 1e3 * med / base;
+        int slow = ratio > 1.0 + BENCH.tolerance / 100.0;
+        printf(",\"baseline_ms\":%.4f,\"ratio\":%.3f%s", base, ratio, slow ? ",\"regression\":true" : "");
+        if (slow) {
+            fprintf(stderr, "bench : regression %s %s S=%d : %.3f ms, reference %.3f ms (+%.0f %%)\n",
+                    BENCH.tool, name, side, 1e3 * med, base, 100.0 * (ratio - 1.0));
+            BENCH.regressions++;
+        }
+    }
+    printf("}");
+    fflush(stdout);
+    free(t);
+}
+
+#endif /* BENCH_H */
@@ -0,0 +1,46 @@
+#!/bin/sh
+# bench.sh — compile plasma, geo, iso et fractale puis lance leurs
+# microbenchmarks (--bench, voir bench.h). Un seul document JSON sur stdout,
+# avec le commit et les options de compilation, pour comparer deux commits.
+#
+# Usage :
+#   ./bench.sh [options --bench*, transmises aux quatre outils] > bench.json
+#   ./bench.sh --bench-sizes 256,1024,4096,16384 --bench-reps 9
+#   ./bench.sh --bench=box_blur,flood --bench-warmup 2
+#   ./bench.sh --force-isa scalar > scalar.json   (noyaux non vectorises)
+#   ./bench.sh --bench-baseline avant.json --bench-tolerance 5 > apres.json
+#     (code de sortie 1 et "regression":true si une mediane se degrade)
+#   CC=clang CFLAGS="-std=c89 -O3 -fopenmp" ./bench.sh
+#
+# Les binaires vont dans $BENCH_DIR (defaut bench-build/). Pour une autre
+# precision ou d'autres parametres, lancer l'outil seul (plasma --bench
+# --precision f32 ...).
+
+set -e
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-std=c89 -O2 -fopenmp"}
+BENCH_DIR=${BENCH_DIR:-bench-build}
+SRC=$(cd "$(dirname "$0")" && pwd)
+
+mkdir -p "$BENCH_DIR"
+for t in plasma geo iso fractale; do
+    $CC $CFLAGS "$SRC/$t.c" -o "$BENCH_DIR/$t" -lm
+done
+
+commit=$(cd "$SRC" && git rev-parse --short HEAD 2>/dev/null || echo inconnu)
+if [ -n "$(cd "$SRC" && git status --porcelain -- '*.c' '*.h' 2>/dev/null)" ]; then
+    commit="$commit+modifie"
+fi
+
+printf '{"commit":"%s","date":"%s","cc":"%s","cflags":"%s","tools":[\n' \
+    "$commit" "$(date -u +%Y-%m-%dT%H:%M:%SZ)" "$CC" "$CFLAGS"
+sep=""
+status=0
+for t in plasma geo iso fractale; do
+    printf '%s' "$sep"
+    "$BENCH_DIR/$t" --bench "$@" || status=1
+    sep=","
+done
+printf ']}\n'
+exit $status
@@ -0,0 +1,112 @@
+/*
+ * checksum.h — empreintes CRC-32 des resultats (--checksum[=Q])
+ * C ANSI C89, en-tete seul (fonctions static), partage par plasma.c,
+ * geo.c, iso.c et fractale.c.
+ *
+ * Chaque outil calcule au fil de l'eau le CRC-32 (polynome de zlib) de ses
+ * resultats et l'ecrit sur stderr, une ligne par resultat :
+ *   checksum <outil> <resultat> crc32=xxxxxxxx n=<valeurs> q=<Q>
+ * Les octets (image, masque d'eau, compteurs) entrent tels quels. Une
+ * hauteur v entre sous la forme de l'entier floor(v*Q + 0.5), 4 octets
+ * petit-boutiens : Q = 1e6 par defaut, la resolution de la sortie texte
+ * (%.6f). Un Q plus petit tolere les ecarts d'arrondi des chemins f32 / u16
+ * ou vectorises (sauf valeur tombant juste sur une limite d'arrondi).
+ *
+ * Meme empreinte entre -j 1 et -j N, ou entre deux commits, pour les memes
+ * options : sortie identique a la resolution Q. test.sh compare ces lignes
+ * aux empreintes de reference de tests/golden/.
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CK_DEFAULT_Q 1e6
+
+#if defined(__GNUC__)
+#define CK_FN static __attribute__((unused))
+#else
+#define CK_FN static
+#endif
+
+typedef struct {
+    unsigned long crc;
+    double n;                  /* valeurs ou octets comptes */
+} Crc;
+
+static unsigned long ck_table[256];
+
+CK_FN void ck_init(Crc *c) {
+    if (!ck_table[1]) {
+        unsigned long k, r;
+        int b;
+        for (k = 0; k < 256; ++k) {
+            r = k;
+            for (b = 0; b < 8; ++b) r = (r & 1UL) ? 0xEDB88320UL ^ (r >> 1) : r >> 1;
+            ck_table[k] = r;
+        }
+    }
+    c->crc = 0xFFFFFFFFUL;
+    c->n = 0.0;
+}
+
+CK_FN void ck_raw(Crc *c, const unsigned char *b, size_t len) {
+    unsigned long r = c->crc;
+    size_t i;
+    for (i = 0; i < len; ++i) r = ck_table[(r ^ b[i]) & 0xFFUL] ^ (r >> 8);
+    c->crc = r & 0xFFFFFFFFUL;
+}
+
+/* len octets ; n compte les octets */
+CK_FN void ck_bytes(Crc *c, const void *p, size_t len) {
+    ck_raw(c, (const unsigned char*)p, len);
+    c->n += (double)len;
+}
+
+/* Entier 32 bits (complement a deux), petit-boutien */
+CK_FN void ck_u32(Crc *c, unsigned long v) {
+    unsigned char b[4];
+    b[0] = (unsigned char)(v & 0xFFUL);
+    b[1] = (unsigned char)((v >> 8) & 0xFFUL);
+    b[2] = (unsigned char)((v >> 16) & 0xFFUL);
+    b[3] = (unsigned char)((v >> 24) & 0xFFUL);
+    ck_raw(c, b, 4);
+    c->n += 1.0;
+}
+
+/* Valeur v quantifiee a la resolution 1/q (floor sans libm : iso s'en passe) */
+CK_FN void ck_quant(Crc *c, double v, double q) {
+    double k = v * q + 0.5;
+    long s;
+    if (k >= 2147483647.0) s = 2147483647L;
+    else if (k <= -2147483647.0) s = -2147483647L;
+    else {
+        s = (long)k;
+        if ((double)s > k) s--;
+    }
+    ck_u32(c, (unsigned long)s);
+}
+
+/* Reconnait --checksum et --checksum=Q (Q > 0). Retourne 1 si arg est
+   l'option (*q renseigne), -1 si Q est invalide, 0 sinon. */
+CK_FN int ck_parse(const char *arg, double *q) {
+    char *e = 0;
+    double v;
+    if (strncmp(arg, "--checksum", 10) != 0) return 0;
+    if (arg[10] == '\0') { *q = CK_DEFAULT_Q; return 1; }
+    if (arg[10] != '=') return 0;
+    v = strtod(arg + 11, &e);
+    if (arg[11] == '\0' || *e != '\0' || !(v > 0.0)) return -1;
+    *q = v;
+    return 1;
+}
+
+CK_FN void ck_report(const char *tool, const char *what, const Crc *c, double q) {
+    fprintf(stderr, "checksum %s %s crc32=%08lx n=%.0f q=%g\n",
+            tool, what, (c->crc ^ 0xFFFFFFFFUL) & 0xFFFFFFFFUL, c->n, q);
+}
+
+#endif /* CHECKSUM_H */
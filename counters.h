@@ -0,0 +1,157 @@
+/*
+ * counters.h — compteurs materiels par etape (--counters), Linux
+ * C ANSI C89, en-tete seul (fonctions static), utilise par timing.h.
+ *
+ * Chaque thread de l'equipe OpenMP ouvre son groupe perf_event_open
+ * (meneur : cycles ; membres : instructions, defauts de cache, erreurs de
+ * prediction de branchement, defauts de TLB donnees, defauts de page),
+ * en espace utilisateur seulement (exclude_kernel, accepte avec
+ * perf_event_paranoid <= 2). Le thread principal lit tous les groupes en
+ * debut et fin d'etape : tm_end cumule les differences, tm_report les
+ * affiche a cote des temps. Un compteur multiplexe est extrapole
+ * (valeur * temps actif / temps compte).
+ *
+ * Hors Linux, ou si le noyau refuse (machine virtuelle sans PMU,
+ * perf_event_paranoid trop strict), ct_init le signale : les compteurs
+ * absents valent -1 et ne sont pas affiches ; le programme continue.
+ */
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdio.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define CT_EVENTS  6
+#define CT_THREADS 256
+
+#if defined(__GNUC__)
+#define CT_FN static __attribute__((unused))
+#else
+#define CT_FN static
+#endif
+
+typedef struct {
+    int on;
+    int nthreads;
+    int avail[CT_EVENTS];      /* 1 : ouvert sur au moins un thread */
+    int fd[CT_THREADS][CT_EVENTS];
+} Counters;
+
+static Counters COUNTERS;
+
+static const char *const ct_names[CT_EVENTS] = {
+    "cycles", "instructions", "cache-misses", "branch-misses", "dtlb-misses", "page-faults"
+};
+
+#if defined(__linux__) && defined(__NR_perf_event_open)
+
+CT_FN int ct_open(int e, int group) {
+    struct perf_event_attr at;
+    memset(&at, 0, sizeof(at));
+    at.size = sizeof(at);
+    switch (e) {
+    case 0: at.type = PERF_TYPE_HARDWARE; at.config = PERF_COUNT_HW_CPU_CYCLES; break;
+    case 1: at.type = PERF_TYPE_HARDWARE; at.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+    case 2: at.type = PERF_TYPE_HARDWARE; at.config = PERF_COUNT_HW_CACHE_MISSES; break;
+    case 3: at.type = PERF_TYPE_HARDWARE; at.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    case 4:
+        at.type = PERF_TYPE_HW_CACHE;
+        at.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                  | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    default: at.type = PERF_TYPE_SOFTWARE; at.config = PERF_COUNT_SW_PAGE_FAULTS; break;
+    }
+    at.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    at.exclude_kernel = 1;
+    at.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &at, 0, -1, group, 0);
+}
+
+/* Ouvre les groupes de tous les threads. Retourne 0 si au moins un
+   compteur fonctionne, -1 sinon (message sur stderr dans les deux cas
+   s'il en manque). */
+CT_FN int ct_init(void) {
+    int t, e, n = 1, missing = 0;
+#ifdef _OPENMP
+    n = omp_get_max_threads();
+#endif
+    if (n > CT_THREADS) n = CT_THREADS;
+    COUNTERS.nthreads = n;
+    for (t = 0; t < CT_THREADS; ++t)
+        for (e = 0; e < CT_EVENTS; ++e) COUNTERS.fd[t][e] = -1;
+#ifdef _OPENMP
+#pragma omp parallel private(e)
+#endif
+    {
+        int tid = 0, lead = -1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+#endif
+        if (tid < n) {
+            for (e = 0; e < CT_EVENTS; ++e) {
+                int fd = ct_open(e, lead);
+                if (fd < 0 && lead >= 0) fd = ct_open(e, -1);
+                if (fd >= 0 && lead < 0 && e == 0) lead = fd;
+                COUNTERS.fd[tid][e] = fd;
+            }
+        }
+    }
+    for (e = 0; e < CT_EVENTS; ++e) {
+        COUNTERS.avail[e] = 0;
+        for (t = 0; t < n; ++t) if (COUNTERS.fd[t][e] >= 0) COUNTERS.avail[e] = 1;
+        if (!COUNTERS.avail[e]) missing++;
+    }
+    if (missing == CT_EVENTS) {
+        fprintf(stderr, "compteurs : perf_event_open refuse (PMU absente ou "
+                        "/proc/sys/kernel/perf_event_paranoid > 2), --counters ignore.\n");
+        return -1;
+    }
+    if (missing) {
+        fprintf(stderr, "compteurs : indisponibles :");
+        for (e = 0; e < CT_EVENTS; ++e) if (!COUNTERS.avail[e]) fprintf(stderr, " %s", ct_names[e]);
+        fprintf(stderr, "\n");
+    }
+    COUNTERS.on = 1;
+    return 0;
+}
+
+/* Valeurs courantes, sommees sur les threads ; -1 si indisponible */
+CT_FN void ct_read(double v[CT_EVENTS]) {
+    int t, e;
+    for (e = 0; e < CT_EVENTS; ++e) {
+        v[e] = COUNTERS.avail[e] ? 0.0 : -1.0;
+        if (!COUNTERS.avail[e]) continue;
+        for (t = 0; t < COUNTERS.nthreads; ++t) {
+            __u64 r[3];
+            if (COUNTERS.fd[t][e] < 0) continue;
+            if (read(COUNTERS.fd[t][e], r, sizeof(r)) != (ssize_t)sizeof(r)) continue;
+            if (r[2] > 0 && r[2] < r[1]) v[e] += (double)r[0] * ((double)r[1] / (double)r[2]);
+            else v[e] += (double)r[0];
+        }
+    }
+}
+
+#else
+
+CT_FN int ct_init(void) {
+    fprintf(stderr, "compteurs : perf_event_open n'existe que sous Linux, --counters ignore.\n");
+    return -1;
+}
+
+CT_FN void ct_read(double v[CT_EVENTS]) {
+    int e;
+    for (e = 0; e < CT_EVENTS; ++e) v[e] = -1.0;
+}
+
+#endif
+
+#endif /* COUNTERS_H */
@@ -0,0 +1,195 @@
+/*
+ * deadline.h — budget de temps (--deadline MS) et modele de cout
+ * C ANSI C89, en-tete seul (fonctions static), partage par plasma.c,
+ * geo.c et iso.c.
+ *
+ * Chaque outil estime la duree de son pipeline comme une somme de termes
+ * cellules x ns par cellule, un par noyau de --bench (bench.h), plus le
+ * premier contact des pages de l'arene (DL_TOUCH_NS), et retient la
+ * meilleure qualite dont l'estimation tient dans DL_SHARE du budget :
+ * niveaux du diamond-square (plasma, geo : grille plus grossiere,
+ * reechantillonnee a la taille demandee), passes de flou, niveau de detail
+ * du rendu (iso). Les etapes dont le cout ne depend pas de la qualite
+ * (lecture, sortie) restent entieres. Un palier de qualite n'est pris que
+ * s'il gagne au moins 5 % de l'estimation (DL_GAIN) ou fait tenir le
+ * budget : quand la lecture ou la sortie dominent, la qualite reste
+ * entiere et l'outil signale seulement le budget intenable sur stderr.
+ *
+ * Couts : dl_defaults (medianes de --bench, 1 thread, f64, cote 4096, 2048
+ * pour iso, sur la machine de reference du README), ou --deadline-model F :
+ * la sortie JSON d'un --bench ou de bench.sh sur la machine courante.
+ * Pour chaque noyau, la mediane de la plus grande taille mesuree, divisee
+ * par ses cellules. Calibrer avec les memes -j et --precision que l'usage.
+ *
+ *   --deadline MS        budget du pipeline en millisecondes
+ *   --deadline-model F   couts mesures (JSON de --bench ou bench.sh)
+ */
+
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DL_SHARE 0.8               /* part du budget promise aux etapes mesurees */
+#define DL_GAIN 0.95               /* un palier doit gagner au moins 5 % */
+#define DL_TOUCH_NS 0.3            /* ns par octet de page neuve (defaut de page et
+                                      mise a zero, absents des mesures de --bench) */
+
+#if defined(__GNUC__)
+#define DL_FN static __attribute__((unused))
+#else
+#define DL_FN static
+#endif
+
+typedef struct {
+    double ms;                 /* --deadline, 0 : sans budget */
+    const char *model;         /* --deadline-model, 0 : dl_defaults */
+    int warned;                /* modele illisible deja signale */
+} Deadline;
+
+static Deadline DEADLINE;
+
+/* ns par cellule sur la machine de reference */
+static const struct {
+    const char *tool, *kernel;
+    double ns;
+} dl_defaults[] = {
+    { "plasma", "diamond_square",     29.4 },
+    { "plasma", "resample_bilinear",   4.5 },
+    { "plasma", "box_blur",            9.2 },
+    { "plasma", "normalize01",         1.9 },
+    { "plasma", "apply_gamma",        25.4 },
+    { "plasma", "print_values",      305.0 },
+    { "plasma", "print_ascii",         1.9 },
+    { "geo",    "diamond_square",      7.7 },
+    { "geo",    "resample_bilinear",   4.8 },
+    { "geo",    "smooth_box",          5.3 },
+    { "geo",    "print_values",      402.0 },
+    { "geo",    "flood",              27.5 },
+    { "geo",    "colour",             13.1 },
+    { "geo",    "write_ppm",          37.3 },
+    { "iso",    "read_grid",         338.0 },
+    { "iso",    "fill_tri",            8.1 },
+    { "iso",    "clear",               0.9 },
+    { "iso",    "write_ppm",           0.0 },
+    { 0, 0, 0.0 }
+};
+
+/* Reconnait --deadline MS et --deadline-model F a argv[*i] et avance *i.
+   Retourne 1 si l'option est prise, -1 si sa valeur est invalide, 0 sinon. */
+DL_FN int dl_parse(int argc, char **argv, int *i) {
+    const char *a = argv[*i];
+    const char *v = (*i + 1 < argc) ? argv[*i + 1] : 0;
+    if (strcmp(a, "--deadline") == 0 && v) {
+        char *e = 0;
+        DEADLINE.ms = strtod(v, &e);
+        if (*v == '\0' || *e != '\0' || !(DEADLINE.ms > 0.0)) return -1;
+        *i += 2; return 1;
+    }
+    if (strcmp(a, "--deadline-model") == 0 && v) {
+        DEADLINE.model = v;
+        *i += 2; return 1;
+    }
+    return 0;
+}
+
+/* ns par cellule du noyau kernel de tool : modele mesure, sinon valeur de
+   reference. Lecture ligne a ligne du format ecrit par bench_run. */
+DL_FN double dl_ns(const char *tool, const char *kernel) {
+    double ns = 0.0;
+    int k, best = 0;
+    if (DEADLINE.model) {
+        FILE *f = fopen(DEADLINE.model, "r");
+        char line[512], cur[64], kern[64];
+        if (!f && !DEADLINE.warned) {
+            fprintf(stderr, "deadline : modele '%s' illisible, couts de reference.\n", DEADLINE.model);
+            DEADLINE.warned = 1;
+        }
+        cur[0] = '\0';
+        while (f && fgets(line, sizeof(line), f)) {
+            const char *p = strstr(line, "\"tool\":\"");
+            int sz;
+            double m, cells;
+            if (p && sscanf(p, "\"tool\":\"%63[^\"]", cur) != 1) cur[0] = '\0';
+            p = strstr(line, "{\"kernel\":\"");
+            if (!p || strcmp(cur, tool) != 0) continue;
+            if (sscanf(p, "{\"kernel\":\"%63[^\"]\",\"size\":%d,\"cells\":%lf,\"median_ms\":%lf",
+                       kern, &sz, &cells, &m) != 4) continue;
+            if (strcmp(kern, kernel) == 0 && sz > best && cells > 0.0) {
+                best = sz;
+                ns = 1e6 * m / cells;
+            }
+        }
+        if (f) fclose(f);
+        if (best) return ns;
+    }
+    for (k = 0; dl_defaults[k].tool; ++k) {
+        if (strcmp(dl_defaults[k].tool, tool) == 0 && strcmp(dl_defaults[k].kernel, kernel) == 0) {
+            return dl_defaults[k].ns;
+        }
+    }
+    return 0.0;
+}
+
+/* Duree estimee (ms) de cells cellules du noyau kernel */
+DL_FN double dl_ms(const char *tool, const char *kernel, double cells) {
+    return 1e-6 * dl_ns(tool, kernel) * cells;
+}
+
+/* Duree estimee (ms) du premier contact de bytes octets d'arene */
+DL_FN double dl_touch_ms(size_t bytes) {
+    return 1e-6 * DL_TOUCH_NS * (double)bytes;
+}
+
+/* Budget des etapes mesurees, en ms */
+DL_FN double dl_budget(void) {
+    return DL_SHARE * DEADLINE.ms;
+}
+
+/* Cout estime (ms) avec d niveaux de detail retires et passes passes de
+   flou ou d'adoucissement */
+typedef double (*DlCost)(int d, int passes);
+
+/* Paliers de qualite pour le budget, partages par plasma, geo et iso :
+   retire des niveaux (*d, au plus dmax) tant que l'estimation depasse le
+   budget, puis des passes (*passes), et rend ensuite les niveaux qui
+   tiennent sans ces passes. Chaque palier doit gagner DL_GAIN ou faire
+   tenir le budget : sinon la descente s'arrete, la sortie ou la lecture
+   dominant. Entree : *d = 0, *passes = valeur demandee. Retourne
+   l'estimation retenue. */
+DL_FN double dl_degrade(DlCost cost, int dmax, int *d, int *passes) {
+    double est = cost(*d, *passes), e2;
+    while (est > dl_budget() && *d < dmax) {
+        e2 = cost(*d + 1, *passes);
+        if (e2 > DL_GAIN * est && e2 > dl_budget()) break;
+        ++*d;
+        est = e2;
+    }
+    while (est > dl_budget() && *passes > 0) {
+        e2 = cost(*d, *passes - 1);
+        if (e2 > DL_GAIN * est && e2 > dl_budget()) break;
+        --*passes;
+        est = e2;
+    }
+    /* moins de passes libere du temps : rendre les niveaux qui tiennent */
+    while (*d > 0 && (e2 = cost(*d - 1, *passes)) <= dl_budget()) {
+        --*d;
+        est = e2;
+    }
+    return est;
+}
+
+/* Compte rendu sur stderr quand la qualite baisse (what) ou que le budget
+   ne peut pas etre tenu */
+DL_FN void dl_report(const char *tool, double est, const char *what) {
+    if (est > dl_budget()) {
+        fprintf(stderr, "%s : deadline %g ms intenable, %.1f ms estimes au plus bas (%s).\n",
+                tool, DEADLINE.ms, est, what[0] ? what : "aucune reduction possible");
+    } else if (what[0]) {
+        fprintf(stderr, "%s : deadline %g ms, %.1f ms estimes : %s.\n", tool, DEADLINE.ms, est, what);
+    }
+}
+
+#endif /* DEADLINE_H */
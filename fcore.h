@@ -0,0 +1,416 @@
+/*
+ * fcore.h — noyaux communs de generation : diamond-square,
+ * reechantillonnage bilineaire, flou boite, normalisation
+ * C ANSI C89, en-tete seul (fonctions static), partage par plasma.c et geo.c
+ * (via plasma_pipeline.h et geo_pipeline.h).
+ *
+ * Une seule copie de ces noyaux pour les deux outils : memes optimisations
+ * (niveaux compacts du diamond-square, lignes de simd_dispatch.h, bandes
+ * OpenMP, evenements de trace) et memes calculs, donc memes valeurs pour
+ * les memes tirages.
+ *
+ * Deux parties :
+ *   - partie commune, avec garde d'inclusion : parametres FcDs et aides ;
+ *   - noyaux generiques sur la precision, sans garde, generes a chaque
+ *     inclusion avec PX_T / PX_C / PX_LOAD / PX_STORE / PX_FN definis (voir
+ *     plasma_pipeline.h) ; les macros restent a la charge de l'appelant.
+ *
+ * API, stable d'une version a l'autre (suffixe _f64, _f32 ou _u16) :
+ *   fc_ds(src, n, p, aux)            diamond-square par niveaux, n = 2^k + 1,
+ *                                    aux : fc_ds_aux_cells(n) cellules
+ *                                    p->level : crochet apres chaque niveau
+ *   fc_ds_strided(src, n, p)         meme resultat, en place (pas de aux)
+ *   fc_resample(src, n, period, dst, W, H)
+ *                                    bilineaire n x n -> W x H
+ *   fc_blur(grid, W, H, r, p, wrap, tmp)
+ *                                    flou boite de rayon r, p passes
+ *   fc_normalize01(grid, N)          ramene grid dans [0,1]
+ * Les grilles sont en ordre ligne ; aucun noyau n'alloue de memoire.
+ */
+
+#ifndef FCORE_H
+#define FCORE_H
+
+#include <stddef.h>
+#include "trace.h"
+#include "tune.h"
+#include "isa.h"
+
+#if defined(__GNUC__)
+#define FC_FN static __attribute__((unused))
+#else
+#define FC_FN static
+#endif
+
+/* Parametres du diamond-square. Decalage d'un point au niveau k :
+   (2 u - 1) * amp * decay^k, u = rand01(). */
+typedef struct {
+    double amp;                /* amplitude des decalages au premier niveau */
+    double decay;              /* facteur d'amplitude par niveau */
+    double bias;               /* moyenne des coins */
+    int wrap;                  /* grille torique de periode n - 1 */
+    int clamp01;               /* coins u, chaque point borne a [0,1] (geo) */
+    double (*rand01)(void);    /* tirage uniforme dans [0,1) */
+    void (*level)(void *ctx, const void *grid, int side);
+                               /* 0, ou appele par fc_ds apres chaque niveau :
+                                  grille compacte side x side (PX_T), en
+                                  lecture seule */
+    void *level_ctx;
+} FcDs;
+
+/* Indice replie dans 0..m-1 */
+FC_FN int fc_wrap(int i, int m) {
+    i %= m;
+    return (i < 0) ? i + m : i;
+}
+
+/* Cellules de aux pour fc_ds */
+FC_FN size_t fc_ds_aux_cells(int n) {
+    size_t half = (size_t)((n - 1) / 2 + 1);
+    return half * half;
+}
+
+/* Decalage aleatoire dans [-scale, scale] */
+FC_FN double fc_offset(const FcDs *p, double scale) {
+    return (p->rand01() * 2.0 - 1.0) * scale;
+}
+
+/* Valeur initiale d'un coin */
+FC_FN double fc_corner(const FcDs *p, double scale) {
+    if (p->clamp01) return p->rand01();
+    return p->bias + fc_offset(p, scale);
+}
+
+#endif /* FCORE_H */
+
+#ifdef PX_T
+
+#include "simd_dispatch.h"
+
+/* Acces dans une grille carree n x n : bornage aux bords, ou repliement
+   modulo period si period > 0 (grille periodique) */
+FC_FN PX_C PX_FN(fc_get)(const PX_T *src, int n, int period, int x, int y) {
+    if (period > 0) {
+        x = fc_wrap(x, period);
+        y = fc_wrap(y, period);
+        return PX_LOAD(src[(size_t)y * (size_t)n + (size_t)x]);
+    }
+
+    if (x < 0) { x = 0; }
+    else if (x >= n) { x = n - 1; }
+
+    if (y < 0) { y = 0; }
+    else if (y >= n) { y = n - 1; }
+
+    return PX_LOAD(src[(size_t)y * (size_t)n + (size_t)x]);
+}
+
+/* Valeur d'un point avant stockage (bornage de clamp01) */
+FC_FN PX_C PX_FN(fc_bound)(const FcDs *p, PX_C v) {
+    if (!p->clamp01) return v;
+    if (v < (PX_C)0) return (PX_C)0;
+    if (v > (PX_C)1) return (PX_C)1;
+    return v;
+}
+
+FC_FN void PX_FN(fc_set)(PX_T *src, int n, int x, int y, PX_C v) {
+    src[(size_t)y * (size_t)n + (size_t)x] = PX_STORE(v);
+}
+
+/* Coins d'une grille de cote n (pas n - 1) */
+FC_FN void PX_FN(fc_corners)(PX_T *g, int n, const FcDs *p, double scale) {
+    int s = n - 1;
+    if (p->wrap) {
+        PX_C v = (PX_C)fc_corner(p, scale);
+        PX_FN(fc_set)(g, n, 0, 0, v);
+        PX_FN(fc_set)(g, n, s, 0, v);
+        PX_FN(fc_set)(g, n, 0, s, v);
+        PX_FN(fc_set)(g, n, s, s, v);
+    } else {
+        PX_FN(fc_set)(g, n, 0, 0, (PX_C)fc_corner(p, scale));
+        PX_FN(fc_set)(g, n, s, 0, (PX_C)fc_corner(p, scale));
+        PX_FN(fc_set)(g, n, 0, s, (PX_C)fc_corner(p, scale));
+        PX_FN(fc_set)(g, n, s, s, (PX_C)fc_corner(p, scale));
+    }
+}
+
+/* Diamond-Square sur une grille n x n, n = 2^k + 1, en place (acces
+   espaces de 'step' sur les deux axes : --ds-layout strided de plasma).
+   wrap : la derniere ligne et la derniere colonne recopient la premiere. */
+FC_FN void PX_FN(fc_ds_strided)(PX_T *src, int n, const FcDs *p) {
+    int step = n - 1;
+    int half;
+    int period = p->wrap ? n - 1 : 0;
+    double scale = p->amp;
+
+    PX_FN(fc_corners)(src, n, p, scale);
+
+    while (step > 1) {
+        int x, y;
+        half = step / 2;
+
+        /* Diamond */
+        for (y = half; y < n; y += step) {
+            for (x = half; x < n; x += step) {
+                PX_C a = PX_FN(fc_get)(src, n, period, x - half, y - half);
+                PX_C b = PX_FN(fc_get)(src, n, period, x + half, y - half);
+                PX_C c = PX_FN(fc_get)(src, n, period, x - half, y + half);
+                PX_C d = PX_FN(fc_get)(src, n, period, x + half, y + half);
+                PX_C avg = (a + b + c + d) * (PX_C)0.25;
+                PX_C off = (PX_C)fc_offset(p, scale);
+                PX_FN(fc_set)(src, n, x, y, PX_FN(fc_bound)(p, avg + off));
+            }
+        }
+
+        /* Square */
+        for (y = 0; y < n; y += half) {
+            int xstart = ((y / half) % 2) ? 0 : half;
+            for (x = xstart; x < n; x += step) {
+                PX_C sum = 0;
+                int cnt = 0;
+                if (p->wrap) {
+                    /* bord droit / bas : recopie du bord oppose plus bas */
+                    if (x == n - 1 || y == n - 1) continue;
+                    sum = PX_FN(fc_get)(src, n, period, x, y - half) + PX_FN(fc_get)(src, n, period, x, y + half)
+                        + PX_FN(fc_get)(src, n, period, x - half, y) + PX_FN(fc_get)(src, n, period, x + half, y);
+                    cnt = 4;
+                } else {
+                    if (y - half >= 0) { sum += PX_FN(fc_get)(src, n, 0, x, y - half); cnt++; }
+                    if (y + half < n)  { sum += PX_FN(fc_get)(src, n, 0, x, y + half); cnt++; }
+                    if (x - half >= 0) { sum += PX_FN(fc_get)(src, n, 0, x - half, y); cnt++; }
+                    if (x + half < n)  { sum += PX_FN(fc_get)(src, n, 0, x + half, y); cnt++; }
+                }
+                {
+                    PX_C avg = sum / (PX_C)cnt;
+                    PX_C off = (PX_C)fc_offset(p, scale);
+                    PX_FN(fc_set)(src, n, x, y, PX_FN(fc_bound)(p, avg + off));
+                }
+            }
+        }
+
+        if (p->wrap) {
+            int i;
+            for (i = 0; i < n; i += half) {
+                src[(size_t)i * (size_t)n + (size_t)(n - 1)] = src[(size_t)i * (size_t)n];
+                src[(size_t)(n - 1) * (size_t)n + (size_t)i] = src[i];
+            }
+        }
+
+        step = half;
+        scale *= p->decay;
+    }
+}
+
+/* Diamond-Square par niveaux. Le niveau de pas s est une grille compacte
+   (m/s + 1)^2 ne contenant que les points multiples de s, en ordre ligne :
+   chaque niveau lit la grille du niveau precedent et ecrit la suivante en
+   balayages continus (recopie des points pairs + losanges, puis carres),
+   au lieu de sauter de 'step' lignes. La derniere expansion (s = 1) ecrit
+   directement src en ordre ligne et sert de passe de conversion unique.
+   Memes tirages, dans le meme ordre, et memes calculs que fc_ds_strided.
+   aux : fc_ds_aux_cells(n) cellules, les niveaux alternent src / aux.
+   p->level, s'il est donne, voit chaque niveau termine (apercus
+   progressifs, preview.h) ; fc_ds_strided ne l'appelle pas. */
+FC_FN void PX_FN(fc_ds)(PX_T *src, int n, const FcDs *p, PX_T *aux) {
+    int m = n - 1;
+    int c = 1, levels = 0, t;
+    double scale = p->amp;
+    PX_T *cur;
+
+    for (t = m; t > 1; t >>= 1) levels++;
+    /* grille de pas 2^t dans src si t pair : la grille finale (t = 0) y est */
+    cur = (levels % 2 == 0) ? src : aux;
+
+    PX_FN(fc_corners)(cur, 2, p, scale);
+
+    while (c < m) {
+        int c2 = 2 * c, w = c + 1, w2 = c2 + 1;
+        int i, j, k, r, q;
+        PX_T *nxt = (cur == src) ? aux : src;
+        PX_C mean[ISA_CHUNK];
+
+        /* Points pairs recopies et losanges, ligne par ligne */
+        for (i = 0; i <= c; ++i) {
+            const PX_T *row0 = cur + (size_t)i * (size_t)w;
+            PX_T *even = nxt + (size_t)(2 * i) * (size_t)w2;
+            for (j = 0; j <= c; ++j) even[2 * j] = row0[j];
+            if (i < c) {
+                const PX_T *row1 = row0 + w;
+                PX_T *odd = even + w2;
+                for (j = 0; j < c; j += ISA_CHUNK) {
+                    int len = (c - j < ISA_CHUNK) ? c - j : ISA_CHUNK;
+                    PX_FN(KN).ds_diamond_avg(row0 + j, row1 + j, len, mean);
+                    for (k = 0; k < len; ++k) {
+                        PX_C off = (PX_C)fc_offset(p, scale);
+                        odd[2 * (j + k) + 1] = PX_STORE(PX_FN(fc_bound)(p, mean[k] + off));
+                    }
+                }
+            }
+        }
+
+        /* Carres : voisins = losanges et points pairs, deja dans nxt.
+           Lignes interieures : colonnes 0 < q < c2 par le noyau, dans
+           l'ordre des tirages. */
+        for (r = 0; r <= c2; ++r) {
+            PX_T *row = nxt + (size_t)r * (size_t)w2;
+            for (q = (r % 2) ? 0 : 1; q <= c2; q += 2) {
+                PX_C sum = 0;
+                int cnt = 0;
+                if (q > 0 && q < c2 && r > 0 && r < c2) {
+                    int len = (c2 - q + 1) / 2;
+                    if (len > ISA_CHUNK) len = ISA_CHUNK;
+                    PX_FN(KN).ds_square_avg(row + q - w2, row + q, row + q + w2, len, mean);
+                    for (k = 0; k < len; ++k) {
+                        PX_C off = (PX_C)fc_offset(p, scale);
+                        row[q + 2 * k] = PX_STORE(PX_FN(fc_bound)(p, mean[k] + off));
+                    }
+                    q += 2 * (len - 1);
+                    continue;
+                }
+                if (p->wrap) {
+                    /* bord droit / bas : recopie du bord oppose plus bas */
+                    if (q == c2 || r == c2) continue;
+                    sum = PX_LOAD(nxt[(size_t)fc_wrap(r - 1, c2) * (size_t)w2 + q])
+                        + PX_LOAD(nxt[(size_t)(r + 1) * (size_t)w2 + q])
+                        + PX_LOAD(row[fc_wrap(q - 1, c2)]) + PX_LOAD(row[q + 1]);
+                    cnt = 4;
+                } else {
+                    if (r > 0)  { sum += PX_LOAD(row[q - w2]); cnt++; }
+                    if (r < c2) { sum += PX_LOAD(row[q + w2]); cnt++; }
+                    if (q > 0)  { sum += PX_LOAD(row[q - 1]); cnt++; }
+                    if (q < c2) { sum += PX_LOAD(row[q + 1]); cnt++; }
+                }
+                {
+                    PX_C avg = sum / (PX_C)cnt;
+                    PX_C off = (PX_C)fc_offset(p, scale);
+                    row[q] = PX_STORE(PX_FN(fc_bound)(p, avg + off));
+                }
+            }
+        }
+
+        if (p->wrap) {
+            for (i = 0; i <= c2; ++i) {
+                nxt[(size_t)i * (size_t)w2 + c2] = nxt[(size_t)i * (size_t)w2];
+                nxt[(size_t)c2 * (size_t)w2 + i] = nxt[i];
+            }
+        }
+
+        if (p->level) p->level(p->level_ctx, nxt, c2 + 1);
+
+        cur = nxt;
+        c = c2;
+        scale *= p->decay;
+    }
+}
+
+/* Bilineaire src[n x n] vers dst[W x H]. Si period > 0, la grille est
+   periodique : dst couvre exactement une periode et se raccorde a lui-meme. */
+FC_FN void PX_FN(fc_resample)(const PX_T *src, int n, int period, PX_T *dst, int W, int H) {
+    int y;
+    double spanX = (double)(n - 1), spanY = (double)(n - 1);
+    double denomX = (W > 1) ? (double)(W - 1) : 1.0;
+    double denomY = (H > 1) ? (double)(H - 1) : 1.0;
+    if (period > 0) {
+        spanX = spanY = (double)period;
+        denomX = (double)W;
+        denomY = (double)H;
+    }
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        double t0 = tr_begin();
+        long first = -1, count = 0;
+#ifdef _OPENMP
+#pragma omp for schedule(static, tn_rows(H)) nowait
+#endif
+        for (y = 0; y < H; ++y) {
+            double v = ((double)y) * spanY / denomY;
+            int v0 = (int)floor(v);
+            int v1 = v0 + 1;
+            PX_C fy = (PX_C)(v - (double)v0);
+            if (period > 0) { v0 = fc_wrap(v0, period); v1 = fc_wrap(v1, period); }
+            else if (v1 >= n) v1 = n - 1;
+            PX_FN(KN).resample_row(src + (size_t)v0 * (size_t)n, src + (size_t)v1 * (size_t)n,
+                                   n, period, spanX, denomX, fy, dst + (size_t)y * (size_t)W, W);
+            if (count++ == 0) first = y;
+        }
+        tr_end("band", "resample", t0, first, count);
+    }
+}
+
+/* Flou boite de rayon r, p passes, resultat final dans grid. Moyenne des
+   (2r+1)^2 voisins, bornes aux bords ou replies (wrap). tmp : W x H. */
+FC_FN void PX_FN(fc_blur)(PX_T *grid, int W, int H, int r, int p, int wrap, PX_T *tmp) {
+    int pass, y, x, dy, dx;
+    if (r <= 0 || p <= 0) return;
+
+    for (pass = 0; pass < p; ++pass) {
+        PX_T *src = (pass % 2 == 0) ? grid : tmp;
+        PX_T *dst = (pass % 2 == 0) ? tmp  : grid;
+
+        /* lignes independantes, memes bandes que le reechantillonnage */
+#ifdef _OPENMP
+#pragma omp parallel private(x, dy, dx)
+#endif
+        {
+            double t0 = tr_begin();
+            long first = -1, count = 0;
+#ifdef _OPENMP
+#pragma omp for schedule(static, tn_rows(H)) nowait
+#endif
+            for (y = 0; y < H; ++y) {
+                /* colonnes sans bord : noyau ; bords ci-dessous */
+                if (W > 2 * r) PX_FN(KN).blur_row(src, W, H, y, r, wrap, r, W - r, dst + (size_t)y * (size_t)W);
+                for (x = 0; x < W; ++x) {
+                    PX_C sum = 0;
+                    int cnt = 0;
+                    if (x == r && W > 2 * r) x = W - r;
+                    for (dy = -r; dy <= r; ++dy) {
+                        int yy = y + dy;
+                        const PX_T *row;
+                        if (wrap) yy = fc_wrap(yy, H);
+                        else { if (yy < 0) yy = 0; if (yy >= H) yy = H - 1; }
+                        row = src + (size_t)yy * (size_t)W;
+                        for (dx = -r; dx <= r; ++dx) {
+                            int xx = x + dx;
+                            if (wrap) xx = fc_wrap(xx, W);
+                            else { if (xx < 0) xx = 0; if (xx >= W) xx = W - 1; }
+                            sum += PX_LOAD(row[xx]);
+                            cnt++;
+                        }
+                    }
+                    dst[(size_t)y * (size_t)W + (size_t)x] = PX_STORE(sum / (PX_C)cnt);
+                }
+                if (count++ == 0) first = y;
+            }
+            tr_end("band", "blur", t0, first, count);
+        }
+    }
+
+    /* Si p est impair, le dernier ecrit a ete fait dans tmp -> recopier vers grid */
+    if ((p % 2) == 1) {
+#ifdef _OPENMP
+#pragma omp parallel private(x)
+#pragma omp for schedule(static, tn_rows(H))
+#endif
+        for (y = 0; y < H; ++y) {
+            size_t o = (size_t)y * (size_t)W;
+            for (x = 0; x < W; ++x) grid[o + (size_t)x] = tmp[o + (size_t)x];
+        }
+    }
+}
+
+/* Normalisation vers [0,1] ; grille constante -> 0.5 */
+FC_FN void PX_FN(fc_normalize01)(PX_T *grid, size_t N) {
+    size_t i;
+    PX_C mn, mx;
+    PX_FN(KN).minmax(grid, N, &mn, &mx);
+    if (mx - mn <= (PX_C)1e-12) {
+        for (i = 0; i < N; ++i) grid[i] = PX_STORE((PX_C)0.5);
+        return;
+    }
+    PX_FN(KN).rescale(grid, N, mn, mx - mn);
+}
+
+#endif /* PX_T */
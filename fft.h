@@ -0,0 +1,320 @@
+/*
+ * fft.h — FFT radix-2/4 et synthese spectrale fBm, partagees par plasma.c et geo.c
+ * C ANSI C89, aucune dependance externe (math.h, stdlib.h).
+ *
+ * Fonctions "static" : le fichier est inclus tel quel par chaque programme,
+ * la compilation reste une seule commande cc par outil.
+ *
+ * - FFT complexe iterative, tableaux separes re[] / im[], n puissance de 2.
+ *   Les etages sont fusionnes deux par deux (radix 4) : chaque passe lit et
+ *   ecrit les donnees une seule fois pour deux etages radix 2.
+ * - Variante "colonnes" : count vecteurs entrelaces (element j du vecteur v
+ *   en j*stride + v). La boucle interne parcourt v, contigu en memoire, ce
+ *   qui se vectorise sans transposition ; les colonnes sont traitees par
+ *   blocs de FFT_BLOCK pour rester en cache.
+ * - Synthese spectrale : demi-spectre hermitien N x (N/2+1), amplitudes
+ *   |k|^(-beta/2) et phases aleatoires, FFT inverse des colonnes puis
+ *   FFT inverse reelle des lignes (une FFT complexe de taille N/2 par ligne).
+ *   Lignes et blocs de colonnes sont repartis entre threads OpenMP.
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdlib.h>
+#include <math.h>
+#include "trace.h"
+#include "tune.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define FFT_BLOCK 16     /* colonnes par bloc de la passe verticale */
+#define FFT_PI    3.14159265358979323846
+
+typedef struct {
+    int n;
+    int log2n;
+    int *rev;            /* permutation bit-reverse */
+    double *cs, *sn;     /* exp(+2 i pi k / n), k < n/2 (transformee inverse) */
+} FftPlan;
+
+#ifdef _OPENMP
+static int fft_max_threads(void) { return omp_get_max_threads(); }
+static int fft_thread_id(void) { return omp_get_thread_num(); }
+#else
+static int fft_max_threads(void) { return 1; }
+static int fft_thread_id(void) { return 0; }
+#endif
+
+static void fft_plan_free(FftPlan *p) {
+    free(p->rev);
+    free(p->cs);
+    free(p->sn);
+    p->rev = 0; p->cs = 0; p->sn = 0;
+}
+
+/* Prepare une FFT inverse de taille n (puissance de 2). Retourne 0 ou -1. */
+static int fft_plan_init(FftPlan *p, int n) {
+    int i, b, half = (n > 1) ? n / 2 : 1;
+
+    p->n = n;
+    p->log2n = 0;
+    while ((1 << p->log2n) < n) p->log2n++;
+    p->rev = (int*)malloc((size_t)n * sizeof(int));
+    p->cs = (double*)malloc((size_t)half * sizeof(double));
+    p->sn = (double*)malloc((size_t)half * sizeof(double));
+    if (!p->rev || !p->cs || !p->sn) { fft_plan_free(p); return -1; }
+
+    for (i = 0; i < n; ++i) {
+        int r = 0;
+        for (b = 0; b < p->log2n; ++b) if (i & (1 << b)) r |= 1 << (p->log2n - 1 - b);
+        p->rev[i] = r;
+    }
+    for (i = 0; i < half; ++i) {
+        double a = 2.0 * FFT_PI * (double)i / (double)n;
+        p->cs[i] = cos(a);
+        p->sn[i] = sin(a);
+    }
+    return 0;
+}
+
+/* FFT inverse (non normalisee) d'un vecteur contigu de taille p->n */
+static void fft_inverse(const FftPlan *p, double *re, double *im) {
+    int n = p->n, i, j, g, h;
+
+    for (i = 0; i < n; ++i) {
+        j = p->rev[i];
+        if (j > i) {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    h = 1;
+    if (p->log2n & 1) {
+        /* etage radix 2 initial, twiddle 1 */
+        for (g = 0; g < n; g += 2) {
+            double ar = re[g], ai = im[g], br = re[g + 1], bi = im[g + 1];
+            re[g] = ar + br; im[g] = ai + bi;
+            re[g + 1] = ar - br; im[g + 1] = ai - bi;
+        }
+        h = 2;
+    }
+
+    for (; h < n; h *= 4) {
+        int s1 = n / (2 * h), s2 = n / (4 * h);
+        for (g = 0; g < n; g += 4 * h) {
+            for (j = 0; j < h; ++j) {
+                int i0 = g + j, i1 = i0 + h, i2 = i1 + h, i3 = i2 + h;
+                double w1r = p->cs[j * s1], w1i = p->sn[j * s1];
+                double w2r = p->cs[j * s2], w2i = p->sn[j * s2];
+                double w3r = p->cs[(j + h) * s2], w3i = p->sn[(j + h) * s2];
+                double tr, ti, b0r, b0i, b1r, b1i, b2r, b2i, b3r, b3i;
+
+                /* etage de demi-taille h : (i0,i1) et (i2,i3) */
+                tr = w1r * re[i1] - w1i * im[i1]; ti = w1r * im[i1] + w1i * re[i1];
+                b0r = re[i0] + tr; b0i = im[i0] + ti;
+                b1r = re[i0] - tr; b1i = im[i0] - ti;
+                tr = w1r * re[i3] - w1i * im[i3]; ti = w1r * im[i3] + w1i * re[i3];
+                b2r = re[i2] + tr; b2i = im[i2] + ti;
+                b3r = re[i2] - tr; b3i = im[i2] - ti;
+
+                /* etage de demi-taille 2h : (i0,i2) et (i1,i3) */
+                tr = w2r * b2r - w2i * b2i; ti = w2r * b2i + w2i * b2r;
+                re[i0] = b0r + tr; im[i0] = b0i + ti;
+                re[i2] = b0r - tr; im[i2] = b0i - ti;
+                tr = w3r * b3r - w3i * b3i; ti = w3r * b3i + w3i * b3r;
+                re[i1] = b1r + tr; im[i1] = b1i + ti;
+                re[i3] = b1r - tr; im[i3] = b1i - ti;
+            }
+        }
+    }
+}
+
+/* FFT inverse de count vecteurs entrelaces : element j du vecteur v en
+   re[j * stride + v]. Memes passes que fft_inverse, boucle interne sur v. */
+static void fft_inverse_columns(const FftPlan *p, double *re, double *im, size_t stride, int count) {
+    int n = p->n, i, j, g, h, v;
+
+    for (i = 0; i < n; ++i) {
+        j = p->rev[i];
+        if (j > i) {
+            double *ra = re + (size_t)i * stride, *rb = re + (size_t)j * stride;
+            double *ia = im + (size_t)i * stride, *ib = im + (size_t)j * stride;
+            for (v = 0; v < count; ++v) {
+                double t = ra[v]; ra[v] = rb[v]; rb[v] = t;
+                t = ia[v]; ia[v] = ib[v]; ib[v] = t;
+            }
+        }
+    }
+
+    h = 1;
+    if (p->log2n & 1) {
+        for (g = 0; g < n; g += 2) {
+            double *ar = re + (size_t)g * stride, *ai = im + (size_t)g * stride;
+            double *br = ar + stride, *bi = ai + stride;
+            for (v = 0; v < count; ++v) {
+                double xr = ar[v], xi = ai[v], yr = br[v], yi = bi[v];
+                ar[v] = xr + yr; ai[v] = xi + yi;
+                br[v] = xr - yr; bi[v] = xi - yi;
+            }
+        }
+        h = 2;
+    }
+
+    for (; h < n; h *= 4) {
+        int s1 = n / (2 * h), s2 = n / (4 * h);
+        for (g = 0; g < n; g += 4 * h) {
+            for (j = 0; j < h; ++j) {
+                double w1r = p->cs[j * s1], w1i = p->sn[j * s1];
+                double w2r = p->cs[j * s2], w2i = p->sn[j * s2];
+                double w3r = p->cs[(j + h) * s2], w3i = p->sn[(j + h) * s2];
+                double *r0 = re + (size_t)(g + j) * stride, *i0 = im + (size_t)(g + j) * stride;
+                double *r1 = r0 + (size_t)h * stride, *i1 = i0 + (size_t)h * stride;
+                double *r2 = r1 + (size_t)h * stride, *i2 = i1 + (size_t)h * stride;
+                double *r3 = r2 + (size_t)h * stride, *i3 = i2 + (size_t)h * stride;
+                for (v = 0; v < count; ++v) {
+                    double tr, ti, b0r, b0i, b1r, b1i, b2r, b2i, b3r, b3i;
+                    tr = w1r * r1[v] - w1i * i1[v]; ti = w1r * i1[v] + w1i * r1[v];
+                    b0r = r0[v] + tr; b0i = i0[v] + ti;
+                    b1r = r0[v] - tr; b1i = i0[v] - ti;
+                    tr = w1r * r3[v] - w1i * i3[v]; ti = w1r * i3[v] + w1i * r3[v];
+                    b2r = r2[v] + tr; b2i = i2[v] + ti;
+                    b3r = r2[v] - tr; b3i = i2[v] - ti;
+
+                    tr = w2r * b2r - w2i * b2i; ti = w2r * b2i + w2i * b2r;
+                    r0[v] = b0r + tr; i0[v] = b0i + ti;
+                    r2[v] = b0r - tr; i2[v] = b0i - ti;
+                    tr = w3r * b3r - w3i * b3i; ti = w3r * b3i + w3i * b3r;
+                    r1[v] = b1r + tr; i1[v] = b1i + ti;
+                    r3[v] = b1r - tr; i3[v] = b1i - ti;
+                }
+            }
+        }
+    }
+}
+
+/* Ligne reelle out[0..N-1] depuis son demi-spectre hermitien
+   (xr,xi)[0..N/2], via une FFT complexe de taille N/2.
+   pc : plan de taille N (pour exp(+2 i pi k/N)), ph : plan de taille N/2.
+   zr, zi : tampons de N/2 doubles. */
+static void fft_inverse_real_row(const FftPlan *pc, const FftPlan *ph,
+                                 const double *xr, const double *xi,
+                                 double *zr, double *zi, double *out)
+{
+    int half = ph->n, k;
+
+    for (k = 0; k < half; ++k) {
+        /* A = X[k], B = conj(X[N/2 - k]) */
+        double ar = xr[k], ai = xi[k];
+        double br = xr[half - k], bi = -xi[half - k];
+        double er = ar + br, ei = ai + bi;
+        double dr = ar - br, di = ai - bi;
+        double c = pc->cs[k], s = pc->sn[k];
+        zr[k] = er - (c * di + s * dr);
+        zi[k] = ei + (c * dr - s * di);
+    }
+    fft_inverse(ph, zr, zi);
+    for (k = 0; k < half; ++k) {
+        out[2 * k] = zr[k];
+        out[2 * k + 1] = zi[k];
+    }
+}
+
+/* Doubles de travail necessaires a spectral_fbm pour une carte N x N :
+   demi-spectre (re, im) et une ligne par thread */
+static size_t spectral_fbm_work(int N) {
+    if (N < 2) return 0;
+    return 2 * (size_t)N * (size_t)(N / 2 + 1) + (size_t)fft_max_threads() * (size_t)N;
+}
+
+/* Carte out[N x N] (N puissance de 2, N >= 2) de bruit fBm par synthese
+   spectrale : spectre de puissance en 1/|f|^beta, phases tirees par rnd01.
+   Le resultat est periodique (raccord parfait en x et en y).
+   work : spectral_fbm_work(N) doubles fournis par l'appelant, ou 0 pour
+   les allouer ici. Retourne 0, ou -1 si une allocation echoue. */
+static int spectral_fbm(double *out, int N, double beta, double amp, double (*rnd01)(void),
+                        double *work) {
+    int half = N / 2, hs = half + 1;
+    int kx, ky, c0;
+    double *sre, *sim, *scratch, *own = 0;
+    FftPlan pc, ph;
+
+    if (N < 2) { out[0] = 0.0; return 0; }
+    pc.rev = 0; pc.cs = 0; pc.sn = 0;
+    ph.rev = 0; ph.cs = 0; ph.sn = 0;
+    if (!work) work = own = (double*)malloc(spectral_fbm_work(N) * sizeof(double));
+    if (!work || fft_plan_init(&pc, N) != 0 || fft_plan_init(&ph, half) != 0) {
+        free(own); fft_plan_free(&pc); fft_plan_free(&ph);
+        return -1;
+    }
+    sre = work;
+    sim = sre + (size_t)N * (size_t)hs;
+    scratch = sim + (size_t)N * (size_t)hs;
+
+    /* Demi-spectre, tirage sequentiel pour rester reproductible */
+    for (ky = 0; ky < N; ++ky) {
+        double fy = (double)((ky <= half) ? ky : ky - N);
+        for (kx = 0; kx < hs; ++kx) {
+            size_t o = (size_t)ky * (size_t)hs + (size_t)kx;
+            double f2 = (double)kx * (double)kx + fy * fy;
+            double ph_ = 2.0 * FFT_PI * rnd01();
+            double a = (f2 > 0.0) ? amp * pow(f2, -0.25 * beta) : 0.0;
+            sre[o] = a * cos(ph_);
+            sim[o] = a * sin(ph_);
+        }
+    }
+    /* Colonnes kx = 0 et kx = N/2 : symetrie hermitienne en ky */
+    for (kx = 0; kx < hs; kx += half) {
+        for (ky = half + 1; ky < N; ++ky) {
+            size_t o = (size_t)ky * (size_t)hs + (size_t)kx;
+            size_t m = (size_t)(N - ky) * (size_t)hs + (size_t)kx;
+            sre[o] = sre[m];
+            sim[o] = -sim[m];
+        }
+        sim[kx] = 0.0;
+        sim[(size_t)half * (size_t)hs + (size_t)kx] = 0.0;
+    }
+
+    /* FFT inverse des colonnes, par blocs */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (c0 = 0; c0 < hs; c0 += FFT_BLOCK) {
+        int cnt = (hs - c0 < FFT_BLOCK) ? hs - c0 : FFT_BLOCK;
+        double t0 = tr_begin();
+        fft_inverse_columns(&pc, sre + c0, sim + c0, (size_t)hs, cnt);
+        tr_end("tile", "fft-cols", t0, c0, cnt);
+    }
+
+    /* FFT inverse reelle des lignes, un tampon de N doubles par thread */
+    {
+        int y;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            double t0 = tr_begin();
+            long first = -1, count = 0;
+#ifdef _OPENMP
+#pragma omp for schedule(static, tn_rows(N)) nowait
+#endif
+            for (y = 0; y < N; ++y) {
+                double *z = scratch + (size_t)fft_thread_id() * (size_t)N;
+                size_t o = (size_t)y * (size_t)hs;
+                fft_inverse_real_row(&pc, &ph, sre + o, sim + o, z, z + half,
+                                     out + (size_t)y * (size_t)N);
+                if (count++ == 0) first = y;
+            }
+            tr_end("band", "fft-rows", t0, first, count);
+        }
+    }
+
+    free(own);
+    fft_plan_free(&pc);
+    fft_plan_free(&ph);
+    return 0;
+}
+
+#endif /* FFT_H */
@@ -0,0 +1,33 @@
+#!/bin/sh
+# fractale-tune.sh — compile plasma et fractale puis mesure, sur cette
+# machine, le nombre de threads et la hauteur des bandes de lignes
+# (plasma --tune : reechantillonnage et flou) et le nombre de threads et la
+# taille des tuiles du temps d'echappement (fractale --tune). Les reglages
+# retenus vont dans le profil lu au demarrage par plasma, geo, fractale et
+# serveur (voir tune.h).
+#
+# Usage :
+#   ./fractale-tune.sh                      profil dans ~/.fractale-tune
+#   FRACTALE_TUNE=/etc/fractale.tune ./fractale-tune.sh
+#   CC=clang CFLAGS="-std=c89 -O3 -fopenmp" ./fractale-tune.sh
+#
+# A relancer apres un changement de machine, de compilateur ou d'options de
+# compilation : un profil d'une autre machine est ignore. Les binaires vont
+# dans $TUNE_DIR (defaut tune-build/). Les options sont transmises aux deux
+# outils (ex. --force-isa avx2).
+
+set -e
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-std=c89 -O2 -fopenmp"}
+TUNE_DIR=${TUNE_DIR:-tune-build}
+SRC=$(cd "$(dirname "$0")" && pwd)
+
+mkdir -p "$TUNE_DIR"
+for t in plasma fractale; do
+    $CC $CFLAGS "$SRC/$t.c" -o "$TUNE_DIR/$t" -lm
+done
+
+"$TUNE_DIR/plasma" --tune "$@"
+"$TUNE_DIR/fractale" --tune "$@"
+echo "profil : ${FRACTALE_TUNE:-$HOME/.fractale-tune}" >&2
@@ -1,32 +1,119 @@
 /*
- * Fractale ASCII 20x20 (triangle de Sierpinski via "chaos game")
- * C ANSI (C89) uniquement : stdio.h, stdlib.h, string.h
+ * Fractale ASCII (triangle de Sierpinski via "chaos game"), 20x20 par defaut,
+ * et fractales a temps d'echappement (Mandelbrot / Julia)
+ * C ANSI C89 (stdio.h, stdlib.h, string.h, math.h), intrinsics SIMD via
+ * isa.h (une variante par jeu d'instructions, choisie au demarrage), en-tetes
+ * partages timing.h, trace.h, bench.h, checksum.h, tune.h et term.h.
+ * OpenMP facultatif : compile avec -fopenmp, tuiles d'echappement en
+ * parallele (-j) ; sans, un seul thread.
  *
  * Paramètres via la ligne de commande :
+ *   -x, --width N         : largeur de la grille (defaut 20)
+ *   -y, --height N        : hauteur de la grille (defaut 20)
  *   -s, --seed N          : graine (entier non signé)
  *   -n, --iter N          : itérations (entier)
  *   -r, --ratio a/b       : ratio de rapprochement (entiers a et b, b>0)
  *   -w, --weights a,b,c   : poids des sommets (entiers >=0)
  *   -u, --warmup N        : itérations ignorées au début
  *   -p, --palette "chars" : jeu de caractères pour la densité
+ *   -m, --mode M          : chaos (defaut), mandel ou julia
+ *   -i, --max-iter N      : iterations max. (mandel/julia, defaut 256,
+ *                           au plus 2^24)
+ *   -c, --julia re,im     : constante de Julia (defaut -0.8,0.156)
+ *       --center re,im    : centre de la vue (mandel/julia)
+ *       --span R          : largeur de la vue dans le plan complexe
+ *   -o, --out PATH        : image PPM au lieu de l'ASCII
+ *       --term M          : truecolor ou 256 : demi-blocs colores (couleurs
+ *                           du PPM) au lieu de l'ASCII, deux lignes par
+ *                           caractere (term.h)
+ *       --timings[=json]  : temps mur/CPU et debit par etape sur stderr
+ *       --trace PATH      : evenements de trace Chrome (JSON) dans PATH
+ *       --counters        : compteurs materiels par etape (Linux)
+ *       --force-isa I     : variante scalar, sse2, avx2 ou avx512 (defaut :
+ *                           la meilleure du processeur, voir isa.h)
+ *       --checksum[=Q]    : CRC-32 des compteurs (chaos) ou des temps
+ *                           d'echappement a 1/Q pres, sur stderr
+ *       --bench[=k1,k2]   : microbenchmarks chaos, escape_render, write_ppm
+ *                           (JSON, tailles --bench-sizes, voir bench.h)
+ *       --tune            : mesure threads et taille des tuiles d'echappement,
+ *                           les range dans le profil de la machine (tune.h)
+ *   -j, --threads N       : threads (si compile avec -fopenmp ; defaut : le
+ *                           profil de fractale-tune.sh s'il existe)
  *   -h, --help            : afficher l'aide
  *
  * Compilation :
- *   cc -std=c89 -Wall -Wextra -O2 fractale.c -o fractale
+ *   cc -std=c89 -Wall -Wextra -O2 fractale.c -o fractale -lm
+ *   cc -std=c89 -Wall -Wextra -O2 -fopenmp fractale.c -o fractale -lm
  * Exemples :
  *   ./fractale -s 42 -n 8000 -r 1/2 -w 3,1,1 -u 20 -p " .:-=+*#%@"
  *   ./fractale --seed 2025 --iter 6000 --ratio 2/3 --weights 1,1,5
+ *   ./fractale -m mandel -x 1920 -y 1080 -i 1000 -o mandel.ppm
+ *   ./fractale -m julia -c -0.4,0.6 -x 80 -y 40
+ *
+ * Histogramme des impacts : pour les grandes grilles (8k x 8k), un tableau
+ * de compteurs ligne par ligne provoque un defaut de cache a chaque
+ * iteration. Les compteurs sont donc ranges par tuiles 64x64 en ordre de
+ * Morton (Z-order), sur 16 bits, avec une tuile de debordement 32 bits
+ * allouee seulement si un compteur sature. Les impacts passent par une
+ * petite file par tuile videe par lots ; la conversion vers l'ordre ligne
+ * par ligne n'a lieu qu'au moment du rendu.
+ *
+ * Temps d'echappement : l'image est decoupee en tuiles 32x32 (ou le cote
+ * du profil, tune.h) distribuees dynamiquement sur les threads OpenMP. Sur x86, 2, 4 ou 8 pixels sont
+ * iteres par vecteur (SSE2, AVX2, AVX-512, variante choisie au demarrage).
+ * Les points de la cardioide principale et du bulbe de periode 2 sont
+ * ecartes d'emblee, et une detection de periodicite (Brent)
+ * arrete les orbites qui bouclent. Les couleurs PPM proviennent d'une
+ * table de degrade indexee par le nombre d'iterations lisse.
  */
 
+/* clock_gettime (timing.h) */
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "isa.h"
+#if ISA_X86
+#include <immintrin.h>
+#endif
+#include "timing.h"
+#include "bench.h"
+#include "checksum.h"
+#include "tune.h"
+#include "term.h"
+
+/* Taille par defaut : 20x20 */
+#define DEFAULT_WIDTH  20
+#define DEFAULT_HEIGHT 20
 
-/* Taille fixe demandée : 20x20 */
-#define WIDTH  20
-#define HEIGHT 20
+/* Histogramme : tuiles 2^HT_SHIFT de cote, file de HT_QUEUE impacts par tuile */
+#define HT_SHIFT 6
+#define HT_SIDE  (1 << HT_SHIFT)
+#define HT_MASK  (HT_SIDE - 1)
+#define HT_CELLS (HT_SIDE * HT_SIDE)
+#define HT_QUEUE 32
+#define HT_SAT   65535U
+
+/* Temps d'echappement */
+#define MODE_CHAOS  0
+#define MODE_MANDEL 1
+#define MODE_JULIA  2
+#define ESC_TILE        32
+#define ESC_BAILOUT2    65536.0     /* rayon 256 : lissage plus regulier */
+#define ESC_PERIOD0     8
+#define ESC_PERIOD_EPS  1e-12
+#define ESC_LUT_SIZE    1024        /* puissance de 2 */
+#define ESC_LUT_SPEED   8.0         /* entrees de table par iteration */
+#define ESC_MAX_ITER    (1L << 24)  /* borne de -i */
 
 /* Valeurs par défaut */
+static int           WIDTH      = DEFAULT_WIDTH;
+static int           HEIGHT     = DEFAULT_HEIGHT;
 static unsigned long SEED       = 12345UL;
 static long          ITERATIONS = 5000L;
 static int           RATIO_NUM  = 1;
@@ -34,18 +121,57 @@ static int           RATIO_DEN  = 2;
 static int           W0 = 1, W1 = 1, W2 = 1;
 static int           WARMUP     = 10;
 static const char   *PALETTE    = " .:-=+*#%@";
+static int           MODE       = MODE_CHAOS;
+static int           MAX_ITER   = 256;
+static double        JULIA_RE   = -0.8, JULIA_IM = 0.156;
+static double        CENTER_RE  = 0.0,  CENTER_IM = 0.0;
+static int           CENTER_SET = 0;
+static double        SPAN       = 3.0;
+static const char   *OUT_PATH   = 0;
+static int           TIMINGS_MODE = TM_OFF; /* --timings[=table|json] */
+static Timings       TIMINGS;
+static const char   *TRACE_PATH = 0;    /* --trace PATH */
+static int           COUNTERS_ON = 0;   /* --counters */
+static const char   *FORCE_ISA  = 0;    /* --force-isa, 0 : detection */
+static double        CHECKSUM_Q = 0.0;  /* --checksum[=Q], 0 : sans */
+static int           TUNE_RUN   = 0;    /* --tune */
+static int           TERM_MODE  = TT_NONE; /* --term */
 
 /* Affiche l'aide et quitte. */
 static void print_usage(const char *prog) {
     fprintf(stderr,
         "Usage: %s [options]\n"
         "Options:\n"
+        "  -x, --width N         largeur de la grille (defaut 20)\n"
+        "  -y, --height N        hauteur de la grille (defaut 20)\n"
         "  -s, --seed N          graine aleatoire (unsigned long)\n"
         "  -n, --iter N          nombre d'iterations (long)\n"
         "  -r, --ratio a/b       ratio de rapprochement vers le sommet\n"
         "  -w, --weights a,b,c   poids des 3 sommets\n"
         "  -u, --warmup N        iterations ignorees au debut\n"
         "  -p, --palette CHARS   jeu de caracteres pour la densite\n"
+        "  -m, --mode M          chaos (defaut), mandel ou julia\n"
+        "  -i, --max-iter N      iterations max. pour mandel/julia (defaut 256,\n"
+        "                        au plus 16777216)\n"
+        "  -c, --julia re,im     constante de Julia (defaut -0.8,0.156)\n"
+        "      --center re,im    centre de la vue (mandel/julia)\n"
+        "      --span R          largeur de la vue (defaut 3.0)\n"
+        "  -o, --out PATH        ecrit une image PPM au lieu de l'ASCII\n"
+        "      --term M          demi-blocs colores, truecolor (24 bits) ou 256\n"
+        "                        couleurs, au lieu de l'ASCII\n"
+        "      --timings[=json]  temps mur/CPU et debit par etape sur stderr\n"
+        "      --trace PATH      trace Chrome (chrome://tracing, Perfetto) dans PATH\n"
+        "      --counters        compteurs materiels par etape (perf_event_open, Linux)\n"
+        "      --force-isa I     scalar, sse2, avx2 ou avx512 (defaut : cpuid)\n"
+        "      --checksum[=Q]    CRC-32 des compteurs ou temps d'echappement (1/Q)\n"
+        "      --bench[=k1,k2]   microbenchmarks (JSON) : chaos, escape_render, write_ppm\n"
+        "      --bench-sizes L   cotes des grilles mesurees (defaut 256,1024,4096)\n"
+        "      --bench-reps N    repetitions (defaut 5) ; --bench-warmup N (defaut 1)\n"
+        "      --bench-baseline F reference JSON, regression au-dela de\n"
+        "                        --bench-tolerance %% (defaut 10)\n"
+        "      --tune            mesurer threads et tuiles d'echappement, les ranger\n"
+        "                        dans le profil ($FRACTALE_TUNE, ~/.fractale-tune)\n"
+        "  -j, --threads N       nombre de threads (avec -fopenmp ; defaut : profil)\n"
         "  -h, --help            affiche cette aide\n",
         prog
     );
@@ -97,6 +223,22 @@ static int parse_weights(const char *s, int *w0, int *w1, int *w2) {
     return 0;
 }
 
+/* Parse re,im dans *re,*im. Retourne 0 si OK, -1 sinon. */
+static int parse_complex(const char *s, double *re, double *im) {
+    const char *c = strchr(s, ',');
+    char *endptr;
+    double a, b;
+
+    if (!c) return -1;
+    a = strtod(s, &endptr);
+    if (endptr != c) return -1;
+    b = strtod(c + 1, &endptr);
+    if (*endptr != '\0') return -1;
+
+    *re = a; *im = b;
+    return 0;
+}
+
 /* Sélectionne un sommet 0,1,2 selon des poids entiers positifs. */
 static int choose_vertex(int w0, int w1, int w2) {
     int sum = w0 + w1 + w2;
@@ -111,16 +253,708 @@ static int choose_vertex(int w0, int w1, int w2) {
     return 2;
 }
 
-int main(int argc, char **argv) {
-    /* Grille de compteurs pour mapping densite -> palette */
-    int hits[HEIGHT][WIDTH];
+/* ====== Histogramme tuile (ordre de Morton) ====== */
+
+typedef struct {
+    int W, H;
+    int tiles_x, tiles_y;
+    size_t ntiles;
+    unsigned short *cnt;     /* ntiles * HT_CELLS compteurs 16 bits */
+    unsigned long **spill;   /* par tuile : 0 ou HT_CELLS reports de debordement */
+    unsigned short *queue;   /* ntiles * HT_QUEUE offsets Morton en attente */
+    unsigned char *qlen;     /* nombre d'impacts en attente par tuile */
+} Histo;
+
+/* Bits de x (resp. y) intercales sur les positions paires (resp. impaires) */
+static unsigned short morton_x[HT_SIDE];
+static unsigned short morton_y[HT_SIDE];
+
+static void morton_init(void) {
+    int i, b;
+    for (i = 0; i < HT_SIDE; ++i) {
+        unsigned int m = 0;
+        for (b = 0; b < HT_SHIFT; ++b) {
+            if (i & (1 << b)) m |= 1U << (2 * b);
+        }
+        morton_x[i] = (unsigned short)m;
+        morton_y[i] = (unsigned short)(m << 1);
+    }
+}
+
+static void histo_free(Histo *h) {
+    size_t t;
+    if (h->spill) {
+        for (t = 0; t < h->ntiles; ++t) free(h->spill[t]);
+    }
+    free(h->spill);
+    free(h->cnt);
+    free(h->queue);
+    free(h->qlen);
+}
+
+/* Retourne 0 si OK, -1 si allocation impossible. */
+static int histo_init(Histo *h, int W, int H) {
+    size_t cells;
+
+    h->W = W;
+    h->H = H;
+    h->tiles_x = (W + HT_MASK) >> HT_SHIFT;
+    h->tiles_y = (H + HT_MASK) >> HT_SHIFT;
+    h->ntiles = (size_t)h->tiles_x * (size_t)h->tiles_y;
+    cells = h->ntiles * HT_CELLS;
+
+    h->cnt   = (unsigned short*)calloc(cells, sizeof(unsigned short));
+    h->spill = (unsigned long**)calloc(h->ntiles, sizeof(unsigned long*));
+    h->queue = (unsigned short*)malloc(h->ntiles * HT_QUEUE * sizeof(unsigned short));
+    h->qlen  = (unsigned char*)calloc(h->ntiles, 1);
+    if (!h->cnt || !h->spill || !h->queue || !h->qlen) {
+        histo_free(h);
+        return -1;
+    }
+    morton_init();
+    return 0;
+}
+
+/* Applique les impacts en attente d'une tuile. Retourne -1 si un
+   debordement n'a pas pu etre alloue. */
+static int histo_flush_tile(Histo *h, size_t t) {
+    unsigned short *c = h->cnt + t * HT_CELLS;
+    const unsigned short *q = h->queue + t * HT_QUEUE;
+    int i, n = h->qlen[t];
+
+    for (i = 0; i < n; ++i) {
+        unsigned short off = q[i];
+        if (c[off] == HT_SAT) {
+            if (!h->spill[t]) {
+                h->spill[t] = (unsigned long*)calloc(HT_CELLS, sizeof(unsigned long));
+                if (!h->spill[t]) return -1;
+            }
+            h->spill[t][off]++;
+            c[off] = 0;
+        } else {
+            c[off]++;
+        }
+    }
+    h->qlen[t] = 0;
+    return 0;
+}
+
+/* Enregistre un impact en (x,y), suppose dans la grille. */
+static int histo_hit(Histo *h, int x, int y) {
+    size_t t = (size_t)(y >> HT_SHIFT) * (size_t)h->tiles_x + (size_t)(x >> HT_SHIFT);
+    int n = h->qlen[t];
+
+    h->queue[t * HT_QUEUE + n] = (unsigned short)(morton_x[x & HT_MASK] | morton_y[y & HT_MASK]);
+    h->qlen[t] = (unsigned char)(n + 1);
+    if (n + 1 == HT_QUEUE) return histo_flush_tile(h, t);
+    return 0;
+}
+
+static int histo_flush(Histo *h) {
+    size_t t;
+    for (t = 0; t < h->ntiles; ++t) {
+        if (h->qlen[t] > 0 && histo_flush_tile(h, t) != 0) return -1;
+    }
+    return 0;
+}
+
+/* Reconvertit la ligne y en ordre ligne par ligne dans row[0..W-1]. */
+static void histo_row(const Histo *h, int y, unsigned long *row) {
+    int tx, x;
+    size_t trow = (size_t)(y >> HT_SHIFT) * (size_t)h->tiles_x;
+    unsigned short my = morton_y[y & HT_MASK];
+
+    for (tx = 0; tx < h->tiles_x; ++tx) {
+        size_t t = trow + (size_t)tx;
+        const unsigned short *c = h->cnt + t * HT_CELLS;
+        const unsigned long *sp = h->spill[t];
+        int x0 = tx << HT_SHIFT;
+        int x1 = x0 + HT_SIDE; if (x1 > h->W) x1 = h->W;
+        for (x = x0; x < x1; ++x) {
+            unsigned short off = (unsigned short)(morton_x[x & HT_MASK] | my);
+            unsigned long v = c[off];
+            if (sp) v += sp[off] * (HT_SAT + 1UL);
+            row[x] = v;
+        }
+    }
+}
+
+/* Jeu du chaos : iterations pas depuis le centre vers les sommets du
+   triangle de la grille, impacts comptes apres WARMUP pas. Retourne le
+   nombre de pas faits (moins que iterations si un debordement de
+   l'histogramme n'a pas pu etre alloue). */
+static long chaos_iterate(Histo *hits, long iterations) {
+    int W = hits->W, H = hits->H;
     int x, y, vx[3], vy[3];
     long i;
+
+    /* Sommets du triangle dans la grille */
+    vx[0] = 0;       vy[0] = H - 1;   /* bas-gauche  */
+    vx[1] = W - 1;   vy[1] = H - 1;   /* bas-droit   */
+    vx[2] = W / 2;   vy[2] = 0;       /* haut-centre */
+
+    /* Graine contrôlée */
+    srand((unsigned)SEED);
+
+    /* Point de départ */
+    x = W / 2;
+    y = H / 2;
+
+    for (i = 0; i < iterations; ++i) {
+        int v = choose_vertex(W0, W1, W2);
+
+        /* Rapprochement vers le sommet choisi, en entier */
+        x = x + ((vx[v] - x) * RATIO_NUM) / RATIO_DEN;
+        y = y + ((vy[v] - y) * RATIO_NUM) / RATIO_DEN;
+
+        if (i >= WARMUP) {
+            if (y >= 0 && y < H && x >= 0 && x < W) {
+                if (histo_hit(hits, x, y) != 0) break;
+            }
+        }
+    }
+    return i;
+}
+
+/* ====== Fractales a temps d'echappement (Mandelbrot / Julia) ====== */
+
+typedef struct {
+    int W, H;
+    int julia;              /* 0: Mandelbrot, 1: Julia */
+    double x0, y0, step;    /* coin haut-gauche et pas d'un pixel */
+    double jr, ji;          /* constante de Julia */
+    int maxit;
+} EscapeView;
+
+/* Valeur lissee mu >= 0 pour un point echappe apres n iterations */
+static float escape_smooth(int n, double r2) {
+    double mu = (double)n + 1.0 - log(log(r2) * 0.5) / log(2.0);
+    if (mu < 0.0) mu = 0.0;
+    return (float)mu;
+}
+
+/* Cardioide principale et bulbe de periode 2 : interieur certain */
+static int in_main_bulbs(double cr, double ci) {
+    double xr = cr - 0.25;
+    double q = xr * xr + ci * ci;
+    if (q * (q + xr) <= 0.25 * ci * ci) return 1;
+    if ((cr + 1.0) * (cr + 1.0) + ci * ci <= 0.0625) return 1;
+    return 0;
+}
+
+/* Un pixel en scalaire. Retourne mu, ou -1 si le point est interieur. */
+static float escape_pixel(const EscapeView *v, double re, double im) {
+    double zr, zi, cr, ci, sr = 0.0, si = 0.0;
+    int it, check = ESC_PERIOD0;
+
+    if (v->julia) {
+        zr = re; zi = im; cr = v->jr; ci = v->ji;
+    } else {
+        if (in_main_bulbs(re, im)) return -1.0f;
+        zr = 0.0; zi = 0.0; cr = re; ci = im;
+    }
+    for (it = 0; it < v->maxit; ++it) {
+        double zr2 = zr * zr, zi2 = zi * zi;
+        double r2 = zr2 + zi2;
+        if (r2 > ESC_BAILOUT2) return escape_smooth(it, r2);
+        zi = 2.0 * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+        /* Periodicite (Brent) : orbite revenue sur un point memorise */
+        if (fabs(zr - sr) < ESC_PERIOD_EPS && fabs(zi - si) < ESC_PERIOD_EPS) return -1.0f;
+        if (it == check) { sr = zr; si = zi; check <<= 1; }
+    }
+    return -1.0f;
+}
+
+#if ISA_X86
+/* Variantes vectorielles de escape_pixel, selectionnees au demarrage
+   (escape_select) : 2, 4 ou 8 pixels par vecteur, memes operations et
+   meme ordre que le scalaire, donc memes valeurs. Une voie sort des qu'elle
+   s'echappe ou boucle ; le vecteur continue tant qu'une voie reste active. */
+
+ISA_TARGET_SSE2 static void escape_span_sse2(const EscapeView *v, double im, int x, float *out) {
+    double res[2], fr2[2], fit[2];
+    __m128d re, zr, zi, cr, ci;
+    __m128d sr = _mm_setzero_pd(), si = _mm_setzero_pd();
+    __m128d bail = _mm_set1_pd(ESC_BAILOUT2);
+    __m128d eps = _mm_set1_pd(ESC_PERIOD_EPS);
+    __m128d sign = _mm_set1_pd(-0.0);
+    __m128d active = _mm_castsi128_pd(_mm_set1_epi32(-1));
+    __m128d iters = _mm_set1_pd(-1.0), lastr2 = _mm_setzero_pd();
+    int it, l, check = ESC_PERIOD0;
+
+    for (l = 0; l < 2; ++l) res[l] = v->x0 + (double)(x + l) * v->step;
+    re = _mm_loadu_pd(res);
+    if (v->julia) {
+        zr = re; zi = _mm_set1_pd(im);
+        cr = _mm_set1_pd(v->jr); ci = _mm_set1_pd(v->ji);
+    } else {
+        double in[2];
+        for (l = 0; l < 2; ++l) in[l] = in_main_bulbs(res[l], im) ? 0.0 : -1.0;
+        active = _mm_cmpneq_pd(_mm_loadu_pd(in), _mm_setzero_pd());
+        zr = _mm_setzero_pd(); zi = _mm_setzero_pd();
+        cr = re; ci = _mm_set1_pd(im);
+    }
+
+    for (it = 0; it < v->maxit && _mm_movemask_pd(active); ++it) {
+        __m128d zr2 = _mm_mul_pd(zr, zr), zi2 = _mm_mul_pd(zi, zi);
+        __m128d r2 = _mm_add_pd(zr2, zi2);
+        __m128d esc = _mm_and_pd(_mm_cmpgt_pd(r2, bail), active);
+        __m128d per;
+        if (_mm_movemask_pd(esc)) {
+            iters = _mm_or_pd(_mm_and_pd(esc, _mm_set1_pd((double)it)), _mm_andnot_pd(esc, iters));
+            lastr2 = _mm_or_pd(_mm_and_pd(esc, r2), _mm_andnot_pd(esc, lastr2));
+            active = _mm_andnot_pd(esc, active);
+        }
+        zi = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(_mm_set1_pd(2.0), zr), zi), ci);
+        zr = _mm_add_pd(_mm_sub_pd(zr2, zi2), cr);
+        per = _mm_and_pd(_mm_cmplt_pd(_mm_andnot_pd(sign, _mm_sub_pd(zr, sr)), eps),
+                         _mm_cmplt_pd(_mm_andnot_pd(sign, _mm_sub_pd(zi, si)), eps));
+        active = _mm_andnot_pd(per, active);
+        if (it == check) { sr = zr; si = zi; check <<= 1; }
+    }
+
+    _mm_storeu_pd(fit, iters);
+    _mm_storeu_pd(fr2, lastr2);
+    for (l = 0; l < 2; ++l) {
+        out[l] = (fit[l] < 0.0) ? -1.0f : escape_smooth((int)fit[l], fr2[l]);
+    }
+}
+
+ISA_TARGET_AVX2 static void escape_span_avx2(const EscapeView *v, double im, int x, float *out) {
+    double res[4], fr2[4], fit[4];
+    __m256d re, zr, zi, cr, ci;
+    __m256d sr = _mm256_setzero_pd(), si = _mm256_setzero_pd();
+    __m256d bail = _mm256_set1_pd(ESC_BAILOUT2);
+    __m256d eps = _mm256_set1_pd(ESC_PERIOD_EPS);
+    __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d active = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+    __m256d iters = _mm256_set1_pd(-1.0), lastr2 = _mm256_setzero_pd();
+    int it, l, check = ESC_PERIOD0;
+
+    for (l = 0; l < 4; ++l) res[l] = v->x0 + (double)(x + l) * v->step;
+    re = _mm256_loadu_pd(res);
+    if (v->julia) {
+        zr = re; zi = _mm256_set1_pd(im);
+        cr = _mm256_set1_pd(v->jr); ci = _mm256_set1_pd(v->ji);
+    } else {
+        double in[4];
+        for (l = 0; l < 4; ++l) in[l] = in_main_bulbs(res[l], im) ? 0.0 : -1.0;
+        active = _mm256_cmp_pd(_mm256_loadu_pd(in), _mm256_setzero_pd(), _CMP_NEQ_UQ);
+        zr = _mm256_setzero_pd(); zi = _mm256_setzero_pd();
+        cr = re; ci = _mm256_set1_pd(im);
+    }
+
+    for (it = 0; it < v->maxit && _mm256_movemask_pd(active); ++it) {
+        __m256d zr2 = _mm256_mul_pd(zr, zr), zi2 = _mm256_mul_pd(zi, zi);
+        __m256d r2 = _mm256_add_pd(zr2, zi2);
+        __m256d esc = _mm256_and_pd(_mm256_cmp_pd(r2, bail, _CMP_GT_OQ), active);
+        __m256d per;
+        if (_mm256_movemask_pd(esc)) {
+            iters = _mm256_blendv_pd(iters, _mm256_set1_pd((double)it), esc);
+            lastr2 = _mm256_blendv_pd(lastr2, r2, esc);
+            active = _mm256_andnot_pd(esc, active);
+        }
+        zi = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), zr), zi), ci);
+        zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+        per = _mm256_and_pd(
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(zr, sr)), eps, _CMP_LT_OQ),
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(zi, si)), eps, _CMP_LT_OQ));
+        active = _mm256_andnot_pd(per, active);
+        if (it == check) { sr = zr; si = zi; check <<= 1; }
+    }
+
+    _mm256_storeu_pd(fit, iters);
+    _mm256_storeu_pd(fr2, lastr2);
+    for (l = 0; l < 4; ++l) {
+        out[l] = (fit[l] < 0.0) ? -1.0f : escape_smooth((int)fit[l], fr2[l]);
+    }
+}
+
+/* AVX-512 : voies actives dans un masque __mmask8 */
+ISA_TARGET_AVX512 static void escape_span_avx512(const EscapeView *v, double im, int x, float *out) {
+    double res[8], fr2[8], fit[8];
+    __m512d re, zr, zi, cr, ci;
+    __m512d sr = _mm512_setzero_pd(), si = _mm512_setzero_pd();
+    __m512d bail = _mm512_set1_pd(ESC_BAILOUT2);
+    __m512d eps = _mm512_set1_pd(ESC_PERIOD_EPS);
+    __m512d iters = _mm512_set1_pd(-1.0), lastr2 = _mm512_setzero_pd();
+    __mmask8 active = 0xFF;
+    int it, l, check = ESC_PERIOD0;
+
+    for (l = 0; l < 8; ++l) res[l] = v->x0 + (double)(x + l) * v->step;
+    re = _mm512_loadu_pd(res);
+    if (v->julia) {
+        zr = re; zi = _mm512_set1_pd(im);
+        cr = _mm512_set1_pd(v->jr); ci = _mm512_set1_pd(v->ji);
+    } else {
+        active = 0;
+        for (l = 0; l < 8; ++l) if (!in_main_bulbs(res[l], im)) active |= (__mmask8)(1 << l);
+        zr = _mm512_setzero_pd(); zi = _mm512_setzero_pd();
+        cr = re; ci = _mm512_set1_pd(im);
+    }
+
+    for (it = 0; it < v->maxit && active; ++it) {
+        __m512d zr2 = _mm512_mul_pd(zr, zr), zi2 = _mm512_mul_pd(zi, zi);
+        __m512d r2 = _mm512_add_pd(zr2, zi2);
+        __mmask8 esc = _mm512_mask_cmp_pd_mask(active, r2, bail, _CMP_GT_OQ);
+        __mmask8 per;
+        if (esc) {
+            iters = _mm512_mask_blend_pd(esc, iters, _mm512_set1_pd((double)it));
+            lastr2 = _mm512_mask_blend_pd(esc, lastr2, r2);
+            active = (__mmask8)(active & ~esc);
+        }
+        zi = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(2.0), zr), zi), ci);
+        zr = _mm512_add_pd(_mm512_sub_pd(zr2, zi2), cr);
+        per = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(zr, sr)), eps, _CMP_LT_OQ)
+            & _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(zi, si)), eps, _CMP_LT_OQ);
+        active = (__mmask8)(active & ~per);
+        if (it == check) { sr = zr; si = zi; check <<= 1; }
+    }
+
+    _mm512_storeu_pd(fit, iters);
+    _mm512_storeu_pd(fr2, lastr2);
+    for (l = 0; l < 8; ++l) {
+        out[l] = (fit[l] < 0.0) ? -1.0f : escape_smooth((int)fit[l], fr2[l]);
+    }
+}
+#endif /* ISA_X86 */
+
+/* Variante vectorielle retenue : ESC_LANES pixels par appel de ESC_SPAN,
+   1 (pas de variante) pour --force-isa scalar ou hors x86 */
+static int ESC_LANES = 1;
+static void (*ESC_SPAN)(const EscapeView *v, double im, int x, float *out) = 0;
+
+static void escape_select(int isa) {
+    ESC_LANES = 1;
+    ESC_SPAN = 0;
+#if ISA_X86
+    switch (isa) {
+    case ISA_AVX512: ESC_LANES = 8; ESC_SPAN = escape_span_avx512; break;
+    case ISA_AVX2:   ESC_LANES = 4; ESC_SPAN = escape_span_avx2; break;
+    case ISA_SSE2:   ESC_LANES = 2; ESC_SPAN = escape_span_sse2; break;
+    default: break;
+    }
+#else
+    (void)isa;
+#endif
+}
+
+/* Calcule une tuile [tx0,tx1) x [ty0,ty1) dans mu[] */
+static void escape_tile(const EscapeView *v, int tx0, int ty0, int tx1, int ty1, float *mu) {
+    int x, y;
+    for (y = ty0; y < ty1; ++y) {
+        double im = v->y0 - (double)y * v->step;
+        float *row = mu + (size_t)y * (size_t)v->W;
+        x = tx0;
+        if (ESC_SPAN) {
+            for (; x + ESC_LANES <= tx1; x += ESC_LANES) ESC_SPAN(v, im, x, row + x);
+        }
+        for (; x < tx1; ++x) {
+            row[x] = escape_pixel(v, v->x0 + (double)x * v->step, im);
+        }
+    }
+}
+
+/* Toutes les tuiles, distribuees dynamiquement : le cout par pixel varie
+   enormement entre l'exterieur et le bord de l'ensemble. */
+static void escape_render(const EscapeView *v, float *mu) {
+    int tile = (TUNE.tile > 0) ? TUNE.tile : ESC_TILE;
+    int tiles_x = (v->W + tile - 1) / tile;
+    int tiles_y = (v->H + tile - 1) / tile;
+    int ntiles = tiles_x * tiles_y;
+    int t;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (t = 0; t < ntiles; ++t) {
+        double t0 = tr_begin();
+        int tx0 = (t % tiles_x) * tile;
+        int ty0 = (t / tiles_x) * tile;
+        int tx1 = tx0 + tile;
+        int ty1 = ty0 + tile;
+        if (tx1 > v->W) tx1 = v->W;
+        if (ty1 > v->H) ty1 = v->H;
+        escape_tile(v, tx0, ty0, tx1, ty1, mu);
+        tr_end("tile", "escape", t0, t, 1);
+    }
+}
+
+/* Table de couleurs lissee : degrade cyclique entre quelques couleurs cles */
+static unsigned char esc_lut[ESC_LUT_SIZE][3];
+
+static void escape_lut_init(void) {
+    static const unsigned char keys[5][3] = {
+        {  0,   7, 100}, { 32, 107, 203}, {237, 255, 255}, {255, 170,   0}, {  0,   2,   0}
+    };
+    int i, c;
+    for (i = 0; i < ESC_LUT_SIZE; ++i) {
+        int seg = (i * 5) / ESC_LUT_SIZE;
+        int nxt = (seg + 1) % 5;
+        double f = (double)(i * 5 - seg * ESC_LUT_SIZE) / (double)ESC_LUT_SIZE;
+        for (c = 0; c < 3; ++c) {
+            esc_lut[i][c] = (unsigned char)((1.0 - f) * keys[seg][c] + f * keys[nxt][c] + 0.5);
+        }
+    }
+}
+
+static void escape_color(float mu, unsigned char *px) {
+    double t;
+    int i0, i1, c;
+    if (mu < 0.0f) { px[0] = px[1] = px[2] = 0; return; }
+    /* reduit avant la conversion : mu * ESC_LUT_SPEED depasse les int
+       pour de grands -i */
+    t = fmod((double)mu * ESC_LUT_SPEED, (double)ESC_LUT_SIZE);
+    i0 = (int)t;
+    t -= (double)i0;
+    i0 &= ESC_LUT_SIZE - 1;
+    i1 = (i0 + 1) & (ESC_LUT_SIZE - 1);
+    for (c = 0; c < 3; ++c) {
+        px[c] = (unsigned char)((1.0 - t) * esc_lut[i0][c] + t * esc_lut[i1][c] + 0.5);
+    }
+}
+
+/* Ecriture PPM binaire P6, une ligne a la fois via row_fn */
+typedef void (*PpmRowFn)(void *ctx, int y, unsigned char *rgb);
+
+static int write_ppm(const char *path, int W, int H, PpmRowFn row_fn, void *ctx) {
+    FILE *f = fopen(path, "wb");
+    unsigned char *rgb;
+    int y;
+    if (!f) {
+        fprintf(stderr, "Impossible d'ouvrir '%s' en ecriture.\n", path);
+        return -1;
+    }
+    rgb = (unsigned char*)malloc((size_t)W * 3);
+    if (!rgb) { fclose(f); return -1; }
+    fprintf(f, "P6\n%d %d\n255\n", W, H);
+    for (y = 0; y < H; ++y) {
+        row_fn(ctx, y, rgb);
+        if (fwrite(rgb, 1, (size_t)W * 3, f) != (size_t)W * 3) {
+            fprintf(stderr, "Erreur d'ecriture PPM.\n");
+            free(rgb);
+            fclose(f);
+            return -1;
+        }
+    }
+    free(rgb);
+    fclose(f);
+    return 0;
+}
+
+typedef struct { const float *mu; int W; } EscapeImage;
+
+static void escape_ppm_row(void *ctx, int y, unsigned char *rgb) {
+    const EscapeImage *im = (const EscapeImage*)ctx;
+    const float *row = im->mu + (size_t)y * (size_t)im->W;
+    int x;
+    for (x = 0; x < im->W; ++x) escape_color(row[x], rgb + 3 * x);
+}
+
+typedef struct { const Histo *hits; unsigned long *line; unsigned long maxhit; } ChaosImage;
+
+static void chaos_ppm_row(void *ctx, int y, unsigned char *rgb) {
+    const ChaosImage *im = (const ChaosImage*)ctx;
+    int x;
+    histo_row(im->hits, y, im->line);
+    for (x = 0; x < im->hits->W; ++x) {
+        unsigned long g = im->maxhit ? (im->line[x] * 255UL) / im->maxhit : 0;
+        rgb[3 * x] = rgb[3 * x + 1] = rgb[3 * x + 2] = (unsigned char)g;
+    }
+}
+
+/* Rendu ASCII : interieur = caractere le plus dense */
+static void escape_print_ascii(const float *mu, int W, int H, int maxit, const char *pal, int pal_len) {
+    int x, y;
+    for (y = 0; y < H; ++y) {
+        for (x = 0; x < W; ++x) {
+            float m = mu[(size_t)y * (size_t)W + x];
+            char c;
+            if (m < 0.0f || pal_len <= 1) {
+                c = pal[pal_len - 1];
+            } else {
+                double t = sqrt((double)m / (double)maxit);
+                int idx = (int)(t * (double)(pal_len - 2) + 0.5);
+                if (idx < 0) idx = 0;
+                if (idx > pal_len - 2) idx = pal_len - 2;
+                c = pal[idx];
+            }
+            putchar(c);
+        }
+        putchar('\n');
+    }
+}
+
+/* Mode Mandelbrot / Julia complet. Retourne le code de sortie. */
+static int run_escape(const char *pal, int pal_len) {
+    EscapeView v;
+    float *mu;
+    int rc = 0;
+
+    v.W = WIDTH;
+    v.H = HEIGHT;
+    v.julia = (MODE == MODE_JULIA);
+    v.step = SPAN / (double)WIDTH;
+    v.x0 = CENTER_RE - 0.5 * (double)(WIDTH - 1) * v.step;
+    v.y0 = CENTER_IM + 0.5 * (double)(HEIGHT - 1) * v.step;
+    v.jr = JULIA_RE;
+    v.ji = JULIA_IM;
+    v.maxit = MAX_ITER;
+
+    mu = (float*)malloc((size_t)WIDTH * (size_t)HEIGHT * sizeof(float));
+    if (!mu) {
+        fprintf(stderr, "Allocation memoire impossible.\n");
+        return 1;
+    }
+    tm_begin(&TIMINGS, "generate");
+    escape_render(&v, mu);
+    tm_end(&TIMINGS, (double)WIDTH * (double)HEIGHT, (double)WIDTH * (double)HEIGHT * sizeof(float));
+    if (CHECKSUM_Q > 0.0) {
+        Crc ck;
+        size_t k, n = (size_t)WIDTH * (size_t)HEIGHT;
+        ck_init(&ck);
+        for (k = 0; k < n; ++k) ck_quant(&ck, (double)mu[k], CHECKSUM_Q);
+        ck_report("fractale", "echappement", &ck, CHECKSUM_Q);
+    }
+
+    tm_begin(&TIMINGS, "write");
+    if (OUT_PATH) {
+        EscapeImage im;
+        im.mu = mu;
+        im.W = WIDTH;
+        escape_lut_init();
+        if (write_ppm(OUT_PATH, WIDTH, HEIGHT, escape_ppm_row, &im) != 0) rc = 1;
+    } else if (TERM_MODE != TT_NONE) {
+        EscapeImage im;
+        im.mu = mu;
+        im.W = WIDTH;
+        escape_lut_init();
+        if (tt_blocks(WIDTH, HEIGHT, escape_ppm_row, &im, TERM_MODE) != 0) {
+            fprintf(stderr, "Allocation memoire impossible.\n");
+            rc = 1;
+        }
+    } else {
+        escape_print_ascii(mu, WIDTH, HEIGHT, MAX_ITER, pal, pal_len);
+        fflush(stdout);
+    }
+    tm_end(&TIMINGS, (double)WIDTH * (double)HEIGHT, (double)WIDTH * (double)HEIGHT * 3.0);
+    free(mu);
+    tm_report(&TIMINGS, stderr);
+    return rc;
+}
+
+/* ====== Microbenchmarks (--bench) ====== */
+
+typedef struct {
+    int S;
+    Histo hits;
+    EscapeView view;
+    float *mu;
+} FractaleBench;
+
+static void bench_chaos(void *ctx) {
+    FractaleBench *b = (FractaleBench*)ctx;
+    chaos_iterate(&b->hits, (long)b->S * (long)b->S);
+    histo_flush(&b->hits);
+}
+
+static void bench_escape(void *ctx) {
+    FractaleBench *b = (FractaleBench*)ctx;
+    escape_render(&b->view, b->mu);
+}
+
+static void bench_write_ppm(void *ctx) {
+    FractaleBench *b = (FractaleBench*)ctx;
+    EscapeImage im;
+    im.mu = b->mu;
+    im.W = b->S;
+    write_ppm(BENCH_NULL, b->S, b->S, escape_ppm_row, &im);
+}
+
+/* Jeu du chaos (S*S pas dans une grille S x S), Mandelbrot S x S avec
+   --max-iter, et ecriture PPM de l'image obtenue */
+static int fractale_bench(void) {
+    int k;
+    bench_begin("fractale", "f64");
+    escape_lut_init();
+    for (k = 0; k < BENCH.nsizes; ++k) {
+        FractaleBench b;
+        int S = BENCH.sizes[k];
+        double c = (double)S * (double)S;
+
+        if (S > 65535) { bench_skip(S, "taille"); continue; }
+        b.S = S;
+        b.mu = (float*)malloc((size_t)S * (size_t)S * sizeof(float));
+        if (!b.mu || histo_init(&b.hits, S, S) != 0) {
+            free(b.mu);
+            bench_skip(S, "memoire");
+            continue;
+        }
+        b.view.W = b.view.H = S;
+        b.view.julia = 0;
+        b.view.step = SPAN / (double)S;
+        b.view.x0 = -0.5 - 0.5 * (double)(S - 1) * b.view.step;
+        b.view.y0 = 0.5 * (double)(S - 1) * b.view.step;
+        b.view.jr = JULIA_RE;
+        b.view.ji = JULIA_IM;
+        b.view.maxit = MAX_ITER;
+
+        bench_run("chaos", S, c, c * sizeof(unsigned short), bench_chaos, &b);
+        bench_run("escape_render", S, c, c * sizeof(float), bench_escape, &b);
+        if (!bench_want("escape_render")) bench_escape(&b);
+        bench_run("write_ppm", S, c, c * 3.0, bench_write_ppm, &b);
+
+        histo_free(&b.hits);
+        free(b.mu);
+    }
+    return bench_end();
+}
+
+/* ====== Reglage (--tune) ====== */
+
+/* Mandelbrot TN_SIDE^2 de --bench : threads, puis cote des tuiles les plus
+   rapides, ranges dans le profil (tune.h) */
+static int fractale_tune(void) {
+    static const int tiles[] = { ESC_TILE, 16, 64, 8, 128 };  /* defaut d'abord */
+    FractaleBench b;
+    int S = TN_SIDE, t, tile;
+
+    b.S = S;
+    b.mu = (float*)malloc((size_t)S * (size_t)S * sizeof(float));
+    if (!b.mu) {
+        fprintf(stderr, "Allocation memoire impossible.\n");
+        return 1;
+    }
+    b.view.W = b.view.H = S;
+    b.view.julia = 0;
+    b.view.step = SPAN / (double)S;
+    b.view.x0 = -0.5 - 0.5 * (double)(S - 1) * b.view.step;
+    b.view.y0 = 0.5 * (double)(S - 1) * b.view.step;
+    b.view.jr = JULIA_RE;
+    b.view.ji = JULIA_IM;
+    b.view.maxit = MAX_ITER;
+
+    TUNE.tile = 0;
+    t = tn_tune_threads("fractale", bench_escape, &b);
+    tile = tn_tune_int("fractale", "tile", &TUNE.tile, tiles, 5, bench_escape, &b);
+    free(b.mu);
+    fprintf(stderr, "fractale : threads.escape %d, tile %d\n", t, tile);
+    if (tn_store("threads.escape", t) != 0 || tn_store("tile", tile) != 0) return 1;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    /* Compteurs d'impacts pour mapping densite -> palette */
+    Histo hits;
+    unsigned long *line;
     int row, col;
-    int maxhit = 0;
+    unsigned long maxhit = 0;
     const char *pal = PALETTE;
     int pal_len = 0;
 
+    tn_init("fractale");
+
     /* Parsing simple de argv pour rester ANSI */
     {
         int idx = 1;
@@ -130,6 +964,14 @@ int main(int argc, char **argv) {
             if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) {
                 print_usage(argv[0]);
                 return 0;
+            } else if ((strcmp(a, "-x") == 0 || strcmp(a, "--width") == 0) && (idx + 1 < argc)) {
+                char *e = 0; long v = strtol(argv[idx + 1], &e, 10);
+                if (*e != '\0' || v <= 0 || v > 65535L) { print_usage(argv[0]); return 1; }
+                WIDTH = (int)v; idx += 2; continue;
+            } else if ((strcmp(a, "-y") == 0 || strcmp(a, "--height") == 0) && (idx + 1 < argc)) {
+                char *e = 0; long v = strtol(argv[idx + 1], &e, 10);
+                if (*e != '\0' || v <= 0 || v > 65535L) { print_usage(argv[0]); return 1; }
+                HEIGHT = (int)v; idx += 2; continue;
             } else if ((strcmp(a, "-s") == 0 || strcmp(a, "--seed") == 0) && (idx + 1 < argc)) {
                 char *e = 0;
                 unsigned long v = strtoul(argv[idx + 1], &e, 10);
@@ -158,6 +1000,68 @@ int main(int argc, char **argv) {
             } else if ((strcmp(a, "-p") == 0 || strcmp(a, "--palette") == 0) && (idx + 1 < argc)) {
                 pal = argv[idx + 1];
                 idx += 2; continue;
+            } else if ((strcmp(a, "-m") == 0 || strcmp(a, "--mode") == 0) && (idx + 1 < argc)) {
+                const char *m = argv[idx + 1];
+                if (strcmp(m, "chaos") == 0) MODE = MODE_CHAOS;
+                else if (strcmp(m, "mandel") == 0) MODE = MODE_MANDEL;
+                else if (strcmp(m, "julia") == 0) MODE = MODE_JULIA;
+                else { print_usage(argv[0]); return 1; }
+                idx += 2; continue;
+            } else if ((strcmp(a, "-i") == 0 || strcmp(a, "--max-iter") == 0) && (idx + 1 < argc)) {
+                char *e = 0; long v = strtol(argv[idx + 1], &e, 10);
+                if (*e != '\0' || v <= 0 || v > ESC_MAX_ITER) { print_usage(argv[0]); return 1; }
+                MAX_ITER = (int)v; idx += 2; continue;
+            } else if ((strcmp(a, "-c") == 0 || strcmp(a, "--julia") == 0) && (idx + 1 < argc)) {
+                if (parse_complex(argv[idx + 1], &JULIA_RE, &JULIA_IM) != 0) {
+                    fprintf(stderr, "Constante invalide. Utiliser re,im.\n");
+                    return 1;
+                }
+                idx += 2; continue;
+            } else if (strcmp(a, "--center") == 0 && (idx + 1 < argc)) {
+                if (parse_complex(argv[idx + 1], &CENTER_RE, &CENTER_IM) != 0) {
+                    fprintf(stderr, "Centre invalide. Utiliser re,im.\n");
+                    return 1;
+                }
+                CENTER_SET = 1; idx += 2; continue;
+            } else if (strcmp(a, "--span") == 0 && (idx + 1 < argc)) {
+                char *e = 0; double v = strtod(argv[idx + 1], &e);
+                if (*e != '\0' || v <= 0.0) { print_usage(argv[0]); return 1; }
+                SPAN = v; idx += 2; continue;
+            } else if ((strcmp(a, "-o") == 0 || strcmp(a, "--out") == 0) && (idx + 1 < argc)) {
+                OUT_PATH = argv[idx + 1];
+                idx += 2; continue;
+            } else if (strncmp(a, "--timings", 9) == 0) {
+                if (tm_parse(a, &TIMINGS_MODE) != 1) { print_usage(argv[0]); return 1; }
+                idx += 1; continue;
+            } else if (strcmp(a, "--trace") == 0 && (idx + 1 < argc)) {
+                TRACE_PATH = argv[idx + 1];
+                idx += 2; continue;
+            } else if (strcmp(a, "--counters") == 0) {
+                COUNTERS_ON = 1;
+                idx += 1; continue;
+            } else if (strcmp(a, "--force-isa") == 0 && (idx + 1 < argc)) {
+                FORCE_ISA = argv[idx + 1];
+                idx += 2; continue;
+            } else if (strncmp(a, "--checksum", 10) == 0) {
+                if (ck_parse(a, &CHECKSUM_Q) != 1) { print_usage(argv[0]); return 1; }
+                idx += 1; continue;
+            } else if (strncmp(a, "--bench", 7) == 0) {
+                if (bench_parse(argc, argv, &idx) != 1) { print_usage(argv[0]); return 1; }
+                continue;
+            } else if (strcmp(a, "--term") == 0 && (idx + 1 < argc)) {
+                TERM_MODE = tt_mode(argv[idx + 1]);
+                if (TERM_MODE == TT_NONE) { print_usage(argv[0]); return 1; }
+                idx += 2; continue;
+            } else if (strcmp(a, "--tune") == 0) {
+                TUNE_RUN = 1;
+                idx += 1; continue;
+            } else if ((strcmp(a, "-j") == 0 || strcmp(a, "--threads") == 0) && (idx + 1 < argc)) {
+                char *e = 0; long v = strtol(argv[idx + 1], &e, 10);
+                if (*e != '\0' || v <= 0) { print_usage(argv[0]); return 1; }
+#ifdef _OPENMP
+                omp_set_num_threads((int)v);
+#endif
+                idx += 2; continue;
             } else {
                 /* Argument inconnu ou valeur manquante */
                 print_usage(argv[0]);
@@ -173,58 +1077,106 @@ int main(int argc, char **argv) {
         pal_len = 10;
     }
 
-    /* Reset des compteurs */
-    for (row = 0; row < HEIGHT; ++row)
-        for (col = 0; col < WIDTH; ++col)
-            hits[row][col] = 0;
+    if (TRACE_PATH && tr_init(TRACE_PATH, "fractale") != 0) {
+        fprintf(stderr, "Impossible d'ouvrir '%s' en ecriture.\n", TRACE_PATH);
+        return 1;
+    }
+    if (isa_init(FORCE_ISA) != 0) return 1;
+    escape_select(ISA.level);
+    if (TUNE_RUN) return fractale_tune();
+    if (BENCH.on) return fractale_bench();
+    if (COUNTERS_ON && ct_init() == 0 && TIMINGS_MODE == TM_OFF) TIMINGS_MODE = TM_TABLE;
+    tm_init(&TIMINGS, "fractale", TIMINGS_MODE);
+    if (MODE != MODE_CHAOS) {
+        if (MODE == MODE_MANDEL && !CENTER_SET) CENTER_RE = -0.5;
+        return run_escape(pal, pal_len);
+    }
 
-    /* Sommets du triangle dans la grille 20x20 */
-    vx[0] = 0;           vy[0] = HEIGHT - 1;   /* bas-gauche  */
-    vx[1] = WIDTH - 1;   vy[1] = HEIGHT - 1;   /* bas-droit   */
-    vx[2] = WIDTH / 2;   vy[2] = 0;            /* haut-centre */
+    /* Compteurs a zero */
+    if (histo_init(&hits, WIDTH, HEIGHT) != 0) {
+        fprintf(stderr, "Allocation memoire impossible.\n");
+        return 1;
+    }
+    line = (unsigned long*)malloc((size_t)WIDTH * sizeof(unsigned long));
+    if (!line) {
+        fprintf(stderr, "Allocation memoire impossible.\n");
+        histo_free(&hits);
+        return 1;
+    }
 
-    /* Graine contrôlée */
-    srand((unsigned)SEED);
+    /* Boucle principale */
+    tm_begin(&TIMINGS, "generate");
+    if (chaos_iterate(&hits, ITERATIONS) < ITERATIONS || histo_flush(&hits) != 0) {
+        fprintf(stderr, "Allocation memoire impossible.\n");
+        free(line);
+        histo_free(&hits);
+        return 1;
+    }
 
-    /* Point de départ */
-    x = WIDTH / 2;
-    y = HEIGHT / 2;
+    tm_end(&TIMINGS, (double)ITERATIONS, 0.0);
 
-    /* Boucle principale */
-    for (i = 0; i < ITERATIONS; ++i) {
-        int v = choose_vertex(W0, W1, W2);
+    /* Maximum des compteurs, une ligne a la fois */
+    tm_begin(&TIMINGS, "normalise");
+    for (row = 0; row < HEIGHT; ++row) {
+        histo_row(&hits, row, line);
+        for (col = 0; col < WIDTH; ++col)
+            if (line[col] > maxhit) maxhit = line[col];
+    }
+    tm_end(&TIMINGS, (double)WIDTH * (double)HEIGHT, (double)WIDTH * (double)HEIGHT * sizeof(unsigned short));
+    if (CHECKSUM_Q > 0.0) {
+        Crc ck;
+        ck_init(&ck);
+        for (row = 0; row < HEIGHT; ++row) {
+            histo_row(&hits, row, line);
+            for (col = 0; col < WIDTH; ++col) ck_u32(&ck, line[col]);
+        }
+        ck_report("fractale", "densite", &ck, CHECKSUM_Q);
+    }
 
-        /* Rapprochement vers le sommet choisi, en entier */
-        x = x + ((vx[v] - x) * RATIO_NUM) / RATIO_DEN;
-        y = y + ((vy[v] - y) * RATIO_NUM) / RATIO_DEN;
+    tm_begin(&TIMINGS, "write");
 
-        if (i >= WARMUP) {
-            if (y >= 0 && y < HEIGHT && x >= 0 && x < WIDTH) {
-                hits[y][x]++;
-                if (hits[y][x] > maxhit) maxhit = hits[y][x];
-            }
+    /* Image PPM ou demi-blocs en niveaux de gris selon densité */
+    if (OUT_PATH || TERM_MODE != TT_NONE) {
+        ChaosImage im;
+        int rc;
+        im.hits = &hits;
+        im.line = line;
+        im.maxhit = maxhit;
+        if (OUT_PATH) rc = write_ppm(OUT_PATH, WIDTH, HEIGHT, chaos_ppm_row, &im);
+        else if ((rc = tt_blocks(WIDTH, HEIGHT, chaos_ppm_row, &im, TERM_MODE)) != 0) {
+            fprintf(stderr, "Allocation memoire impossible.\n");
         }
+        tm_end(&TIMINGS, (double)WIDTH * (double)HEIGHT, (double)WIDTH * (double)HEIGHT * 3.0);
+        free(line);
+        histo_free(&hits);
+        tm_report(&TIMINGS, stderr);
+        return rc != 0;
     }
 
     /* Rendu ASCII selon densité */
     for (row = 0; row < HEIGHT; ++row) {
+        histo_row(&hits, row, line);
         for (col = 0; col < WIDTH; ++col) {
             char c;
-            int h = hits[row][col];
-            if (h <= 0) {
+            unsigned long h = line[col];
+            if (h == 0) {
                 c = pal[0];
-            } else if (maxhit <= 0 || pal_len <= 1) {
+            } else if (maxhit == 0 || pal_len <= 1) {
                 c = '#';
             } else {
-                int idx = (h * (pal_len - 1)) / maxhit;
-                if (idx < 0) idx = 0;
-                if (idx >= pal_len) idx = pal_len - 1;
+                unsigned long idx = (h * (unsigned long)(pal_len - 1)) / maxhit;
+                if (idx >= (unsigned long)pal_len) idx = (unsigned long)(pal_len - 1);
                 c = pal[idx];
             }
             putchar(c);
         }
         putchar('\n');
     }
+    fflush(stdout);
+    tm_end(&TIMINGS, (double)WIDTH * (double)HEIGHT, (double)WIDTH * (double)HEIGHT);
 
+    free(line);
+    histo_free(&hits);
+    tm_report(&TIMINGS, stderr);
     return 0;
 }
@@ -4,16 +4,49 @@
  *
  * Fonctionnalites :
  *  - Generation d'une heightmap 0..1 (diamond-square) resamplee en WxH arbitraire
+ *  - Ou synthese spectrale (--generator fft, voir fft.h) : fBm de spectre 1/f^beta,
+ *    beta = 2 - 2 log2(k) par defaut, normalise dans 0..1
  *  - Adoucissement optionnel (flou boite 3x3, passes multiples)
+ *  - --wrap : carte periodique (diamond-square torique, reechantillonnage et flou
+ *    replies), les tuiles se raccordent sans couture
+ *  - --precision f32|u16 : grilles stockees en float ou en entiers 16 bits
+ *    (valeur/65535) ; memoire divisee par 2 ou 4. Ecart sur les hauteurs par
+ *    rapport a f64 : f32 <= 1e-6, u16 <= 3e-5 (2 pas de quantification) ;
+ *    une cellule a moins de cet ecart du niveau d'eau peut changer d'etat
+ *  - Memoire : une arene (arena.h) reservee au depart, reutilisee d'une etape
+ *    a l'autre ; --mem-stats en affiche l'occupation par etape. Grandes
+ *    grilles en pages enormes ; avec -fopenmp, --numa bands (defaut) fait
+ *    ecrire chaque bande de lignes d'abord par le thread qui la traite
+ *  - --timings[=json] : temps mur et CPU, debit par etape, sur stderr
+ *  - --trace PATH : evenements de trace Chrome (etapes, bandes, blocs FFT)
+ *  - --counters : cycles, instructions, defauts de cache par etape (Linux)
+ *  - --bench[=k1,k2] : microbenchmarks diamond_square, resample_bilinear,
+ *    smooth_box, print_values, flood, colour, write_ppm (bench.h)
+ *  - --checksum[=Q] : CRC-32 de la carte (a 1/Q pres), du masque d'eau et du PPM
+ *  - --force-isa I : reechantillonnage et lissage en scalar, sse2, avx2 ou
+ *    avx512 (defaut : detection cpuid, isa.h) ; resultats identiques
+ *  - --cache DIR : etapes (grille DS, carte, carte lissee, inondation) gardees
+ *    sur disque (stcache.h) ; un lancement suivant reprend a la plus avancee
+ *    dont les parametres n'ont pas change (ex. seul --sea modifie)
+ *  - --progressive PATH : apercus PPM des niveaux du diamond-square ecrits
+ *    pendant la generation (preview.h), un par niveau si PATH contient %d
+ *  - --deadline MS : budget de temps ; grille DS plus grossiere puis moins de
+ *    passes d'adoucissement si l'estimation deborde (deadline.h, couts de
+ *    --bench ou du fichier --deadline-model F)
+ *  - Threads et bandes de lignes OpenMP : profil de la machine (tune.h),
+ *    ecrit par fractale-tune.sh ; -j prime
  *  - Simulation d'eau : seuil "sea level" et remplissage par inondation
  *       * --from-edge : l'eau envahit depuis les bords, uniquement les cellules <= niveau
  *       * --fill-all  : toute cellule <= niveau devient eau (sans contrainte de connectivite)
  *       * --seed x,y  : point de depart optionnel pour l'inondation (ajoute aux bords si --from-edge)
  *  - Sortie : PPM couleur (--out map.ppm) et/ou valeurs texte (--only-values)
+ *  - --term truecolor|256 : la carte couleur en demi-blocs dans le terminal
+ *    (term.h), deux lignes par caractere, a la place des valeurs texte
  *  - Option --values-with-water : imprime la heightmap "remplie" (h' = max(h, sea_level) pour les cellules eau)
  *
  * Compilation :
  *   cc -std=c89 -Wall -Wextra -O2 geo.c -o geo -lm
+ *   cc -std=c89 -Wall -Wextra -O2 -fopenmp geo.c -o geo -lm   (multi-thread)
  *
  * Exemples :
  *   # Carte couleur avec ocean depuis les bords au niveau 0.45
@@ -26,15 +59,40 @@
  *   ./geo -x 200 -y 150 -s 123 --sea 0.40 --fill-all -o map.ppm
  */
 
+/* madvise (arena.h) */
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "fft.h"
+#include "memsize.h"
+#include "arena.h"
+#include "timing.h"
+#include "bench.h"
+#include "checksum.h"
+#include "isa.h"
+#include "fcore.h"
+#include "stcache.h"
+#include "geocolor.h"
+#include "preview.h"
+#include "deadline.h"
+#include "tune.h"
+#include "term.h"
 
 /* --------- Parametres ---------- */
+#define PREC_F64 0
+#define PREC_F32 1
+#define PREC_U16 2
+
 static int OUT_VALUES = 1;             /* imprimer les valeurs par defaut */
 static int OUT_PPM = 0;
 static const char *PPM_PATH = "map.ppm";
+static int TERM_MODE = TT_NONE;        /* --term */
 
 static int GRID_W = 64;
 static int GRID_H = 48;
@@ -43,6 +101,24 @@ static unsigned long SEED = 1;
 static double AMP0 = 1.0;              /* amplitude initiale diamond-square */
 static double ROUGH = 0.65;            /* facteur de rugosite (0..1) */
 static int SMOOTH_PASSES = 0;          /* adoucissements 3x3 */
+static int GEN_FFT = 0;                /* 1: synthese spectrale au lieu du diamond-square */
+static double BETA = 0.0;              /* exposant spectral (--beta) */
+static int BETA_SET = 0;
+static int WRAP = 0;                   /* carte periodique (tuilable) */
+static int PRECISION = PREC_F64;       /* stockage des grilles (--precision) */
+static size_t MAX_MEM = 0;             /* --max-mem, 0 : memoire physique */
+static int MEM_STATS = 0;              /* --mem-stats */
+static int NUMA_BANDS = 1;             /* --numa bands|off */
+static Arena ARENA;                    /* grilles de geo_run */
+static int TIMINGS_MODE = TM_OFF;      /* --timings[=table|json] */
+static Timings TIMINGS;
+static const char *TRACE_PATH = 0;     /* --trace PATH */
+static int COUNTERS_ON = 0;            /* --counters */
+static double CHECKSUM_Q = 0.0;        /* --checksum[=Q], 0 : sans */
+static const char *FORCE_ISA = 0;      /* --force-isa, 0 : detection */
+static const char *CACHE_DIR = 0;      /* --cache DIR, 0 : sans */
+static int DS_DROP = 0;                /* --deadline : niveaux DS retires */
+#define MAX_SIDE (1L << 30)            /* cote max, grille DS 2^n+1 indexable en int */
 
 static int WATER_ENABLE = 0;
 static double WATER_LEVEL = 0.5;
@@ -61,11 +137,11 @@ static double rng_rand01(void) {
     unsigned long u = rng_nextu();
     return (double)(u & 0xFFFFFF) / (double)0x1000000; /* 24 bits */
 }
-/* [-1,1] */
-static double rng_randm1p1(void) { return rng_rand01() * 2.0 - 1.0; }
 
 /* --------- Utils ---------- */
-static double clamp01d(double v) { if (v < 0.0) return 0.0; if (v > 1.0) return 1.0; return v; }
+/* Indice (ligne y, colonne x) d'une grille de largeur w, en size_t :
+   y * w + x deborde un int au-dela de 46341 x 46341 cellules */
+#define AT(y, x, w) ((size_t)(y) * (size_t)(w) + (size_t)(x))
 
 static void usage(const char *prog) {
     fprintf(stderr,
@@ -76,6 +152,30 @@ static void usage(const char *prog) {
         "  -a R            amplitude initiale diamond-square (defaut 1.0)\n"
         "  -k R            rugosite (0..1, defaut 0.65)\n"
         "  -f N            passes d'adoucissement 3x3 (defaut 0)\n"
+        "  --generator G   ds (defaut) ou fft (synthese spectrale)\n"
+        "  --beta R        exposant spectral pour fft (defaut 2 - 2 log2 k)\n"
+        "  --wrap          carte periodique, raccord parfait entre tuiles\n"
+        "  -j N            nombre de threads (avec -fopenmp ; defaut : profil)\n"
+        "  --precision P   stockage des grilles : f64 (defaut), f32 ou u16\n"
+        "  --max-mem MIB   budget memoire (defaut memoire physique, 0 = aucun)\n"
+        "  --mem-stats     memoire par etape (arene) sur stderr\n"
+        "  --timings[=json] temps mur/CPU et debit par etape sur stderr\n"
+        "  --trace PATH    trace Chrome (chrome://tracing, Perfetto) dans PATH\n"
+        "  --counters      compteurs materiels par etape (perf_event_open, Linux)\n"
+        "  --checksum[=Q]  CRC-32 carte (resolution 1/Q, defaut 1e6), eau, PPM sur stderr\n"
+        "  --bench[=k1,k2] microbenchmarks (JSON sur stdout) : diamond_square,\n"
+        "                  resample_bilinear, smooth_box, print_values, flood, colour, write_ppm\n"
+        "  --bench-sizes L cotes des cartes mesurees (defaut 256,1024,4096)\n"
+        "  --bench-reps N  repetitions mesurees (defaut 5) ; --bench-warmup N (1)\n"
+        "  --bench-baseline F reference JSON, regression au-dela de --bench-tolerance %% (10)\n"
+        "  --numa P        bands (defaut) : pages placees par bandes de threads, ou off\n"
+        "  --force-isa I   noyaux scalar, sse2, avx2 ou avx512 (defaut : cpuid)\n"
+        "  --cache DIR     garder les etapes dans DIR et reprendre la plus avancee\n"
+        "  --progressive PATH apercu PPM apres chaque niveau du diamond-square\n"
+        "                  (PATH remplace, ou un fichier par niveau si %%d)\n"
+        "  --deadline MS   budget de temps (ms) : grille DS plus grossiere, puis\n"
+        "                  moins de passes -f si necessaire\n"
+        "  --deadline-model F couts mesures (JSON de --bench), sinon reference\n"
         "  --sea R         activer eau au niveau R (0..1)\n"
         "  --from-edge     inonde depuis les bords (par defaut si --sea)\n"
         "  --fill-all      marque eau toutes cellules <= niveau (ignore connectivite)\n"
@@ -83,201 +183,80 @@ static void usage(const char *prog) {
         "  --values-with-water  imprimer h'=max(h, niveau) sur cellules eau\n"
         "  -o PATH         ecrire une carte couleur PPM\n"
         "  --no-values     ne pas imprimer les valeurs texte\n"
+        "  --term M        carte en demi-blocs colores, truecolor ou 256 couleurs,\n"
+        "                  a la place des valeurs texte\n"
         , prog);
 }
 
-/* --------- Diamond-Square de taille P=2^n + 1 ---------- */
-static void ds_generate(double *buf, int P) {
-    int step;
-    /* Initial corners */
-    buf[0] = rng_rand01();
-    buf[(P-1)] = rng_rand01();
-    buf[(P-1)*P] = rng_rand01();
-    buf[(P-1)*P + (P-1)] = rng_rand01();
-
-    for (step = P - 1; step > 1; step /= 2) {
-        int half = step / 2;
-        int y, x;
-        double scale = AMP0 * pow(ROUGH, (double)((int)(log((double)(P-1))/log(2.0)) - (int)(log((double)step)/log(2.0))));
-
-        /* Diamond */
-        for (y = half; y < P; y += step) {
-            for (x = half; x < P; x += step) {
-                double a = buf[(y - half) * P + (x - half)];
-                double b = buf[(y - half) * P + (x + half - step + step - half)]; /* (x + half) */
-                double c = buf[(y + half - step + step - half) * P + (x - half)]; /* (y + half) */
-                double d = buf[(y + half - step + step - half) * P + (x + half - step + step - half)]; /* (y+half,x+half) */
-                double avg = (a + b + c + d) * 0.25;
-                double off = rng_randm1p1() * scale;
-                buf[y * P + x] = clamp01d(avg + off);
-            }
-        }
-        /* Square */
-        for (y = 0; y < P; y += half) {
-            int xstart = (y/half) % 2 == 0 ? half : 0;
-            for (x = xstart; x < P; x += step) {
-                double sum = 0.0; int cnt = 0;
-                if (x - half >= 0) { sum += buf[y * P + (x - half)]; cnt++; }
-                if (x + half < P)  { sum += buf[y * P + (x + half)]; cnt++; }
-                if (y - half >= 0) { sum += buf[(y - half) * P + x]; cnt++; }
-                if (y + half < P)  { sum += buf[(y + half) * P + x]; cnt++; }
-                if (cnt > 0) {
-                    double avg = sum / (double)cnt;
-                    double off = rng_randm1p1() * scale;
-                    buf[y * P + x] = clamp01d(avg + off);
-                }
-            }
-        }
-    }
-}
-
-/* Bilinear sampling from ds grid (P x P) into out (W x H) */
-static void resample_bilinear(const double *src, int P, double *out, int W, int H) {
-    int y, x;
-    for (y = 0; y < H; ++y) {
-        double v = ((double)y) * (double)(P - 1) / (double)(H - 1);
-        int y0 = (int)floor(v);
-        int y1 = y0 + 1; if (y1 >= P) y1 = P - 1;
-        double fy = v - (double)y0;
-        for (x = 0; x < W; ++x) {
-            double u = ((double)x) * (double)(P - 1) / (double)(W - 1);
-            int x0 = (int)floor(u);
-            int x1 = x0 + 1; if (x1 >= P) x1 = P - 1;
-            double fx = u - (double)x0;
-            {
-                double a = src[y0 * P + x0];
-                double b = src[y0 * P + x1];
-                double c = src[y1 * P + x0];
-                double d = src[y1 * P + x1];
-                double v0 = a * (1.0 - fx) + b * fx;
-                double v1 = c * (1.0 - fx) + d * fx;
-                out[y * W + x] = v0 * (1.0 - fy) + v1 * fy;
-            }
-        }
-    }
+/* Diamond-square (fcore.h) : hauteurs bornees a [0,1] a chaque point */
+static void geo_ds_params(FcDs *p) {
+    p->amp = AMP0;
+    p->decay = ROUGH;
+    p->bias = 0.5;
+    p->wrap = WRAP;
+    p->clamp01 = 1;
+    p->rand01 = rng_rand01;
+    p->level = 0;
+    p->level_ctx = 0;
 }
 
-/* Box blur 3x3 integer passes */
-static void smooth_box(double *buf, int W, int H, int passes) {
-    int p;
-    if (passes <= 0) return;
-    for (p = 0; p < passes; ++p) {
-        int y, x;
-        double *tmp = (double*)malloc((size_t)W * (size_t)H * sizeof(double));
-        if (!tmp) return;
-        for (y = 0; y < H; ++y) {
-            for (x = 0; x < W; ++x) {
-                int yy, xx;
-                double sum = 0.0; int cnt = 0;
-                for (yy = y - 1; yy <= y + 1; ++yy) {
-                    for (xx = x - 1; xx <= x + 1; ++xx) {
-                        int cx = xx; int cy = yy;
-                        if (cx < 0) cx = 0; if (cx >= W) cx = W - 1;
-                        if (cy < 0) cy = 0; if (cy >= H) cy = H - 1;
-                        sum += buf[cy * W + cx];
-                        cnt++;
-                    }
-                }
-                tmp[y * W + x] = sum / (double)cnt;
-            }
-        }
-        for (y = 0; y < H; ++y) {
-            for (x = 0; x < W; ++x) buf[y * W + x] = tmp[y * W + x];
-        }
-        free(tmp);
-    }
-}
+/* Etapes du cache disque (stcache.h), chacune cle de la suivante */
+#define GEO_ST_DS     0
+#define GEO_ST_MAP    1
+#define GEO_ST_SMOOTH 2
+#define GEO_ST_FLOOD  3
 
-/* Flood water mask: outmask[y*W+x]=1 si eau, 0 sinon */
-static void flood_from_edges_or_seed(const double *h, int W, int H,
-                                     double level, int from_edge,
-                                     int seed_set, int sx, int sy,
-                                     unsigned char *mask)
-{
-    int i;
-    int *queue_x, *queue_y;
-    int qh = 0, qt = 0, qcap;
-    /* init mask=0 */
-    for (i = 0; i < W*H; ++i) mask[i] = 0;
-
-    qcap = W*H;
-    queue_x = (int*)malloc((size_t)qcap * sizeof(int));
-    queue_y = (int*)malloc((size_t)qcap * sizeof(int));
-    if (!queue_x || !queue_y) { free(queue_x); free(queue_y); return; }
-
-    /* seed edges if requested */
-    if (from_edge) {
-        int x, y;
-        for (x = 0; x < W; ++x) {
-            if (h[0 * W + x] <= level) { mask[0 * W + x] = 1; queue_x[qt] = x; queue_y[qt] = 0; qt++; }
-            if (h[(H-1) * W + x] <= level) { mask[(H-1) * W + x] = 1; queue_x[qt] = x; queue_y[qt] = H-1; qt++; }
-        }
-        for (y = 0; y < H; ++y) {
-            if (h[y * W + 0] <= level) { mask[y * W + 0] = 1; queue_x[qt] = 0; queue_y[qt] = y; qt++; }
-            if (h[y * W + (W-1)] <= level) { mask[y * W + (W-1)] = 1; queue_x[qt] = W-1; queue_y[qt] = y; qt++; }
-        }
-    }
-    /* optional single seed */
-    if (seed_set) {
-        if (sx < 0) sx = 0; if (sx >= W) sx = W-1;
-        if (sy < 0) sy = 0; if (sy >= H) sy = H-1;
-        if (h[sy * W + sx] <= level && !mask[sy * W + sx]) {
-            mask[sy * W + sx] = 1;
-            queue_x[qt] = sx; queue_y[qt] = sy; qt++;
-        }
-    }
+static const char *const geo_st_names[4] = { "ds", "map", "smooth", "flood" };
 
-    /* BFS 4-connexity */
-    while (qh < qt) {
-        int cx = queue_x[qh];
-        int cy = queue_y[qh];
-        qh++;
-        /* neighbors */
-        {
-            int nx, ny, k;
-            static const int dx[4] = {1,-1,0,0};
-            static const int dy[4] = {0,0,1,-1};
-            for (k = 0; k < 4; ++k) {
-                nx = cx + dx[k];
-                ny = cy + dy[k];
-                if (nx < 0 || ny < 0 || nx >= W || ny >= H) continue;
-                if (mask[ny * W + nx]) continue;
-                if (h[ny * W + nx] <= level) {
-                    mask[ny * W + nx] = 1;
-                    queue_x[qt] = nx; queue_y[qt] = ny; qt++;
-                }
-            }
-        }
+/* Cle de l'etape st pour une grille de generation P x P : tous les
+   parametres dont elle depend. geo1 : version des calculs, a changer si
+   l'un d'eux change. */
+static void geo_cache_key(char *key, int st, int P) {
+    static const char *const prec[3] = { "f64", "f32", "u16" };
+    char *k = key;
+    k += sprintf(k, "geo1 %s P=%d seed=%lu a=%.17g wrap=%d", prec[PRECISION], P, SEED, AMP0, WRAP);
+    if (GEN_FFT) k += sprintf(k, " fft beta=%.17g", BETA_SET ? BETA : 2.0 - 2.0 * log(ROUGH) / log(2.0));
+    else k += sprintf(k, " ds k=%.17g", ROUGH);
+    if (st >= GEO_ST_MAP) k += sprintf(k, " | resample %dx%d", GRID_W, GRID_H);
+    if (st >= GEO_ST_SMOOTH) k += sprintf(k, " | smooth %d", SMOOTH_PASSES);
+    if (st >= GEO_ST_FLOOD) {
+        k += sprintf(k, " | flood %.17g", WATER_LEVEL);
+        if (WATER_SEED_SET) sprintf(k, " seed=%d,%d", WATER_SEED_X, WATER_SEED_Y);
     }
+}
 
-    free(queue_x); free(queue_y);
+/* Lit l'etape st dans dst (bytes octets) ; 1 si trouvee */
+static int geo_cache_get(int st, int P, void *dst, size_t bytes) {
+    char key[SC_KEY];
+    int hit;
+    geo_cache_key(key, st, P);
+    tm_begin(&TIMINGS, "cache");
+    hit = sc_fetch(geo_st_names[st], key, dst, bytes);
+    tm_end(&TIMINGS, 0.0, hit ? (double)bytes : 0.0);
+    return hit;
 }
 
-/* Remplissage sans connectivite : tout <= niveau est eau */
-static void mark_all_below(const double *h, int W, int H, double level, unsigned char *mask) {
-    int i;
-    for (i = 0; i < W*H; ++i) mask[i] = (unsigned char)(h[i] <= level ? 1 : 0);
+/* Range l'etape st qui vient d'etre calculee */
+static void geo_cache_put(int st, int P, const void *src, size_t bytes) {
+    char key[SC_KEY];
+    if (!SCACHE.dir) return;
+    geo_cache_key(key, st, P);
+    tm_begin(&TIMINGS, "cache");
+    sc_store(geo_st_names[st], key, src, bytes);
+    tm_end(&TIMINGS, 0.0, (double)bytes);
 }
 
-/* Palette geographique simple */
-static void color_for(double v, int water, double level, int *R, int *G, int *B) {
-    if (water) {
-        /* profondeur: bleu plus sombre si profond */
-        double d = level - v; if (d < 0.0) d = 0.0; if (d > 1.0) d = 1.0;
-        int r = (int)(10 + 30 * (1.0 - d));
-        int g = (int)(40 + 60 * (1.0 - d));
-        int b = (int)(120 + 120 * (1.0 - d));
-        if (r < 0) r = 0; if (r > 255) r = 255;
-        if (g < 0) g = 0; if (g > 255) g = 255;
-        if (b < 0) b = 0; if (b > 255) b = 255;
-        *R = r; *G = g; *B = b;
-        return;
+/* Ligne y de la carte couleur (--term) */
+typedef struct { const int *rgb; int W; } GeoImage;
+
+static void geo_term_row(void *ctx, int y, unsigned char *px) {
+    const GeoImage *im = (const GeoImage*)ctx;
+    const int *row = im->rgb + (size_t)y * (size_t)im->W * 3;
+    int k;
+    for (k = 0; k < im->W * 3; ++k) {
+        int v = row[k];
+        px[k] = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
     }
-    /* terre : sable -> vert -> roche -> neige */
-    if (v < 0.05) { *R=194; *G=178; *B=128; return; }    /* plage */
-    if (v < 0.30) { *R= 80; *G=160; *B= 60; return; }    /* plaine/foret */
-    if (v < 0.60) { *R=120; *G=120; *B=120; return; }    /* roches */
-    { *R=240; *G=240; *B=240; }                          /* neige */
 }
 
 /* Ecriture PPM */
@@ -290,7 +269,7 @@ static int write_ppm(const char *path, const int *rgb, int W, int H) {
     want = (size_t)W * (size_t)H * 3;
     for (y = 0; y < H; ++y) {
         for (x = 0; x < W; ++x) {
-            int off = (y * W + x) * 3;
+            size_t off = ((size_t)y * (size_t)W + (size_t)x) * 3;
             unsigned char px[3];
             int r = rgb[off+0], g = rgb[off+1], b = rgb[off+2];
             if (r < 0) r = 0; if (r > 255) r = 255;
@@ -306,19 +285,139 @@ static int write_ppm(const char *path, const int *rgb, int W, int H) {
     return 0;
 }
 
+/* --------- Pipeline, une instance par precision ---------- */
+
+/* Quantification [0,1] -> 0..65535, arrondi au plus proche */
+static unsigned short u16_store(float x) {
+    if (!(x > 0.0f)) return 0;
+    if (x >= 1.0f) return 65535;
+    return (unsigned short)(x * 65535.0f + 0.5f);
+}
+
+#define PX_T double
+#define PX_C double
+#define PX_LOAD(v) (v)
+#define PX_STORE(x) (x)
+#define PX_FN(name) name##_f64
+#include "geo_pipeline.h"
+
+#define PX_T float
+#define PX_C float
+#define PX_LOAD(v) (v)
+#define PX_STORE(x) ((float)(x))
+#define PX_FN(name) name##_f32
+#include "geo_pipeline.h"
+
+#define PX_T unsigned short
+#define PX_C float
+#define PX_LOAD(v) ((float)(v) * (1.0f / 65535.0f))
+#define PX_STORE(x) u16_store(x)
+#define PX_FN(name) name##_u16
+#include "geo_pipeline.h"
+
+/* Octets alloues par geo_run, MEM_SIZE_MAX hors espace d'adressage */
+static size_t geo_mem_need(void) {
+    size_t cell = (PRECISION == PREC_U16) ? sizeof(unsigned short)
+                : (PRECISION == PREC_F32) ? sizeof(float) : sizeof(double);
+    size_t W = (size_t)GRID_W, H = (size_t)GRID_H, P;
+    size_t need = 0, gen = 0, smooth = 0, water = 0, flood = 0, rgb = 0, late;
+    int maxdim = (GRID_W > GRID_H) ? GRID_W : GRID_H;
+
+    P = 3;
+    while (P < (size_t)maxdim) P = 2 * P - 1;
+    P = ((P - 1) >> DS_DROP) + 1;
+    if (GEN_FFT) { P = 2; while (P < (size_t)maxdim) P <<= 1; }
+
+    /* les etapes reutilisent la zone rendue par la precedente (arena.h) */
+    mem_add_mul(&gen, P * cell, P);                       /* grille DS / FFT */
+    if (!GEN_FFT) mem_add_mul(&gen, fc_ds_aux_cells((int)P), cell);
+    if (!GEN_FFT && PREVIEW.path) {
+        /* apercu reechantillonne et ses pixels, pendant le DS */
+        mem_add_mul(&gen, pv_cells(GRID_W, GRID_H), cell + 3);
+        mem_add_mul(&gen, 2, ARENA_ALIGN);
+    }
+    if (GEN_FFT) {
+        if (cell != sizeof(double)) mem_add_mul(&gen, P * sizeof(double), P);
+        mem_add_mul(&gen, spectral_fbm_work((int)P), sizeof(double));
+    }
+    if (SMOOTH_PASSES > 0) mem_add_mul(&smooth, W * cell, H);
+    if (WATER_ENABLE) {
+        mem_add_mul(&water, W, H);                          /* masque */
+        if (WATER_FROM_EDGE) mem_add_mul(&flood, W * 2 * sizeof(int), H);
+    }
+    if (OUT_PPM || TERM_MODE != TT_NONE) mem_add_mul(&rgb, W * 3 * sizeof(int), H);
+    late = (flood > rgb) ? flood : rgb;
+    mem_add_mul(&water, late, 1);
+
+    mem_add_mul(&need, W * cell, H);                      /* carte */
+    if (smooth > gen) gen = smooth;
+    mem_add_mul(&need, (water > gen) ? water : gen, 1);
+    mem_add_mul(&need, 6 * ARENA_ALIGN, 1);               /* arrondis des blocs */
+    return need;
+}
+
+/* Duree estimee (ms) du pipeline sur une grille DS P x P avec passes
+   adoucissements : couts par cellule de deadline.h (noyaux de --bench) */
+static double geo_estimate(int P, int passes) {
+    double cells = (double)GRID_W * (double)GRID_H;
+    double ms = dl_touch_ms(geo_mem_need())   /* majorant : grille complete */
+              + dl_ms("geo", "diamond_square", (double)P * (double)P)
+              + dl_ms("geo", "resample_bilinear", cells)
+              + passes * dl_ms("geo", "smooth_box", cells);
+    if (WATER_ENABLE && WATER_FROM_EDGE) ms += dl_ms("geo", "flood", cells);
+    if (OUT_PPM || TERM_MODE != TT_NONE) ms += dl_ms("geo", "colour", cells);
+    if (OUT_PPM) ms += dl_ms("geo", "write_ppm", cells);
+    if (OUT_VALUES) ms += dl_ms("geo", "print_values", cells);
+    return ms;
+}
+
+/* Cote de la grille DS pour la carte demandee */
+static int geo_ds_side(void) {
+    int maxdim = (GRID_W > GRID_H) ? GRID_W : GRID_H;
+    int P = 3;
+    while (P < maxdim) P = 2 * P - 1;
+    return P;
+}
+
+/* Cout avec d niveaux du DS retires (dl_degrade) */
+static double geo_cost(int d, int passes) {
+    return geo_estimate(((geo_ds_side() - 1) >> d) + 1, passes);
+}
+
+/* --deadline : niveaux fins du DS (grille de cote au moins 9) et passes
+   d'adoucissement, par les paliers de dl_degrade. Fixe DS_DROP et
+   SMOOTH_PASSES. */
+static void geo_deadline(void) {
+    int P = geo_ds_side(), d = 0, dmax = 0, passes = SMOOTH_PASSES;
+    double est;
+    char what[96];
+
+    while (((P - 1) >> (dmax + 1)) >= 8) dmax++;
+    est = dl_degrade(geo_cost, dmax, &d, &passes);
+    what[0] = '\0';
+    if (d) sprintf(what, "grille DS %d -> %d", P, ((P - 1) >> d) + 1);
+    if (passes < SMOOTH_PASSES) {
+        sprintf(what + strlen(what), "%sadoucissement %d -> %d passes", d ? ", " : "", SMOOTH_PASSES, passes);
+    }
+    DS_DROP = d;
+    SMOOTH_PASSES = passes;
+    dl_report("geo", est, what);
+}
+
 /* --------- main ---------- */
 int main(int argc, char **argv) {
-    int i;
+    int i, rc;
+    tn_init("geo");
     /* parse args */
     for (i = 1; i < argc; ) {
         const char *a = argv[i];
         if (strcmp(a, "-x") == 0 && i + 1 < argc) {
             char *e=0; long v = strtol(argv[i+1], &e, 10);
-            if (*e!='\0' || v<=1) { usage(argv[0]); return 1; }
+            if (*e!='\0' || v<=1 || v>MAX_SIDE) { usage(argv[0]); return 1; }
             GRID_W = (int)v; i+=2; continue;
         } else if (strcmp(a, "-y") == 0 && i + 1 < argc) {
             char *e=0; long v = strtol(argv[i+1], &e, 10);
-            if (*e!='\0' || v<=1) { usage(argv[0]); return 1; }
+            if (*e!='\0' || v<=1 || v>MAX_SIDE) { usage(argv[0]); return 1; }
             GRID_H = (int)v; i+=2; continue;
         } else if (strcmp(a, "-s") == 0 && i + 1 < argc) {
             char *e=0; unsigned long v = (unsigned long)strtoul(argv[i+1], &e, 10);
@@ -336,6 +435,62 @@ int main(int argc, char **argv) {
             char *e=0; long v = strtol(argv[i+1], &e, 10);
             if (*e!='\0' || v<0) { usage(argv[0]); return 1; }
             SMOOTH_PASSES = (int)v; i+=2; continue;
+        } else if (strcmp(a, "--generator") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i+1], "ds") == 0) GEN_FFT = 0;
+            else if (strcmp(argv[i+1], "fft") == 0) GEN_FFT = 1;
+            else { usage(argv[0]); return 1; }
+            i+=2; continue;
+        } else if (strcmp(a, "--wrap") == 0) {
+            WRAP = 1; i+=1; continue;
+        } else if (strcmp(a, "--precision") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i+1], "f64") == 0) PRECISION = PREC_F64;
+            else if (strcmp(argv[i+1], "f32") == 0) PRECISION = PREC_F32;
+            else if (strcmp(argv[i+1], "u16") == 0) PRECISION = PREC_U16;
+            else { usage(argv[0]); return 1; }
+            i+=2; continue;
+        } else if (strcmp(a, "--max-mem") == 0 && i + 1 < argc) {
+            if (mem_parse_mib(argv[i+1], &MAX_MEM) != 0) { usage(argv[0]); return 1; }
+            i+=2; continue;
+        } else if (strcmp(a, "--mem-stats") == 0) {
+            MEM_STATS = 1; i+=1; continue;
+        } else if (strncmp(a, "--timings", 9) == 0) {
+            if (tm_parse(a, &TIMINGS_MODE) != 1) { usage(argv[0]); return 1; }
+            i+=1; continue;
+        } else if (strcmp(a, "--trace") == 0 && i + 1 < argc) {
+            TRACE_PATH = argv[i+1]; i+=2; continue;
+        } else if (strcmp(a, "--counters") == 0) {
+            COUNTERS_ON = 1; i+=1; continue;
+        } else if (strncmp(a, "--checksum", 10) == 0) {
+            if (ck_parse(a, &CHECKSUM_Q) != 1) { usage(argv[0]); return 1; }
+            i+=1; continue;
+        } else if (strncmp(a, "--bench", 7) == 0) {
+            if (bench_parse(argc, argv, &i) != 1) { usage(argv[0]); return 1; }
+            continue;
+        } else if (strcmp(a, "--numa") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i+1], "bands") == 0) NUMA_BANDS = 1;
+            else if (strcmp(argv[i+1], "off") == 0) NUMA_BANDS = 0;
+            else { usage(argv[0]); return 1; }
+            i+=2; continue;
+        } else if (strcmp(a, "--force-isa") == 0 && i + 1 < argc) {
+            FORCE_ISA = argv[i+1]; i+=2; continue;
+        } else if (strcmp(a, "--cache") == 0 && i + 1 < argc) {
+            CACHE_DIR = argv[i+1]; i+=2; continue;
+        } else if (strcmp(a, "--progressive") == 0 && i + 1 < argc) {
+            PREVIEW.path = argv[i+1]; i+=2; continue;
+        } else if (strncmp(a, "--deadline", 10) == 0) {
+            if (dl_parse(argc, argv, &i) != 1) { usage(argv[0]); return 1; }
+            continue;
+        } else if (strcmp(a, "--beta") == 0 && i + 1 < argc) {
+            char *e=0; double v = strtod(argv[i+1], &e);
+            if (*e!='\0') { usage(argv[0]); return 1; }
+            BETA = v; BETA_SET = 1; i+=2; continue;
+        } else if (strcmp(a, "-j") == 0 && i + 1 < argc) {
+            char *e=0; long v = strtol(argv[i+1], &e, 10);
+            if (*e!='\0' || v<=0) { usage(argv[0]); return 1; }
+#ifdef _OPENMP
+            omp_set_num_threads((int)v);
+#endif
+            i+=2; continue;
         } else if (strcmp(a, "--sea") == 0 && i + 1 < argc) {
             char *e=0; double v = strtod(argv[i+1], &e);
             if (*e!='\0' || v<0.0 || v>1.0) { usage(argv[0]); return 1; }
@@ -356,97 +511,62 @@ int main(int argc, char **argv) {
             OUT_PPM = 1; PPM_PATH = argv[i+1]; i+=2; continue;
         } else if (strcmp(a, "--no-values") == 0) {
             OUT_VALUES = 0; i+=1; continue;
+        } else if (strcmp(a, "--term") == 0 && i + 1 < argc) {
+            TERM_MODE = tt_mode(argv[i+1]);
+            if (TERM_MODE == TT_NONE) { usage(argv[0]); return 1; }
+            OUT_VALUES = 0; i+=2; continue;
         } else {
             usage(argv[0]); return 1;
         }
     }
 
-    /* Generation via diamond-square a taille P=2^n+1, puis resample en WxH */
-    {
-        int maxdim = (GRID_W > GRID_H) ? GRID_W : GRID_H;
-        int n = 1; while (((1<<n) + 1) < maxdim) n++;
-        /* Taille DS : P = 2^n + 1 */
-        {
-            int P = (1<<n) + 1;
-            double *ds = (double*)malloc((size_t)P * (size_t)P * sizeof(double));
-            double *map = (double*)malloc((size_t)GRID_W * (size_t)GRID_H * sizeof(double));
-            unsigned char *water = 0;
-            int *rgb = 0;
-            int y, x;
-
-            if (!ds || !map) { fprintf(stderr, "Alloc DS/map impossible.\n"); free(ds); free(map); return 1; }
-
-            rng_srand(SEED);
-            ds_generate(ds, P);
-            resample_bilinear(ds, P, map, GRID_W, GRID_H);
-            if (SMOOTH_PASSES > 0) smooth_box(map, GRID_W, GRID_H, SMOOTH_PASSES);
-
-            /* Eau */
-            if (WATER_ENABLE) {
-                water = (unsigned char*)malloc((size_t)GRID_W * (size_t)GRID_H);
-                if (!water) { fprintf(stderr, "Alloc eau impossible.\n"); free(ds); free(map); return 1; }
-                if (WATER_FROM_EDGE) {
-                    flood_from_edges_or_seed(map, GRID_W, GRID_H, WATER_LEVEL,
-                                             1, WATER_SEED_SET, WATER_SEED_X, WATER_SEED_Y, water);
-                } else {
-                    mark_all_below(map, GRID_W, GRID_H, WATER_LEVEL, water);
-                }
-            }
-
-            /* Sortie valeurs */
-            if (OUT_VALUES) {
-                for (y = 0; y < GRID_H; ++y) {
-                    for (x = 0; x < GRID_W; ++x) {
-                        double v = map[y * GRID_W + x];
-                        if (WATER_ENABLE && VALUES_WITH_WATER) {
-                            if (water && water[y * GRID_W + x]) {
-                                v = WATER_LEVEL; /* remplir au niveau constant */
-                            }
-                        }
-                        printf("%.6f%s", v, (x == GRID_W - 1) ? "\n" : " ");
-                    }
-                }
-            }
-
-            /* Sortie PPM */
-            if (OUT_PPM) {
-                rgb = (int*)malloc((size_t)GRID_W * (size_t)GRID_H * 3 * sizeof(int));
-                if (!rgb) { fprintf(stderr, "Alloc RGB impossible.\n"); free(ds); free(map); free(water); return 1; }
-                for (y = 0; y < GRID_H; ++y) {
-                    for (x = 0; x < GRID_W; ++x) {
-                        double v = map[y * GRID_W + x];
-                        int w = (WATER_ENABLE && water) ? water[y * GRID_W + x] : 0;
-                        int r,g,b;
-                        color_for(v, w, WATER_LEVEL, &r, &g, &b);
-                        /* renforcement du rivage: foncer la frontiere eau/terre */
-                        if (WATER_ENABLE && water) {
-                            int nx, ny, k;
-                            static const int dx[4] = {1,-1,0,0};
-                            static const int dy[4] = {0,0,1,-1};
-                            for (k=0;k<4;++k){
-                                nx=x+dx[k]; ny=y+dy[k];
-                                if (nx>=0&&ny>=0&&nx<GRID_W&&ny<GRID_H){
-                                    int w2 = water[ny*GRID_W+nx];
-                                    if (w2 != w) { r = (r*7)/10; g=(g*7)/10; b=(b*7)/10; break; }
-                                }
-                            }
-                        }
-                        rgb[(y*GRID_W + x)*3 + 0] = r;
-                        rgb[(y*GRID_W + x)*3 + 1] = g;
-                        rgb[(y*GRID_W + x)*3 + 2] = b;
-                    }
-                }
-                if (write_ppm(PPM_PATH, rgb, GRID_W, GRID_H) != 0) {
-                    fprintf(stderr, "Echec ecriture %s\n", PPM_PATH);
-                    free(rgb); free(water); free(ds); free(map); return 1;
-                }
-            }
-
-            free(rgb);
-            free(water);
-            free(ds);
-            free(map);
+    if (TRACE_PATH && tr_init(TRACE_PATH, "geo") != 0) {
+        fprintf(stderr, "Impossible d'ouvrir '%s' en ecriture.\n", TRACE_PATH);
+        return 1;
+    }
+    if (isa_init(FORCE_ISA) != 0) return 1;
+    kernels_select_f64(ISA.level);
+    kernels_select_f32(ISA.level);
+    kernels_select_u16(ISA.level);
+    if (BENCH.on) {
+        /* noyaux seuls sur des cartes de --bench-sizes ; -x/-y ignores */
+        switch (PRECISION) {
+        case PREC_F32: return geo_bench_f32("f32");
+        case PREC_U16: return geo_bench_u16("u16");
+        default:       return geo_bench_f64("f64");
         }
     }
-    return 0;
+
+    if (PREVIEW.path && GEN_FFT) {
+        fprintf(stderr, "--progressive n'est disponible qu'avec le generateur ds.\n");
+        return 1;
+    }
+    if (DEADLINE.ms > 0.0) {
+        if (GEN_FFT) {
+            fprintf(stderr, "--deadline n'est disponible qu'avec le generateur ds.\n");
+            return 1;
+        }
+        geo_deadline();
+    }
+    if (mem_check(geo_mem_need(), MAX_MEM) != 0) return 1;
+    if (CACHE_DIR) sc_init(CACHE_DIR);
+
+    /* Generation via diamond-square a taille P=2^n+1, puis resample en WxH */
+    if (COUNTERS_ON && ct_init() == 0 && TIMINGS_MODE == TM_OFF) TIMINGS_MODE = TM_TABLE;
+    tm_init(&TIMINGS, "geo", TIMINGS_MODE);
+    if (arena_init(&ARENA, geo_mem_need()) != 0) {
+        fprintf(stderr, "Allocation memoire impossible.\n");
+        return 1;
+    }
+    ARENA.first_touch = NUMA_BANDS && fft_max_threads() > 1;
+    switch (PRECISION) {
+    case PREC_F32: rc = geo_run_f32(); break;
+    case PREC_U16: rc = geo_run_u16(); break;
+    default:       rc = geo_run_f64(); break;
+    }
+    if (MEM_STATS) arena_report(&ARENA, stderr);
+    arena_free(&ARENA);
+    tm_report(&TIMINGS, stderr);
+    return rc;
 }
+
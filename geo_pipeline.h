@@ -0,0 +1,484 @@
+/*
+ * geo_pipeline.h — generation et eau de geo.c, generiques sur la precision
+ * C ANSI C89
+ *
+ * Inclus une fois par precision de stockage par geo.c (pas de garde
+ * d'inclusion). Macros attendues, retirees en fin de fichier :
+ *   PX_T         type de stockage (double, float, unsigned short)
+ *   PX_C         type de calcul (double ou float)
+ *   PX_LOAD(v)   valeur stockee -> PX_C
+ *   PX_STORE(x)  PX_C dans [0,1] -> valeur stockee
+ *   PX_FN(nom)   nom de la fonction generee pour cette precision
+ * Les hauteurs de geo restent dans [0,1] a chaque etape (le diamond-square
+ * borne chaque point), ce qui permet le stockage entier 16 bits sans mise a
+ * l'echelle.
+ *
+ * Diamond-square (borne : clamp01), reechantillonnage, lissage (flou
+ * boite de rayon 1) et normalisation : noyaux communs de fcore.h, les
+ * memes que plasma.
+ */
+
+#include "fcore.h"
+
+/* Flood water mask: outmask[y*W+x]=1 si eau, 0 sinon.
+   queue_x, queue_y : W*H entrees chacune (fournies par l'appelant) */
+static void PX_FN(flood_from_edges_or_seed)(const PX_T *h, int W, int H,
+                                            double level, int from_edge,
+                                            int seed_set, int sx, int sy,
+                                            unsigned char *mask,
+                                            int *queue_x, int *queue_y)
+{
+    size_t i, N = (size_t)W * (size_t)H;
+    size_t qh = 0, qt = 0;
+    /* init mask=0 */
+    for (i = 0; i < N; ++i) mask[i] = 0;
+
+    /* seed edges if requested */
+    if (from_edge) {
+        int x, y;
+        for (x = 0; x < W; ++x) {
+            if ((double)PX_LOAD(h[AT(0, x, W)]) <= level) { mask[AT(0, x, W)] = 1; queue_x[qt] = x; queue_y[qt] = 0; qt++; }
+            if ((double)PX_LOAD(h[AT(H-1, x, W)]) <= level && !mask[AT(H-1, x, W)]) { mask[AT(H-1, x, W)] = 1; queue_x[qt] = x; queue_y[qt] = H-1; qt++; }
+        }
+        /* coins (et lignes si W ou H vaut 1) deja en file : une cellule n'y
+           entre qu'une fois, la file tient en W*H */
+        for (y = 0; y < H; ++y) {
+            if ((double)PX_LOAD(h[AT(y, 0, W)]) <= level && !mask[AT(y, 0, W)]) { mask[AT(y, 0, W)] = 1; queue_x[qt] = 0; queue_y[qt] = y; qt++; }
+            if ((double)PX_LOAD(h[AT(y, W-1, W)]) <= level && !mask[AT(y, W-1, W)]) { mask[AT(y, W-1, W)] = 1; queue_x[qt] = W-1; queue_y[qt] = y; qt++; }
+        }
+    }
+    /* optional single seed */
+    if (seed_set) {
+        if (sx < 0) sx = 0; if (sx >= W) sx = W-1;
+        if (sy < 0) sy = 0; if (sy >= H) sy = H-1;
+        if ((double)PX_LOAD(h[AT(sy, sx, W)]) <= level && !mask[AT(sy, sx, W)]) {
+            mask[AT(sy, sx, W)] = 1;
+            queue_x[qt] = sx; queue_y[qt] = sy; qt++;
+        }
+    }
+
+    /* BFS 4-connexity */
+    while (qh < qt) {
+        int cx = queue_x[qh];
+        int cy = queue_y[qh];
+        qh++;
+        /* neighbors */
+        {
+            int nx, ny, k;
+            static const int dx[4] = {1,-1,0,0};
+            static const int dy[4] = {0,0,1,-1};
+            for (k = 0; k < 4; ++k) {
+                nx = cx + dx[k];
+                ny = cy + dy[k];
+                if (nx < 0 || ny < 0 || nx >= W || ny >= H) continue;
+                if (mask[AT(ny, nx, W)]) continue;
+                if ((double)PX_LOAD(h[AT(ny, nx, W)]) <= level) {
+                    mask[AT(ny, nx, W)] = 1;
+                    queue_x[qt] = nx; queue_y[qt] = ny; qt++;
+                }
+            }
+        }
+    }
+}
+
+/* Remplissage sans connectivite : tout <= niveau est eau */
+static void PX_FN(mark_all_below)(const PX_T *h, int W, int H, double level, unsigned char *mask) {
+    size_t i, N = (size_t)W * (size_t)H;
+    for (i = 0; i < N; ++i) mask[i] = (unsigned char)((double)PX_LOAD(h[i]) <= level ? 1 : 0);
+}
+
+/* Couleurs RGB (gc_color) de la carte W x H, rivage fonce le long du
+   masque d'eau water (0 : sans eau) */
+static void PX_FN(colour_map)(const PX_T *map, const unsigned char *water, int *rgb, int W, int H) {
+    int y, x;
+    for (y = 0; y < H; ++y) {
+        for (x = 0; x < W; ++x) {
+            double v = (double)PX_LOAD(map[AT(y, x, W)]);
+            int w = (WATER_ENABLE && water) ? water[AT(y, x, W)] : 0;
+            int r,g,b;
+            gc_color(v, w, WATER_LEVEL, &r, &g, &b);
+            /* renforcement du rivage: foncer la frontiere eau/terre */
+            if (WATER_ENABLE && water) {
+                int nx, ny, k;
+                static const int dx[4] = {1,-1,0,0};
+                static const int dy[4] = {0,0,1,-1};
+                for (k=0;k<4;++k){
+                    nx=x+dx[k]; ny=y+dy[k];
+                    if (WRAP) { nx = (nx + W) % W; ny = (ny + H) % H; }
+                    if (nx>=0&&ny>=0&&nx<W&&ny<H){
+                        int w2 = water[AT(ny, nx, W)];
+                        if (w2 != w) { gc_shore(&r, &g, &b); break; }
+                    }
+                }
+            }
+            rgb[AT(y, x, W) * 3 + 0] = r;
+            rgb[AT(y, x, W) * 3 + 1] = g;
+            rgb[AT(y, x, W) * 3 + 2] = b;
+        }
+    }
+}
+
+/* Valeurs texte de la carte W x H sur f ; avec water et
+   --values-with-water, cellules d'eau au niveau de l'eau */
+static void PX_FN(write_values)(const PX_T *map, const unsigned char *water, int W, int H, FILE *f) {
+    int y, x;
+    for (y = 0; y < H; ++y) {
+        for (x = 0; x < W; ++x) {
+            double v = (double)PX_LOAD(map[AT(y, x, W)]);
+            if (WATER_ENABLE && VALUES_WITH_WATER) {
+                if (water && water[AT(y, x, W)]) {
+                    v = WATER_LEVEL; /* remplir au niveau constant */
+                }
+            }
+            fprintf(f, "%.6f%s", v, (x == W - 1) ? "\n" : " ");
+        }
+    }
+}
+
+/* Apercu du niveau de cote side (crochet FcDs.level, preview.h) : grille
+   compacte reechantillonnee, palette de geo ; avec --sea, eau partout sous
+   le niveau (sans inondation ni rivage). Tampons pris dans l'arene ctx et
+   rendus aussitot. */
+static void PX_FN(geo_preview)(void *ctx, const void *grid, int side) {
+    Arena *A = (Arena*)ctx;
+    size_t mark = arena_mark(A), N, i;
+    double t0 = tr_begin();
+    int pw, ph;
+    PX_T *g;
+    unsigned char *rgb;
+    if (!pv_dims(side, &pw, &ph)) return;
+    N = (size_t)pw * (size_t)ph;
+    g = (PX_T*)arena_alloc(A, N * sizeof(PX_T));
+    rgb = (unsigned char*)arena_alloc(A, N * 3);
+    if (g && rgb) {
+        PX_FN(fc_resample)((const PX_T*)grid, side, WRAP ? side - 1 : 0, g, pw, ph);
+        for (i = 0; i < N; ++i) {
+            double v = (double)PX_LOAD(g[i]);
+            int r, gr, b;
+            gc_color(v, WATER_ENABLE && v <= WATER_LEVEL, WATER_LEVEL, &r, &gr, &b);
+            rgb[3 * i + 0] = (unsigned char)r;
+            rgb[3 * i + 1] = (unsigned char)gr;
+            rgb[3 * i + 2] = (unsigned char)b;
+        }
+        pv_write(rgb, pw, ph, side);
+    }
+    arena_release(A, mark);
+    tr_end("preview", "level", t0, (long)side, (long)N);
+}
+
+/* Generation, eau et sorties. Toutes les grilles sont prises dans ARENA.
+   Retourne le code de sortie du programme. */
+static int PX_FN(geo_run)(void) {
+    Arena *A = &ARENA;
+    int maxdim = (GRID_W > GRID_H) ? GRID_W : GRID_H;
+    int n = 1; while (((1<<n) + 1) < maxdim) n++;
+    /* Taille DS : P = 2^n + 1 ; synthese spectrale : P = 2^m >= maxdim */
+    {
+        int P = (1<<n) + 1;
+        size_t cells = (size_t)GRID_W * (size_t)GRID_H;
+        size_t mark;
+        PX_T *ds, *map;
+        unsigned char *water = 0;
+        int *rgb = 0;
+        int have = 0;          /* etape reprise du cache : 1 DS, 2 carte, 3 carte lissee */
+
+        if (GEN_FFT) {
+            P = 2;
+            while (P < maxdim) P <<= 1;
+        } else {
+            P = ((P - 1) >> DS_DROP) + 1;      /* --deadline */
+        }
+        arena_stage(A, "generation");
+        map = (PX_T*)arena_alloc_rows(A, (size_t)GRID_H, (size_t)GRID_W * sizeof(PX_T));
+        mark = arena_mark(A);
+        /* DS sequentiel ; la FFT remplit ses lignes par bandes */
+        ds = (GEN_FFT && sizeof(PX_T) == sizeof(double))
+           ? (PX_T*)arena_alloc_rows(A, (size_t)P, (size_t)P * sizeof(PX_T))
+           : (PX_T*)arena_alloc(A, (size_t)P * (size_t)P * sizeof(PX_T));
+        if (!ds || !map) { fprintf(stderr, "Alloc DS/map impossible.\n"); return 1; }
+
+        /* Cache : etape la plus avancee d'abord */
+        if (SCACHE.dir) {
+            size_t mapb = cells * sizeof(PX_T), dsb = (size_t)P * (size_t)P * sizeof(PX_T);
+            if (SMOOTH_PASSES > 0 && geo_cache_get(GEO_ST_SMOOTH, P, map, mapb)) have = 3;
+            else if (geo_cache_get(GEO_ST_MAP, P, map, mapb)) have = 2;
+            else if (geo_cache_get(GEO_ST_DS, P, ds, dsb)) have = 1;
+        }
+
+        rng_srand(SEED);
+        if (have) {
+            /* rien a generer */
+        } else if (GEN_FFT) {
+            double beta = BETA;
+            size_t i2, N2 = (size_t)P * (size_t)P, grid = arena_mark(A);
+            /* la FFT calcule en double, convertie apres normalisation */
+            double *spec = (sizeof(PX_T) == sizeof(double)) ? (double*)ds
+                         : (double*)arena_alloc_rows(A, (size_t)P, (size_t)P * sizeof(double));
+            double *work = (double*)arena_alloc(A, spectral_fbm_work(P) * sizeof(double));
+            tm_begin(&TIMINGS, "generate");
+            if (!BETA_SET) beta = 2.0 - 2.0 * log(ROUGH) / log(2.0);
+            if (!spec || !work || spectral_fbm(spec, P, beta, AMP0, rng_rand01, work) != 0) {
+                fprintf(stderr, "Alloc FFT impossible.\n");
+                return 1;
+            }
+            tm_end(&TIMINGS, (double)N2, (double)N2 * sizeof(double));
+            tm_begin(&TIMINGS, "normalise");
+            fc_normalize01_f64(spec, N2);
+            if (spec != (double*)ds) {
+                for (i2 = 0; i2 < N2; ++i2) ds[i2] = PX_STORE((PX_C)spec[i2]);
+            }
+            tm_end(&TIMINGS, (double)N2, (double)N2 * (2 * sizeof(double) + sizeof(PX_T)));
+            arena_release(A, grid);
+        } else {
+            FcDs dsp;
+            PX_T *aux = (PX_T*)arena_alloc(A, fc_ds_aux_cells(P) * sizeof(PX_T));
+            if (!aux) { fprintf(stderr, "Alloc DS/map impossible.\n"); return 1; }
+            geo_ds_params(&dsp);
+            if (PREVIEW.path) {
+                pv_begin(P, GRID_W, GRID_H);
+                dsp.level = PX_FN(geo_preview);
+                dsp.level_ctx = A;
+            }
+            tm_begin(&TIMINGS, "generate");
+            PX_FN(fc_ds)(ds, P, &dsp, aux);
+            tm_end(&TIMINGS, (double)P * (double)P, (double)P * (double)P * sizeof(PX_T));
+        }
+        if (!have) geo_cache_put(GEO_ST_DS, P, ds, (size_t)P * (size_t)P * sizeof(PX_T));
+        if (have < 2) {
+            arena_stage(A, "reechantillonnage");
+            tm_begin(&TIMINGS, "resample");
+            PX_FN(fc_resample)(ds, P, WRAP ? (GEN_FFT ? P : P - 1) : 0, map, GRID_W, GRID_H);
+            tm_end(&TIMINGS, (double)cells, ((double)cells + (double)P * (double)P) * sizeof(PX_T));
+            geo_cache_put(GEO_ST_MAP, P, map, cells * sizeof(PX_T));
+        }
+        arena_release(A, mark);
+        if (SMOOTH_PASSES > 0 && have < 3) {
+            PX_T *tmp;
+            arena_stage(A, "lissage");
+            tmp = (PX_T*)arena_alloc_rows(A, (size_t)GRID_H, (size_t)GRID_W * sizeof(PX_T));
+            if (!tmp) { fprintf(stderr, "Alloc lissage impossible.\n"); return 1; }
+            tm_begin(&TIMINGS, "blur");
+            PX_FN(fc_blur)(map, GRID_W, GRID_H, 1, SMOOTH_PASSES, WRAP, tmp);
+            tm_end(&TIMINGS, (double)cells * SMOOTH_PASSES, 2.0 * (double)cells * sizeof(PX_T) * SMOOTH_PASSES);
+            arena_release(A, mark);
+            geo_cache_put(GEO_ST_SMOOTH, P, map, cells * sizeof(PX_T));
+        }
+
+        /* Eau */
+        if (WATER_ENABLE) {
+            arena_stage(A, "eau");
+            water = (unsigned char*)arena_alloc(A, cells);
+            if (!water) { fprintf(stderr, "Alloc eau impossible.\n"); return 1; }
+            if (WATER_FROM_EDGE && SCACHE.dir && geo_cache_get(GEO_ST_FLOOD, P, water, cells)) {
+                /* masque repris du cache */
+            } else if (WATER_FROM_EDGE) {
+                size_t q = arena_mark(A);
+                int *queue_x = (int*)arena_alloc(A, cells * sizeof(int));
+                int *queue_y = (int*)arena_alloc(A, cells * sizeof(int));
+                if (!queue_x || !queue_y) { fprintf(stderr, "Alloc eau impossible.\n"); return 1; }
+                tm_begin(&TIMINGS, "flood");
+                PX_FN(flood_from_edges_or_seed)(map, GRID_W, GRID_H, WATER_LEVEL,
+                                                1, WATER_SEED_SET, WATER_SEED_X, WATER_SEED_Y, water,
+                                                queue_x, queue_y);
+                tm_end(&TIMINGS, (double)cells, (double)cells * (sizeof(PX_T) + 1));
+                arena_release(A, q);
+                geo_cache_put(GEO_ST_FLOOD, P, water, cells);
+            } else {
+                tm_begin(&TIMINGS, "flood");
+                PX_FN(mark_all_below)(map, GRID_W, GRID_H, WATER_LEVEL, water);
+                tm_end(&TIMINGS, (double)cells, (double)cells * (sizeof(PX_T) + 1));
+            }
+        }
+
+        if (CHECKSUM_Q > 0.0) {
+            Crc ck;
+            size_t i2;
+            ck_init(&ck);
+            for (i2 = 0; i2 < cells; ++i2) ck_quant(&ck, (double)PX_LOAD(map[i2]), CHECKSUM_Q);
+            ck_report("geo", "carte", &ck, CHECKSUM_Q);
+            if (water) {
+                ck_init(&ck);
+                ck_bytes(&ck, water, cells);
+                ck_report("geo", "eau", &ck, CHECKSUM_Q);
+            }
+        }
+
+        arena_stage(A, "sortie");
+        /* Sortie valeurs */
+        if (OUT_VALUES) {
+            tm_begin(&TIMINGS, "write");
+            PX_FN(write_values)(map, water, GRID_W, GRID_H, stdout);
+            fflush(stdout);
+            tm_end(&TIMINGS, (double)cells, (double)cells * sizeof(PX_T));
+        }
+
+        /* Sortie PPM et/ou terminal */
+        if (OUT_PPM || TERM_MODE != TT_NONE) {
+            rgb = (int*)arena_alloc(A, cells * 3 * sizeof(int));
+            if (!rgb) { fprintf(stderr, "Alloc RGB impossible.\n"); return 1; }
+            tm_begin(&TIMINGS, "colour");
+            PX_FN(colour_map)(map, water, rgb, GRID_W, GRID_H);
+            tm_end(&TIMINGS, (double)cells, (double)cells * (sizeof(PX_T) + 3 * sizeof(int)));
+        }
+        if (TERM_MODE != TT_NONE) {
+            GeoImage im;
+            im.rgb = rgb;
+            im.W = GRID_W;
+            tm_begin(&TIMINGS, "write");
+            if (tt_blocks(GRID_W, GRID_H, geo_term_row, &im, TERM_MODE) != 0) {
+                fprintf(stderr, "Allocation memoire impossible.\n");
+                return 1;
+            }
+            tm_end(&TIMINGS, (double)cells, (double)cells * 3);
+        }
+        if (OUT_PPM) {
+            if (CHECKSUM_Q > 0.0) {
+                /* octets de l'image, comme write_ppm les ecrit */
+                Crc ck;
+                size_t i2;
+                ck_init(&ck);
+                for (i2 = 0; i2 < cells * 3; ++i2) {
+                    int v = rgb[i2];
+                    unsigned char u = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+                    ck_bytes(&ck, &u, 1);
+                }
+                ck_report("geo", "ppm", &ck, CHECKSUM_Q);
+            }
+            tm_begin(&TIMINGS, "write");
+            if (write_ppm(PPM_PATH, rgb, GRID_W, GRID_H) != 0) {
+                fprintf(stderr, "Echec ecriture %s\n", PPM_PATH);
+                return 1;
+            }
+            tm_end(&TIMINGS, (double)cells, (double)cells * 3);
+        }
+    }
+    return 0;
+}
+
+/* --------- Microbenchmarks (--bench) : generation, lissage, inondation, sorties ---------- */
+
+typedef struct {
+    PX_T *map, *tmp, *ds, *aux;
+    unsigned char *water;
+    int *queue_x, *queue_y, *rgb;
+    int S, P;
+    FcDs dsp;
+    FILE *sink;
+} PX_FN(GeoBench);
+
+static void PX_FN(bench_ds)(void *ctx) {
+    PX_FN(GeoBench) *b = (PX_FN(GeoBench)*)ctx;
+    rng_srand(SEED);
+    PX_FN(fc_ds)(b->ds, b->P, &b->dsp, b->aux);
+}
+
+static void PX_FN(bench_resample)(void *ctx) {
+    PX_FN(GeoBench) *b = (PX_FN(GeoBench)*)ctx;
+    PX_FN(fc_resample)(b->ds, b->P, WRAP ? b->P - 1 : 0, b->map, b->S, b->S);
+}
+
+static void PX_FN(bench_smooth)(void *ctx) {
+    PX_FN(GeoBench) *b = (PX_FN(GeoBench)*)ctx;
+    PX_FN(fc_blur)(b->map, b->S, b->S, 1, 1, WRAP, b->tmp);
+}
+
+static void PX_FN(bench_flood)(void *ctx) {
+    PX_FN(GeoBench) *b = (PX_FN(GeoBench)*)ctx;
+    PX_FN(flood_from_edges_or_seed)(b->map, b->S, b->S, WATER_LEVEL, 1, 0, 0, 0,
+                                    b->water, b->queue_x, b->queue_y);
+}
+
+/* Couleurs de la carte, sans renforcement du rivage */
+static void PX_FN(bench_colour)(void *ctx) {
+    PX_FN(GeoBench) *b = (PX_FN(GeoBench)*)ctx;
+    PX_FN(colour_map)(b->map, b->water, b->rgb, b->S, b->S);
+}
+
+static void PX_FN(bench_ppm)(void *ctx) {
+    PX_FN(GeoBench) *b = (PX_FN(GeoBench)*)ctx;
+    write_ppm(BENCH_NULL, b->rgb, b->S, b->S);
+}
+
+static void PX_FN(bench_values)(void *ctx) {
+    PX_FN(GeoBench) *b = (PX_FN(GeoBench)*)ctx;
+    PX_FN(write_values)(b->map, 0, b->S, b->S, b->sink);
+    fflush(b->sink);
+}
+
+/* Carte S x S par diamond-square + reechantillonnage, puis mesures. Les
+   etages reutilisent l'arene comme geo_run (marque apres la carte). */
+static int PX_FN(geo_bench)(const char *precision) {
+    int k;
+    WATER_ENABLE = 1;          /* colour avec le rivage du masque de flood */
+    bench_begin("geo", precision);
+    for (k = 0; k < BENCH.nsizes; ++k) {
+        PX_FN(GeoBench) b;
+        int S = BENCH.sizes[k], P = 3;
+        size_t cells = (size_t)S * (size_t)S, mark, q, need = 0, late = 0;
+        double c = (double)cells, sz = (double)sizeof(PX_T);
+        size_t gen;
+
+        while (P < S) P = 2 * P - 1;
+        /* apres la carte : grilles DS, ou masque + RGB (plus grand que la file) */
+        gen = ((size_t)P * (size_t)P + fc_ds_aux_cells(P)) * sizeof(PX_T) + ARENA_ALIGN;
+        mem_add_mul(&late, cells, 1 + 3 * sizeof(int));
+        if (gen > late) late = gen;
+        mem_add_mul(&need, cells, sizeof(PX_T));
+        mem_add_mul(&need, late, 1);
+        mem_add_mul(&need, 6 * ARENA_ALIGN, 1);
+        if (mem_check(need, MAX_MEM) != 0 || arena_init(&ARENA, need) != 0) {
+            bench_skip(S, "memoire");
+            continue;
+        }
+        ARENA.first_touch = NUMA_BANDS && fft_max_threads() > 1;
+        b.S = S;
+        b.P = P;
+        b.map = (PX_T*)arena_alloc_rows(&ARENA, (size_t)S, (size_t)S * sizeof(PX_T));
+        mark = arena_mark(&ARENA);
+        b.ds = (PX_T*)arena_alloc(&ARENA, (size_t)P * (size_t)P * sizeof(PX_T));
+        b.aux = (PX_T*)arena_alloc(&ARENA, fc_ds_aux_cells(P) * sizeof(PX_T));
+        b.sink = fopen(BENCH_NULL, "w");
+        if (!b.map || !b.ds || !b.aux || !b.sink) {
+            if (b.sink) fclose(b.sink);
+            arena_free(&ARENA);
+            bench_skip(S, "memoire");
+            continue;
+        }
+        geo_ds_params(&b.dsp);
+        bench_run("diamond_square", S, (double)P * (double)P, (double)P * (double)P * sz, PX_FN(bench_ds), &b);
+        PX_FN(bench_ds)(&b);
+        bench_run("resample_bilinear", S, c, (c + (double)P * (double)P) * sz, PX_FN(bench_resample), &b);
+        PX_FN(bench_resample)(&b);
+        arena_release(&ARENA, mark);
+
+        b.tmp = (PX_T*)arena_alloc_rows(&ARENA, (size_t)S, (size_t)S * sizeof(PX_T));
+        if (b.tmp) bench_run("smooth_box", S, c, 2.0 * c * sz, PX_FN(bench_smooth), &b);
+        arena_release(&ARENA, mark);
+        bench_run("print_values", S, c, c * sz, PX_FN(bench_values), &b);
+
+        b.water = (unsigned char*)arena_alloc(&ARENA, cells);
+        q = arena_mark(&ARENA);
+        b.queue_x = (int*)arena_alloc(&ARENA, cells * sizeof(int));
+        b.queue_y = (int*)arena_alloc(&ARENA, cells * sizeof(int));
+        if (b.water && b.queue_x && b.queue_y) {
+            bench_run("flood", S, c, c * (sz + 1.0), PX_FN(bench_flood), &b);
+        }
+        arena_release(&ARENA, q);
+
+        b.rgb = (int*)arena_alloc(&ARENA, cells * 3 * sizeof(int));
+        if (b.water && b.rgb) {
+            bench_run("colour", S, c, c * (sz + 3.0 * sizeof(int)), PX_FN(bench_colour), &b);
+            PX_FN(bench_colour)(&b);
+            bench_run("write_ppm", S, c, c * 3.0, PX_FN(bench_ppm), &b);
+        }
+        fclose(b.sink);
+        arena_free(&ARENA);
+    }
+    return bench_end();
+}
+
+#undef PX_T
+#undef PX_C
+#undef PX_LOAD
+#undef PX_STORE
+#undef PX_FN
@@ -0,0 +1,42 @@
+/*
+ * geocolor.h — palette geographique de geo (eau, plage, plaine, roche, neige)
+ * C ANSI C89, en-tete seul (fonctions static), partage par geo.c et
+ * serveur.c : memes couleurs pour les cartes PPM et les tuiles servies.
+ */
+
+#ifndef GEOCOLOR_H
+#define GEOCOLOR_H
+
+#if defined(__GNUC__)
+#define GC_FN static __attribute__((unused))
+#else
+#define GC_FN static
+#endif
+
+/* Couleur d'une cellule de hauteur v, en eau ou non, niveau d'eau level */
+GC_FN void gc_color(double v, int water, double level, int *R, int *G, int *B) {
+    if (water) {
+        /* profondeur: bleu plus sombre si profond (composantes deja dans 0..255) */
+        double d = level - v;
+        d = (d < 0.0) ? 0.0 : (d > 1.0) ? 1.0 : d;
+        *R = (int)(10 + 30 * (1.0 - d));
+        *G = (int)(40 + 60 * (1.0 - d));
+        *B = (int)(120 + 120 * (1.0 - d));
+        return;
+    }
+    /* terre : sable -> vert -> roche -> neige */
+    if (v < 0.05) { *R=194; *G=178; *B=128; return; }    /* plage */
+    if (v < 0.30) { *R= 80; *G=160; *B= 60; return; }    /* plaine/foret */
+    if (v < 0.60) { *R=120; *G=120; *B=120; return; }    /* roches */
+    { *R=240; *G=240; *B=240; }                          /* neige */
+}
+
+/* Renforcement du rivage : foncer une cellule dont un voisin change
+   d'etat eau/terre */
+GC_FN void gc_shore(int *r, int *g, int *b) {
+    *r = (*r * 7) / 10;
+    *g = (*g * 7) / 10;
+    *b = (*b * 7) / 10;
+}
+
+#endif /* GEOCOLOR_H */
@@ -0,0 +1,130 @@
+/*
+ * isa.h — choix du jeu d'instructions au demarrage (--force-isa)
+ * C ANSI C89, en-tete seul (fonctions static), partage par plasma.c,
+ * geo.c, iso.c et fractale.c.
+ *
+ * Un seul binaire pour plusieurs generations de x86 : le code courant est
+ * compile pour la cible de base (-O2, sans -march), et les noyaux chauds
+ * existent en quatre variantes, compilees chacune pour son jeu
+ * d'instructions par __attribute__((target)) :
+ *   scalar   sans vectorisation
+ *   sse2     vecteurs 128 bits (toujours present en x86-64)
+ *   avx2     vecteurs 256 bits
+ *   avx512   vecteurs 512 bits (AVX-512 F et BW)
+ * isa_init interroge cpuid une fois (__builtin_cpu_supports, qui verifie
+ * aussi que le systeme sauvegarde les registres larges) et retient la
+ * meilleure variante ; --force-isa NOM impose une variante plus modeste,
+ * pour tester ou mesurer. Les tables de noyaux (simd_dispatch.h) sont
+ * remplies ensuite selon ISA.level.
+ *
+ * Les variantes font les memes operations dans le meme ordre pour chaque
+ * cellule ; en C ISO (-std=c89), gcc ne fusionne pas a*b+c en FMA
+ * (-ffp-contract=off) : resultats identiques bit a bit entre variantes,
+ * donc memes --checksum.
+ *
+ * Hors x86, ou avec un compilateur sans attribut target, seule la variante
+ * scalar existe.
+ */
+
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdio.h>
+#include <string.h>
+
+#define ISA_SCALAR 0
+#define ISA_SSE2   1
+#define ISA_AVX2   2
+#define ISA_AVX512 3
+#define ISA_COUNT  4
+
+#define ISA_CHUNK  256            /* cellules par tampon de noyau, sur la pile */
+
+#if defined(__GNUC__)
+#define ISA_FN static __attribute__((unused))
+#else
+#define ISA_FN static
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define ISA_X86 1
+#else
+#define ISA_X86 0
+#endif
+
+/* Attributs des variantes. gcc ne vectorise a -O2 que les boucles sans
+   reste (modele de cout "very-cheap") : les variantes vectorielles
+   demandent le modele complet, la variante scalar s'en prive. */
+#if ISA_X86 && !defined(__clang__)
+#define ISA_TARGET_SCALAR __attribute__((optimize("no-tree-vectorize")))
+#define ISA_TARGET_SSE2   __attribute__((target("sse2"), optimize("tree-vectorize", "vect-cost-model=dynamic")))
+#define ISA_TARGET_AVX2   __attribute__((target("avx2"), optimize("tree-vectorize", "vect-cost-model=dynamic")))
+#define ISA_TARGET_AVX512 __attribute__((target("avx512f,avx512bw"), optimize("tree-vectorize", "vect-cost-model=dynamic")))
+#elif ISA_X86
+#define ISA_TARGET_SCALAR
+#define ISA_TARGET_SSE2   __attribute__((target("sse2")))
+#define ISA_TARGET_AVX2   __attribute__((target("avx2")))
+#define ISA_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define ISA_TARGET_SCALAR
+#endif
+
+/* Sorties des noyaux, jamais confondues avec leurs entrees : sans cette
+   garantie, gcc ne vectorise pas les lectures indexees (gather) */
+#if defined(__GNUC__)
+#define ISA_RESTRICT __restrict__
+#else
+#define ISA_RESTRICT
+#endif
+
+typedef struct {
+    int level;                 /* variante retenue */
+    int best;                  /* meilleure variante de ce processeur */
+    int forced;                /* 1 si --force-isa */
+} Isa;
+
+static Isa ISA = { ISA_SCALAR, ISA_SCALAR, 0 };
+
+static const char *const isa_names[ISA_COUNT] = { "scalar", "sse2", "avx2", "avx512" };
+
+/* Meilleure variante executable ici */
+ISA_FN int isa_detect(void) {
+#if ISA_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return ISA_AVX512;
+    if (__builtin_cpu_supports("avx2")) return ISA_AVX2;
+    if (__builtin_cpu_supports("sse2")) return ISA_SSE2;
+#endif
+    return ISA_SCALAR;
+}
+
+/* Detection, puis --force-isa (force = nom, 0 si absent). Retourne -1
+   (message sur stderr) si le nom est inconnu ou la variante non executable
+   sur ce processeur. */
+ISA_FN int isa_init(const char *force) {
+    int i;
+    ISA.best = isa_detect();
+    ISA.level = ISA.best;
+    ISA.forced = 0;
+    if (!force) return 0;
+    for (i = 0; i < ISA_COUNT; ++i) {
+        if (strcmp(force, isa_names[i]) == 0) break;
+    }
+    if (i == ISA_COUNT) {
+        fprintf(stderr, "--force-isa : '%s' inconnu (scalar, sse2, avx2, avx512).\n", force);
+        return -1;
+    }
+    if (i > ISA.best) {
+        fprintf(stderr, "--force-isa : %s non disponible, ce processeur s'arrete a %s.\n",
+                force, isa_names[ISA.best]);
+        return -1;
+    }
+    ISA.level = i;
+    ISA.forced = 1;
+    return 0;
+}
+
+ISA_FN const char *isa_name(void) { return isa_names[ISA.level]; }
+
+#endif /* ISA_H */
@@ -5,6 +5,27 @@
  * Lecture: fichier texte avec width*height doubles (format "plasma --only-values")
  * Projection: tuiles isometriques (losange) + deux faces laterales
  * Occlusion: painter's algorithm par sommes (x+y) croissantes
+ * Precision: --precision f32|u16 stocke la grille en float ou en entiers
+ *   16 bits (h*65535) au lieu de double ; ecart <= 6e-8 (f32) ou 7.7e-6 (u16)
+ *   sur h, soit au plus 1 pixel de hauteur ou 1 niveau de gris d'ecart, et
+ *   seulement quand h*zs ou h*255 tombe a moins de cet ecart d'un demi-entier
+ * Mesure: --timings[=json] donne temps mur/CPU et debit de parse, raster, write
+ * Trace: --trace PATH ecrit ces etapes en evenements de trace Chrome (JSON)
+ * Compteurs: --counters ajoute cycles, instructions et defauts de cache par
+ *   etape (perf_event_open, Linux ; ignore si le noyau refuse)
+ * Bench: --bench[=k1,k2] mesure read_grid (fscanf), fill_tri, clear (fond)
+ *   et write_ppm sur des grilles S x S (--bench-sizes), resultats JSON
+ *   (bench.h)
+ * Controle: --checksum ecrit le CRC-32 de l'image sur stderr (checksum.h)
+ * Rasterisation: le balayage des lignes de triangle existe en variantes
+ *   scalar, sse2, avx2, avx512 choisies par cpuid ; --force-isa en impose
+ *   une (isa.h), image identique
+ * Flux: --stream lit une suite de heightmaps "HMAP W H fmt" + valeurs (texte
+ *   ou binaire) sur -i, stdin ou --stream-socket, et ecrit des images
+ *   numerotees ; tampons et fond precalcule reutilises d'une image a l'autre
+ * Budget: --deadline MS choisit un niveau de detail s (1, 2, 4...) : blocs
+ *   s x s moyennes, rendus en tuiles s fois plus grandes, image de meme
+ *   taille ; moins de faces a peindre (deadline.h, --deadline-model F)
  *
  * Compilation:
  *   cc -std=c89 -Wall -Wextra -O2 iso.c -o iso
@@ -13,9 +34,29 @@
  *   ./iso -x 64 -y 48 -i hmap.txt -o iso.ppm -tw 16 -th 8 -zs 80
  */
 
+/* madvise (arena.h) */
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "memsize.h"
+#include "arena.h"
+#include "timing.h"
+#include "bench.h"
+#include "checksum.h"
+#include "isa.h"
+#include "isorender.h"
+#include "deadline.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define ISO_SOCKET 1
+#else
+#define ISO_SOCKET 0
+#endif
 
 /* ----- Options et etat ----- */
 static int GRID_W = 20;
@@ -26,6 +67,24 @@ static int TILE_W = 16;                /* largeur d'une tuile isometrique */
 static int TILE_H = 8;                 /* hauteur d'une tuile isometrique */
 static int ZS     = 64;                /* echelle verticale */
 static int BG_R = 16, BG_G = 16, BG_B = 24; /* couleur de fond sombre */
+#define MAX_SIDE (1L << 30)            /* cote max. de la grille, borne avant (int) */
+
+/* Precision de stockage de la grille */
+#define PREC_F64 0
+#define PREC_F32 1
+#define PREC_U16 2
+static int PRECISION = PREC_F64;
+static size_t MAX_MEM = 0;             /* --max-mem, 0 : memoire physique */
+static int MEM_STATS = 0;              /* --mem-stats */
+static int TIMINGS_MODE = TM_OFF;      /* --timings[=table|json] */
+static Timings TIMINGS;
+static const char *TRACE_PATH = 0;     /* --trace PATH */
+static int COUNTERS_ON = 0;            /* --counters */
+static double CHECKSUM_Q = 0.0;        /* --checksum : CRC-32 de l'image */
+static const char *FORCE_ISA = 0;      /* --force-isa, 0 : detection */
+static int STREAM = 0;                 /* --stream : suite d'images */
+static const char *STREAM_SOCKET = 0;  /* --stream-socket PATH */
+static int LOD = 1;                    /* --deadline : cote des blocs moyennes */
 
 /* ----- Outils ----- */
 static void print_usage(const char *prog) {
@@ -39,6 +98,24 @@ static void print_usage(const char *prog) {
         "  -th N          hauteur de tuile isometrique (defaut 8)\n"
         "  -zs N          echelle verticale / hauteur max (defaut 64)\n"
         "  -bg r,g,b      fond (0..255, defaut 16,16,24)\n"
+        "  --precision P  stockage de la grille : f64 (defaut), f32 ou u16\n"
+        "  --max-mem MIB  budget memoire (defaut memoire physique, 0 = aucun)\n"
+        "  --mem-stats    memoire par etape (arene) sur stderr\n"
+        "  --timings[=json] temps mur/CPU et debit par etape sur stderr\n"
+        "  --trace PATH   trace Chrome (chrome://tracing, Perfetto) dans PATH\n"
+        "  --counters     compteurs materiels par etape (perf_event_open, Linux)\n"
+        "  --force-isa I  rasterisation scalar, sse2, avx2 ou avx512 (defaut : cpuid)\n"
+        "  --checksum     CRC-32 de l'image sur stderr\n"
+        "  --stream       suite de heightmaps \"HMAP W H txt|f64|f32|u16\" + valeurs,\n"
+        "                 images numerotees (-o out%%05d.ppm, sinon iso-000000.ppm...)\n"
+        "  --stream-socket PATH  meme flux, lu sur une socket UNIX (connexions successives)\n"
+        "  --bench[=k1,k2] microbenchmarks (JSON) : read_grid, fill_tri, clear, write_ppm\n"
+        "  --bench-sizes L cotes des grilles mesurees (defaut 256,1024,4096)\n"
+        "  --bench-reps N  repetitions (defaut 5) ; --bench-warmup N (defaut 1)\n"
+        "  --bench-baseline F reference JSON, regression au-dela de --bench-tolerance %% (10)\n"
+        "  --deadline MS  budget de temps (ms) : blocs de cellules moyennes, rendus\n"
+        "                 en tuiles plus grandes, si l'estimation deborde\n"
+        "  --deadline-model F couts mesures (JSON de --bench), sinon reference\n"
         , prog);
 }
 
@@ -74,11 +151,43 @@ static int parse_rgb(const char *s, int *r, int *g, int *b) {
     return 0;
 }
 
-/* Clamp entier 0..255 */
-static int clamp8(int v) {
-    if (v < 0) return 0;
-    if (v > 255) return 255;
-    return v;
+/* Taille d'une cellule de la grille selon la precision */
+static size_t grid_cell_size(void) {
+    if (PRECISION == PREC_F32) return sizeof(float);
+    if (PRECISION == PREC_U16) return sizeof(unsigned short);
+    return sizeof(double);
+}
+
+/* Lecture / ecriture d'une hauteur 0..1 dans la grille */
+static double grid_get(const void *grid, size_t i) {
+    if (PRECISION == PREC_F32) return (double)((const float*)grid)[i];
+    if (PRECISION == PREC_U16) return (double)((const unsigned short*)grid)[i] * (1.0 / 65535.0);
+    return ((const double*)grid)[i];
+}
+
+static void grid_set(void *grid, size_t i, double v) {
+    if (PRECISION == PREC_F32) ((float*)grid)[i] = (float)v;
+    else if (PRECISION == PREC_U16) ((unsigned short*)grid)[i] = (unsigned short)(v * 65535.0 + 0.5);
+    else ((double*)grid)[i] = v;
+}
+
+/* Lecture de W*H hauteurs texte (format "plasma --only-values"), bornees a
+   0..1. Retourne 0, ou -1 (message sur stderr) si l'entree est trop courte. */
+static int read_grid(FILE *f, void *grid, int W, int H) {
+    int x, y;
+    for (y = 0; y < H; ++y) {
+        for (x = 0; x < W; ++x) {
+            double v = 0.0;
+            if (fscanf(f, "%lf", &v) != 1) {
+                fprintf(stderr, "Fichier trop court ou invalide a y=%d x=%d.\n", y, x);
+                return -1;
+            }
+            if (v < 0.0) v = 0.0;
+            if (v > 1.0) v = 1.0;
+            grid_set(grid, (size_t)y * (size_t)W + (size_t)x, v);
+        }
+    }
+    return 0;
 }
 
 /* Ecriture PPM binaire P6 */
@@ -90,7 +199,7 @@ static int write_ppm(const char *path, const unsigned char *rgb, int W, int H) {
         return -1;
     }
     fprintf(f, "P6\n%d %d\n255\n", W, H);
-    want = (size_t)(W * H * 3);
+    want = (size_t)W * (size_t)H * 3;
     wrote = fwrite(rgb, 1, want, f);
     if (wrote != want) {
         fprintf(stderr, "Erreur d'ecriture PPM.\n");
@@ -101,64 +210,371 @@ static int write_ppm(const char *path, const unsigned char *rgb, int W, int H) {
     return 0;
 }
 
-/* Framebuffer: acces pixel avec clipping */
-static void put_px(unsigned char *fb, int W, int H, int x, int y, int r, int g, int b) {
-    int off;
-    if (x < 0 || y < 0 || x >= W || y >= H) return;
-    off = (y * W + x) * 3;
-    fb[off + 0] = (unsigned char)clamp8(r);
-    fb[off + 1] = (unsigned char)clamp8(g);
-    fb[off + 2] = (unsigned char)clamp8(b);
+/* ----- Niveau de detail (--deadline) ----- */
+
+/* Grille (W+s-1)/s x (H+s-1)/s des moyennes des blocs s x s de src
+   (blocs du bord tronques) */
+static void lod_reduce(const void *src, int W, int H, int s, void *dst) {
+    int w = (W + s - 1) / s, h = (H + s - 1) / s, x, y, i, j;
+    for (y = 0; y < h; ++y) {
+        for (x = 0; x < w; ++x) {
+            double sum = 0.0;
+            int n = 0;
+            for (j = y * s; j < H && j < (y + 1) * s; ++j) {
+                for (i = x * s; i < W && i < (x + 1) * s; ++i) {
+                    sum += grid_get(src, (size_t)j * (size_t)W + (size_t)i);
+                    n++;
+                }
+            }
+            grid_set(dst, (size_t)y * (size_t)w + (size_t)x, sum / n);
+        }
+    }
+}
+
+/* Duree estimee (ms) au niveau de detail s : lecture, fond, pixels peints
+   (le losange du dessus et deux faces de hauteur moyenne ZS/2 par
+   colonne), ecriture, pages neuves de la grille et de l'image */
+static double iso_estimate(int s) {
+    double N = (double)GRID_W * (double)GRID_H;
+    double w = (double)((GRID_W + s - 1) / s), h = (double)((GRID_H + s - 1) / s);
+    double tw = (double)TILE_W * s, th = (double)TILE_H * s;
+    int fbw, fbh;
+    if (ir_size((int)w, (int)h, TILE_W * s, TILE_H * s, ZS, &fbw, &fbh) != 0) return 1e30;
+    return dl_touch_ms((size_t)(N * grid_cell_size()) + (size_t)fbw * (size_t)fbh * 3)
+         + dl_ms("iso", "read_grid", N)
+         + dl_ms("iso", "clear", (double)fbw * (double)fbh)
+         + dl_ms("iso", "fill_tri", w * h * tw * (th + ZS) / 2.0)
+         + dl_ms("iso", "write_ppm", (double)fbw * (double)fbh);
+}
+
+/* Cout au niveau de detail 2^d (dl_degrade ; pas de passes) */
+static double iso_cost(int d, int passes) {
+    (void)passes;
+    return iso_estimate(1 << d);
 }
 
-/* Remplissage triangle plein (ints), test "meme signe" */
-static void fill_tri(unsigned char *fb, int W, int H,
-                     int x0, int y0, int x1, int y1, int x2, int y2,
-                     int r, int g, int b)
-{
-    int minx, maxx, miny, maxy, x, y;
-    long A01, B01, A12, B12, A20, B20;
-    long w0, w1, w2;
-
-    /* Boite englobante */
-    minx = x0; if (x1 < minx) minx = x1; if (x2 < minx) minx = x2;
-    maxx = x0; if (x1 > maxx) maxx = x1; if (x2 > maxx) maxx = x2;
-    miny = y0; if (y1 < miny) miny = y1; if (y2 < miny) miny = y2;
-    maxy = y0; if (y1 > maxy) maxy = y1; if (y2 > maxy) maxy = y2;
-
-    if (minx < 0) minx = 0;
-    if (miny < 0) miny = 0;
-    if (maxx >= W) maxx = W - 1;
-    if (maxy >= H) maxy = H - 1;
-
-    /* Coeffs des fonctions de bord */
-    A01 = (long)(y0 - y1); B01 = (long)(x1 - x0);
-    A12 = (long)(y1 - y2); B12 = (long)(x2 - x1);
-    A20 = (long)(y2 - y0); B20 = (long)(x0 - x2);
-
-    for (y = miny; y <= maxy; ++y) {
-        for (x = minx; x <= maxx; ++x) {
-            w0 = (long)(x - x1) * A12 + (long)(y - y1) * B12;
-            w1 = (long)(x - x2) * A20 + (long)(y - y2) * B20;
-            w2 = (long)(x - x0) * A01 + (long)(y - y0) * B01;
-
-            /* Remplir si tous >=0 ou tous <=0 (meme signe) */
-            if ( (w0 >= 0 && w1 >= 0 && w2 >= 0) ||
-                 (w0 <= 0 && w1 <= 0 && w2 <= 0) ) {
-                put_px(fb, W, H, x, y, r, g, b);
+/* --deadline : double s par les paliers de dl_degrade, tant que la grille
+   reduite garde au moins 8 cellules de cote (fond et lecture ne diminuent
+   pas avec s). Fixe LOD. */
+static void iso_deadline(void) {
+    int d = 0, dmax = 0, passes = 0, s;
+    int side = (GRID_W < GRID_H) ? GRID_W : GRID_H;
+    double est;
+    char what[96];
+    while (side / (2 << dmax) >= 8) dmax++;
+    est = dl_degrade(iso_cost, dmax, &d, &passes);
+    s = 1 << d;
+    what[0] = '\0';
+    if (s > 1) {
+        sprintf(what, "detail 1/%d, grille %dx%d -> %dx%d", s, GRID_W, GRID_H,
+                (GRID_W + s - 1) / s, (GRID_H + s - 1) / s);
+    }
+    LOD = s;
+    dl_report("iso", est, what);
+}
+
+/* ----- Microbenchmarks (--bench) ----- */
+
+typedef struct {
+    FILE *text;                /* S*S valeurs texte, comme plasma --only-values */
+    void *grid;
+    unsigned char *fb;         /* image S x S */
+    int S;
+} IsoBench;
+
+static void bench_read_grid(void *ctx) {
+    IsoBench *b = (IsoBench*)ctx;
+    rewind(b->text);
+    read_grid(b->text, b->grid, b->S, b->S);
+}
+
+/* Losanges de tuile TILE_W x TILE_H pavant l'image, deux triangles chacun */
+static void bench_fill_tri(void *ctx) {
+    IsoBench *b = (IsoBench*)ctx;
+    int hw = TILE_W / 2, hh = TILE_H / 2, row = 0, cx, cy;
+    if (hw < 1) hw = 1;
+    if (hh < 1) hh = 1;
+    for (cy = 0; cy < b->S + hh; cy += hh, ++row) {
+        for (cx = (row % 2) ? hw : 0; cx < b->S + hw; cx += 2 * hw) {
+            int g = (cx + cy) & 255;
+            ir_fill_tri(b->fb, b->S, b->S, cx, cy - hh, cx - hw, cy, cx + hw, cy, g, g, g);
+            ir_fill_tri(b->fb, b->S, b->S, cx, cy + hh, cx + hw, cy, cx - hw, cy, g, g, g);
+        }
+    }
+}
+
+static void bench_clear(void *ctx) {
+    IsoBench *b = (IsoBench*)ctx;
+    static const unsigned char bg[3] = { 16, 16, 24 };
+    ir_clear(b->fb, b->S, b->S, bg);
+}
+
+static void bench_write_ppm(void *ctx) {
+    IsoBench *b = (IsoBench*)ctx;
+    write_ppm(BENCH_NULL, b->fb, b->S, b->S);
+}
+
+static int iso_bench(void) {
+    static const char *prec[3] = { "f64", "f32", "u16" };
+    int k;
+    bench_begin("iso", prec[PRECISION]);
+    for (k = 0; k < BENCH.nsizes; ++k) {
+        IsoBench b;
+        Arena arena;
+        int S = BENCH.sizes[k];
+        size_t cells = (size_t)S * (size_t)S, j, need = 0;
+        unsigned long r = 12345UL;
+        double c = (double)cells, text;
+
+        mem_add_mul(&need, cells, grid_cell_size());
+        mem_add_mul(&need, cells, 3);
+        mem_add_mul(&need, 2, ARENA_ALIGN);
+        if (mem_check(need, MAX_MEM) != 0 || arena_init(&arena, need) != 0) {
+            bench_skip(S, "memoire");
+            continue;
+        }
+        b.S = S;
+        b.grid = arena_alloc(&arena, cells * grid_cell_size());
+        b.fb = (unsigned char*)arena_alloc(&arena, cells * 3);
+        b.text = tmpfile();
+        if (!b.grid || !b.fb || !b.text) {
+            if (b.text) fclose(b.text);
+            arena_free(&arena);
+            bench_skip(S, "memoire");
+            continue;
+        }
+        /* hauteurs pseudo-aleatoires, S par ligne */
+        for (j = 0; j < cells; ++j) {
+            r = r * 1664525UL + 1013904223UL;
+            fprintf(b.text, "%.6f%c", (double)((r >> 8) % 1000001UL) / 1e6,
+                    ((j + 1) % (size_t)S) ? ' ' : '\n');
+        }
+        text = (double)ftell(b.text);
+        memset(b.fb, 0, cells * 3);
+
+        bench_run("read_grid", S, c, text, bench_read_grid, &b);
+        bench_run("fill_tri", S, c, c * 3.0, bench_fill_tri, &b);
+        bench_run("clear", S, c, c * 3.0, bench_clear, &b);
+        bench_run("write_ppm", S, c, c * 3.0, bench_write_ppm, &b);
+
+        fclose(b.text);
+        arena_free(&arena);
+    }
+    return bench_end();
+}
+
+/* ----- Flux de heightmaps (--stream) ----- */
+
+#define STREAM_NAME 1024               /* longueur max. d'un nom de sortie */
+
+/* Tampons reutilises d'une image a l'autre : l'arene n'est agrandie que si
+   une image ne tient plus, la grille et l'image ne sont redecoupees que si
+   les dimensions changent. bgfb garde le fond deja peint : une copie par
+   image au lieu du remplissage pixel par pixel. */
+typedef struct {
+    Arena arena;
+    int live;                  /* arene reservee */
+    void *grid;
+    unsigned char *fb, *bgfb;
+    int W, H, FB_W, FB_H;      /* dimensions du decoupage en place */
+    size_t cell;
+    int text_prec;             /* stockage des valeurs texte (--precision) */
+    long count;                /* images rendues, numero de la suivante */
+    long grows;                /* reservations de l'arene */
+} IsoStream;
+
+/* Nom de la sortie n : le %d de OUT_PATH (largeur facultative, ex.
+   out%05d.ppm), sinon "-NNNNNN" insere avant l'extension */
+static void stream_name(char *name, long n) {
+    const char *pc = strchr(OUT_PATH, '%');
+    const char *dot = strrchr(OUT_PATH, '.');
+    if (pc) {
+        const char *q = pc + 1;
+        int width = 0;
+        while (*q >= '0' && *q <= '9') width = width * 10 + (*q++ - '0');
+        if (*q == 'd' && width <= 20 && !strchr(q, '%')) {
+            sprintf(name, "%.*s%0*ld%s", (int)(pc - OUT_PATH), OUT_PATH, width, n, q + 1);
+            return;
+        }
+    }
+    if (!dot || strchr(dot, '/')) dot = OUT_PATH + strlen(OUT_PATH);
+    sprintf(name, "%.*s-%06ld%s", (int)(dot - OUT_PATH), OUT_PATH, n, dot);
+}
+
+/* Tampons pour une image W x H (cellules de cell octets), rendu fbw x fbh.
+   Retourne 0, ou -1 (message sur stderr). */
+static int stream_buffers(IsoStream *st, int W, int H, size_t cell, int fbw, int fbh) {
+    size_t N = (size_t)W * (size_t)H, img = 0, need = 0;
+    unsigned char bg[3];
+    if (st->live && W == st->W && H == st->H && cell == st->cell && fbw == st->FB_W && fbh == st->FB_H) return 0;
+    mem_add_mul(&img, (size_t)fbw * 3, (size_t)fbh);
+    mem_add_mul(&need, N, cell);
+    mem_add_mul(&need, img, 2);
+    mem_add_mul(&need, 3, ARENA_ALIGN);
+    if (!st->live || need > st->arena.cap) {
+        if (st->live) arena_free(&st->arena);
+        st->live = 0;
+        if (mem_check(need, MAX_MEM) != 0) return -1;
+        if (arena_init(&st->arena, need) != 0) { fprintf(stderr, "Allocation impossible.\n"); return -1; }
+        arena_stage(&st->arena, "flux");
+        st->live = 1;
+        st->grows++;
+    }
+    arena_release(&st->arena, 0);
+    st->grid = arena_alloc(&st->arena, N * cell);
+    st->fb = (unsigned char*)arena_alloc(&st->arena, img);
+    st->bgfb = (unsigned char*)arena_alloc(&st->arena, img);
+    bg[0] = (unsigned char)BG_R; bg[1] = (unsigned char)BG_G; bg[2] = (unsigned char)BG_B;
+    ir_clear(st->bgfb, fbw, fbh, bg);
+    st->W = W; st->H = H; st->cell = cell; st->FB_W = fbw; st->FB_H = fbh;
+    return 0;
+}
+
+/* Lit et rend l'image suivante du flux f. Retourne 1 si rendue, 0 en fin
+   de flux (EOF ou ligne END), -1 en cas d'erreur (message sur stderr). */
+static int stream_frame(FILE *f, IsoStream *st) {
+    static const char *const fmts[4] = { "f64", "f32", "u16", "txt" };
+    char line[128], fmt[8], name[STREAM_NAME + 32];
+    int W, H, fbw, fbh, k;
+    size_t N, i2, img;
+
+    do {
+        if (!fgets(line, sizeof(line), f)) return 0;
+    } while (line[0] == '\n' || line[0] == '\r');
+    if (strncmp(line, "END", 3) == 0) return 0;
+    if (sscanf(line, "HMAP %d %d %7s", &W, &H, fmt) != 3 || W <= 0 || H <= 0) {
+        fprintf(stderr, "Flux : en-tete invalide apres %ld images (attendu \"HMAP W H txt|f64|f32|u16\").\n", st->count);
+        return -1;
+    }
+    for (k = 0; k < 4 && strcmp(fmt, fmts[k]) != 0; ++k) {}
+    if (k == 4) { fprintf(stderr, "Flux : format '%s' inconnu.\n", fmt); return -1; }
+    if (ir_size(W, H, TILE_W, TILE_H, ZS, &fbw, &fbh) != 0) {
+        fprintf(stderr, "Image isometrique trop grande.\n");
+        return -1;
+    }
+    /* valeurs binaires gardees telles quelles, texte selon --precision */
+    PRECISION = (k == 3) ? st->text_prec : k;
+    if (stream_buffers(st, W, H, grid_cell_size(), fbw, fbh) != 0) return -1;
+    N = (size_t)W * (size_t)H;
+    img = (size_t)fbw * (size_t)fbh * 3;
+
+    tm_begin(&TIMINGS, "parse");
+    if (k == 3) {
+        if (read_grid(f, st->grid, W, H) != 0) return -1;
+    } else {
+        if (fread(st->grid, grid_cell_size(), N, f) != N) {
+            fprintf(stderr, "Flux : image %ld tronquee.\n", st->count);
+            return -1;
+        }
+        if (k != PREC_U16) {
+            for (i2 = 0; i2 < N; ++i2) {
+                double v = grid_get(st->grid, i2);
+                if (!(v >= 0.0)) grid_set(st->grid, i2, 0.0);
+                else if (v > 1.0) grid_set(st->grid, i2, 1.0);
             }
         }
     }
+    tm_end(&TIMINGS, (double)N, (double)N * grid_cell_size());
+
+    tm_begin(&TIMINGS, "raster");
+    memcpy(st->fb, st->bgfb, img);
+    ir_draw(st->fb, fbw, fbh, st->grid, grid_get, W, H, TILE_W, TILE_H, ZS);
+    tm_end(&TIMINGS, (double)N, (double)img);
+    if (CHECKSUM_Q > 0.0) {
+        Crc ck;
+        char what[32];
+        ck_init(&ck);
+        ck_bytes(&ck, st->fb, img);
+        sprintf(what, "image %ld", st->count);
+        ck_report("iso", what, &ck, CHECKSUM_Q);
+    }
+
+    tm_begin(&TIMINGS, "write");
+    stream_name(name, st->count);
+    if (write_ppm(name, st->fb, fbw, fbh) != 0) {
+        fprintf(stderr, "Echec d'ecriture de %s\n", name);
+        return -1;
+    }
+    tm_end(&TIMINGS, (double)fbw * (double)fbh, (double)img);
+    st->count++;
+    return 1;
+}
+
+/* Images du flux f jusqu'a la fin. Retourne 0, ou -1 si erreur. */
+static int stream_file(FILE *f, IsoStream *st) {
+    int rc;
+    while ((rc = stream_frame(f, st)) > 0) {}
+    return rc;
 }
 
-/* Remplit un quadrilatere convexe en 2 triangles */
-static void fill_quad(unsigned char *fb, int W, int H,
-                      int x0, int y0, int x1, int y1,
-                      int x2, int y2, int x3, int y3,
-                      int r, int g, int b)
-{
-    fill_tri(fb, W, H, x0, y0, x1, y1, x2, y2, r, g, b);
-    fill_tri(fb, W, H, x0, y0, x2, y2, x3, y3, r, g, b);
+#if ISO_SOCKET
+/* Connexions successives sur la socket UNIX path, chacune un flux ; une
+   connexion en erreur est fermee, la suivante repart sur un en-tete. Une
+   ligne END termine le programme. */
+static int stream_socket(const char *path, IsoStream *st) {
+    struct sockaddr_un sa;
+    int lfd, done = 0;
+    if (strlen(path) >= sizeof(sa.sun_path)) { fprintf(stderr, "Chemin de socket trop long : %s\n", path); return -1; }
+    memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, path);
+    unlink(path);
+    lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0 || bind(lfd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || listen(lfd, 8) != 0) {
+        fprintf(stderr, "Impossible d'ecouter sur %s.\n", path);
+        if (lfd >= 0) close(lfd);
+        return -1;
+    }
+    while (!done) {
+        int fd = accept(lfd, 0, 0);
+        FILE *f;
+        int rc;
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            fprintf(stderr, "accept : %s\n", strerror(errno));
+            break;
+        }
+        f = fdopen(fd, "rb");
+        if (!f) { close(fd); continue; }
+        while ((rc = stream_frame(f, st)) > 0) {}
+        /* fin propre sans EOF : ligne END */
+        done = (rc == 0 && !feof(f));
+        fclose(f);
+    }
+    close(lfd);
+    unlink(path);
+    return 0;
+}
+#endif
+
+/* --stream : images de -i (ou stdin), ou de --stream-socket */
+static int iso_stream(void) {
+    IsoStream st;
+    int rc;
+    if (strlen(OUT_PATH) > STREAM_NAME) { fprintf(stderr, "Chemin de sortie trop long.\n"); return 1; }
+    memset(&st, 0, sizeof(st));
+    st.text_prec = PRECISION;
+    tm_init(&TIMINGS, "iso", TIMINGS_MODE);
+    if (STREAM_SOCKET) {
+#if ISO_SOCKET
+        rc = stream_socket(STREAM_SOCKET, &st);
+#else
+        fprintf(stderr, "--stream-socket : sockets UNIX non disponibles sur ce systeme.\n");
+        rc = -1;
+#endif
+    } else {
+        FILE *f = (IN_PATH && strcmp(IN_PATH, "-") != 0) ? fopen(IN_PATH, "rb") : stdin;
+        if (!f) { fprintf(stderr, "Impossible d'ouvrir '%s'.\n", IN_PATH); return 1; }
+        rc = stream_file(f, &st);
+        if (f != stdin) fclose(f);
+    }
+    if (MEM_STATS) {
+        fprintf(stderr, "flux : %ld images, %ld reservations de l'arene\n", st.count, st.grows);
+        if (st.live) arena_report(&st.arena, stderr);
+    }
+    if (st.live) arena_free(&st.arena);
+    tm_report(&TIMINGS, stderr);
+    return rc == 0 ? 0 : 1;
 }
 
 /* ----- Programme principal ----- */
@@ -170,11 +586,11 @@ int main(int argc, char **argv) {
         const char *a = argv[i];
         if (strcmp(a, "-x") == 0 && i + 1 < argc) {
             char *e = 0; long v = strtol(argv[i+1], &e, 10);
-            if (*e != '\0' || v <= 0) { print_usage(argv[0]); return 1; }
+            if (*e != '\0' || v <= 0 || v > MAX_SIDE) { print_usage(argv[0]); return 1; }
             GRID_W = (int)v; i += 2; continue;
         } else if (strcmp(a, "-y") == 0 && i + 1 < argc) {
             char *e = 0; long v = strtol(argv[i+1], &e, 10);
-            if (*e != '\0' || v <= 0) { print_usage(argv[0]); return 1; }
+            if (*e != '\0' || v <= 0 || v > MAX_SIDE) { print_usage(argv[0]); return 1; }
             GRID_H = (int)v; i += 2; continue;
         } else if (strcmp(a, "-i") == 0 && i + 1 < argc) {
             IN_PATH = argv[i+1]; i += 2; continue;
@@ -192,6 +608,39 @@ int main(int argc, char **argv) {
             char *e = 0; long v = strtol(argv[i+1], &e, 10);
             if (*e != '\0' || v < 0) { print_usage(argv[0]); return 1; }
             ZS = (int)v; i += 2; continue;
+        } else if (strcmp(a, "--precision") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i+1], "f64") == 0) PRECISION = PREC_F64;
+            else if (strcmp(argv[i+1], "f32") == 0) PRECISION = PREC_F32;
+            else if (strcmp(argv[i+1], "u16") == 0) PRECISION = PREC_U16;
+            else { print_usage(argv[0]); return 1; }
+            i += 2; continue;
+        } else if (strcmp(a, "--max-mem") == 0 && i + 1 < argc) {
+            if (mem_parse_mib(argv[i+1], &MAX_MEM) != 0) { print_usage(argv[0]); return 1; }
+            i += 2; continue;
+        } else if (strcmp(a, "--mem-stats") == 0) {
+            MEM_STATS = 1; i += 1; continue;
+        } else if (strncmp(a, "--timings", 9) == 0) {
+            if (tm_parse(a, &TIMINGS_MODE) != 1) { print_usage(argv[0]); return 1; }
+            i += 1; continue;
+        } else if (strcmp(a, "--trace") == 0 && i + 1 < argc) {
+            TRACE_PATH = argv[i+1]; i += 2; continue;
+        } else if (strcmp(a, "--force-isa") == 0 && i + 1 < argc) {
+            FORCE_ISA = argv[i+1]; i += 2; continue;
+        } else if (strcmp(a, "--counters") == 0) {
+            COUNTERS_ON = 1; i += 1; continue;
+        } else if (strncmp(a, "--checksum", 10) == 0) {
+            if (ck_parse(a, &CHECKSUM_Q) != 1) { print_usage(argv[0]); return 1; }
+            i += 1; continue;
+        } else if (strncmp(a, "--bench", 7) == 0) {
+            if (bench_parse(argc, argv, &i) != 1) { print_usage(argv[0]); return 1; }
+            continue;
+        } else if (strcmp(a, "--stream") == 0) {
+            STREAM = 1; i += 1; continue;
+        } else if (strcmp(a, "--stream-socket") == 0 && i + 1 < argc) {
+            STREAM = 1; STREAM_SOCKET = argv[i+1]; i += 2; continue;
+        } else if (strncmp(a, "--deadline", 10) == 0) {
+            if (dl_parse(argc, argv, &i) != 1) { print_usage(argv[0]); return 1; }
+            continue;
         } else if (strcmp(a, "-bg") == 0 && i + 1 < argc) {
             if (parse_rgb(argv[i+1], &BG_R, &BG_G, &BG_B) != 0) { print_usage(argv[0]); return 1; }
             i += 2; continue;
@@ -200,149 +649,107 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (TRACE_PATH && tr_init(TRACE_PATH, "iso") != 0) {
+        fprintf(stderr, "Impossible d'ouvrir '%s' en ecriture.\n", TRACE_PATH);
+        return 1;
+    }
+    if (isa_init(FORCE_ISA) != 0) return 1;
+    kernels_select(ISA.level);
+    if (BENCH.on) return iso_bench();
+    if (COUNTERS_ON && ct_init() == 0 && TIMINGS_MODE == TM_OFF) TIMINGS_MODE = TM_TABLE;
+    if (STREAM && DEADLINE.ms > 0.0) {
+        fprintf(stderr, "--deadline n'est pas disponible avec --stream.\n");
+        return 1;
+    }
+    if (STREAM) return iso_stream();
+    if (DEADLINE.ms > 0.0) iso_deadline();
+
     /* Lecture de la heightmap */
     {
-        long N = (long)GRID_W * (long)GRID_H;
-        double *grid = (double*)malloc((size_t)N * sizeof(double));
+        size_t N = (size_t)GRID_W * (size_t)GRID_H;
+        Arena arena;                   /* grille et framebuffer */
+        void *grid, *view;
         unsigned char *fb;
-        int FB_W, FB_H, MARGIN;
-        int x, y;
+        int FB_W, FB_H;
+        int VW = (GRID_W + LOD - 1) / LOD, VH = (GRID_H + LOD - 1) / LOD;
+        unsigned char bg[3];
         FILE *f;
 
-        if (!grid) { fprintf(stderr, "Allocation impossible.\n"); return 1; }
+        /* Dimensions de l'image isometrique, bornees pour rester en int */
+        {
+            size_t need = 0;
+            if (ir_size(VW, VH, TILE_W * LOD, TILE_H * LOD, ZS, &FB_W, &FB_H) != 0) {
+                fprintf(stderr, "Image isometrique trop grande.\n");
+                return 1;
+            }
+            mem_add_mul(&need, N, grid_cell_size());
+            if (LOD > 1) {
+                mem_add_mul(&need, (size_t)VW * (size_t)VH, grid_cell_size());
+                mem_add_mul(&need, 1, ARENA_ALIGN);
+            }
+            mem_add_mul(&need, (size_t)FB_W * 3, (size_t)FB_H);
+            mem_add_mul(&need, 2, ARENA_ALIGN);
+            if (mem_check(need, MAX_MEM) != 0) return 1;
+            tm_init(&TIMINGS, "iso", TIMINGS_MODE);
+            if (arena_init(&arena, need) != 0) { fprintf(stderr, "Allocation impossible.\n"); return 1; }
+        }
+
+        arena_stage(&arena, "lecture");
+        grid = arena_alloc(&arena, N * grid_cell_size());
 
         if (IN_PATH && strcmp(IN_PATH, "-") != 0) {
             f = fopen(IN_PATH, "r");
         } else {
             f = stdin;
         }
-        if (!f) { fprintf(stderr, "Impossible d'ouvrir '%s'.\n", IN_PATH ? IN_PATH : "(stdin)"); free(grid); return 1; }
-
-        for (y = 0; y < GRID_H; ++y) {
-            for (x = 0; x < GRID_W; ++x) {
-                double v = 0.0;
-                if (fscanf(f, "%lf", &v) != 1) {
-                    fprintf(stderr, "Fichier trop court ou invalide a y=%d x=%d.\n", y, x);
-                    if (f != stdin) fclose(f);
-                    free(grid);
-                    return 1;
-                }
-                if (v < 0.0) v = 0.0;
-                if (v > 1.0) v = 1.0;
-                grid[y * GRID_W + x] = v;
-            }
+        if (!f) { fprintf(stderr, "Impossible d'ouvrir '%s'.\n", IN_PATH ? IN_PATH : "(stdin)"); arena_free(&arena); return 1; }
+
+        tm_begin(&TIMINGS, "parse");
+        if (read_grid(f, grid, GRID_W, GRID_H) != 0) {
+            if (f != stdin) fclose(f);
+            arena_free(&arena);
+            return 1;
         }
         if (f != stdin) fclose(f);
-
-        /* Dimensions de l'image isometrique */
-        MARGIN = TILE_W; /* marge visuelle */
-        FB_W = (GRID_W + GRID_H) * (TILE_W / 2) + MARGIN * 2 + TILE_W;
-        FB_H = (GRID_W + GRID_H) * (TILE_H / 2) + ZS + MARGIN * 2 + TILE_H;
-
-        fb = (unsigned char*)malloc((size_t)FB_W * (size_t)FB_H * 3);
-        if (!fb) { fprintf(stderr, "Allocation framebuffer impossible.\n"); free(grid); return 1; }
-
-        /* Fond */
-        {
-            long i2, total = (long)FB_W * (long)FB_H * 3;
-            for (i2 = 0; i2 < total; i2 += 3) {
-                fb[i2+0] = (unsigned char)BG_R;
-                fb[i2+1] = (unsigned char)BG_G;
-                fb[i2+2] = (unsigned char)BG_B;
-            }
+        tm_end(&TIMINGS, (double)N, (double)N * grid_cell_size());
+
+        view = grid;
+        if (LOD > 1) {
+            arena_stage(&arena, "detail");
+            view = arena_alloc(&arena, (size_t)VW * (size_t)VH * grid_cell_size());
+            tm_begin(&TIMINGS, "lod");
+            lod_reduce(grid, GRID_W, GRID_H, LOD, view);
+            tm_end(&TIMINGS, (double)N, (double)N * grid_cell_size());
         }
 
-        /* Offsets pour centrer */
-        {
-            /* On decale de H * (TILE_W/2) a gauche pour bien placer l'origine */
-            int off_x = MARGIN + (GRID_H * (TILE_W / 2));
-            int off_y = MARGIN + ZS; /* laisser de la place pour l'elevation */
-
-            /* Peinture du fond vers l'avant: s = x + y */
-            int s, sx, sy;
-
-            for (s = 0; s <= (GRID_W - 1) + (GRID_H - 1); ++s) {
-                for (x = 0; x < GRID_W; ++x) {
-                    int gy = s - x;
-                    int gx = x;
-                    if (gy < 0 || gy >= GRID_H) continue;
-
-                    /* valeur de hauteur 0..1 */
-                    {
-                        double h = grid[gy * GRID_W + gx];
-                        int z = (int)(h * (double)ZS + 0.5);
-
-                        /* Centre iso au niveau du sommet (haut de la colonne) */
-                        sx = off_x + (gx - gy) * (TILE_W / 2);
-                        sy = off_y + (gx + gy) * (TILE_H / 2);
-
-                        /* Points du losange sommet (au niveau eleve sy - z) */
-                        {
-                            int cx = sx;
-                            int cy = sy - z;
-
-                            int top_x    = cx;
-                            int top_y    = cy - (TILE_H / 2);
-                            int left_x   = cx - (TILE_W / 2);
-                            int left_y   = cy;
-                            int right_x  = cx + (TILE_W / 2);
-                            int right_y  = cy;
-                            int bot_x    = cx;
-                            int bot_y    = cy + (TILE_H / 2);
-
-                            /* Points du losange au sol (base) */
-                            int base_cx  = sx;
-                            int base_cy  = sy;
-                            int b_left_x = base_cx - (TILE_W / 2);
-                            int b_left_y = base_cy;
-                            int b_right_x= base_cx + (TILE_W / 2);
-                            int b_right_y= base_cy;
-                            int b_bot_x  = base_cx;
-                            int b_bot_y  = base_cy + (TILE_H / 2);
-
-                            /* Couleurs en niveaux de gris, faces differenciees */
-                            {
-                                int g_top   = clamp8((int)(h * 255.0 + 0.5));
-                                int g_left  = clamp8((int)(g_top * 80 / 100));
-                                int g_right = clamp8((int)(g_top * 60 / 100));
-
-                                /* Faces laterales (gauche et droite) */
-                                fill_quad(fb, FB_W, FB_H,
-                                          left_x,  left_y,
-                                          b_left_x,b_left_y,
-                                          b_bot_x, b_bot_y,
-                                          bot_x,   bot_y,
-                                          g_left, g_left, g_left);
-
-                                fill_quad(fb, FB_W, FB_H,
-                                          right_x,  right_y,
-                                          bot_x,    bot_y,
-                                          b_bot_x,  b_bot_y,
-                                          b_right_x,b_right_y,
-                                          g_right, g_right, g_right);
-
-                                /* Dessus (losange) en deux triangles */
-                                fill_tri(fb, FB_W, FB_H, top_x, top_y, left_x, left_y, right_x, right_y,
-                                         g_top, g_top, g_top);
-                                fill_tri(fb, FB_W, FB_H, bot_x, bot_y, right_x, right_y, left_x, left_y,
-                                         g_top, g_top, g_top);
-                            }
-                        }
-                    }
-                }
-            }
+        arena_stage(&arena, "rendu");
+        fb = (unsigned char*)arena_alloc(&arena, (size_t)FB_W * (size_t)FB_H * 3);
+
+        tm_begin(&TIMINGS, "raster");
+        bg[0] = (unsigned char)BG_R; bg[1] = (unsigned char)BG_G; bg[2] = (unsigned char)BG_B;
+        ir_render(fb, FB_W, FB_H, view, grid_get, VW, VH, TILE_W * LOD, TILE_H * LOD, ZS, bg);
+        tm_end(&TIMINGS, (double)VW * (double)VH, (double)FB_W * (double)FB_H * 3.0);
+        if (CHECKSUM_Q > 0.0) {
+            Crc ck;
+            ck_init(&ck);
+            ck_bytes(&ck, fb, (size_t)FB_W * (size_t)FB_H * 3);
+            ck_report("iso", "image", &ck, CHECKSUM_Q);
         }
 
         /* Ecriture PPM */
+        arena_stage(&arena, "sortie");
+        tm_begin(&TIMINGS, "write");
         if (write_ppm(OUT_PATH, fb, FB_W, FB_H) != 0) {
             fprintf(stderr, "Echec d'ecriture de %s\n", OUT_PATH);
-            free(fb);
-            free(grid);
+            arena_free(&arena);
             return 1;
         }
 
-        free(fb);
-        free(grid);
+        tm_end(&TIMINGS, (double)FB_W * (double)FB_H, (double)FB_W * (double)FB_H * 3.0);
+
+        if (MEM_STATS) arena_report(&arena, stderr);
+        tm_report(&TIMINGS, stderr);
+        arena_free(&arena);
     }
 
     return 0;
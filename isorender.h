@@ -0,0 +1,206 @@
+/*
+ * isorender.h — rendu isometrique d'une heightmap 0..1 en image RGB
+ * C ANSI C89, en-tete seul (fonctions static), partage par iso.c et
+ * serveur.c.
+ *
+ * Tuiles isometriques (losange) et deux faces laterales par cellule, en
+ * niveaux de gris ; occlusion par l'algorithme du peintre, sommes (x+y)
+ * croissantes. Le balayage des lignes de triangle est le noyau
+ * KN.tri_fill (simd_dispatch.h, inclus ici) : appeler kernels_select
+ * apres isa_init avant le premier rendu.
+ *
+ * La grille est lue par une fonction get(grid, i), i = y * W + x, pour
+ * servir toutes les precisions de stockage ; ir_render n'alloue rien et ne
+ * touche aucun etat global, plusieurs threads peuvent rendre a la fois.
+ */
+
+#ifndef ISORENDER_H
+#define ISORENDER_H
+
+#include <stddef.h>
+#include "isa.h"
+#include "simd_dispatch.h"
+
+#if defined(__GNUC__)
+#define IR_FN static __attribute__((unused))
+#else
+#define IR_FN static
+#endif
+
+/* Clamp entier 0..255 */
+IR_FN int ir_clamp8(int v) {
+    if (v < 0) return 0;
+    if (v > 255) return 255;
+    return v;
+}
+
+/* Remplissage triangle plein (ints), test "meme signe", borne a l'image.
+   Le balayage des lignes est le noyau KN.tri_fill (simd_kernels.h). */
+IR_FN void ir_fill_tri(unsigned char *fb, int W, int H,
+                       int x0, int y0, int x1, int y1, int x2, int y2,
+                       int r, int g, int b)
+{
+    int minx, maxx, miny, maxy;
+    long A01, B01, A12, B12, A20, B20;
+    unsigned char rgb[3];
+
+    /* Boite englobante */
+    minx = x0; if (x1 < minx) minx = x1; if (x2 < minx) minx = x2;
+    maxx = x0; if (x1 > maxx) maxx = x1; if (x2 > maxx) maxx = x2;
+    miny = y0; if (y1 < miny) miny = y1; if (y2 < miny) miny = y2;
+    maxy = y0; if (y1 > maxy) maxy = y1; if (y2 > maxy) maxy = y2;
+
+    if (minx < 0) minx = 0;
+    if (miny < 0) miny = 0;
+    if (maxx >= W) maxx = W - 1;
+    if (maxy >= H) maxy = H - 1;
+    if (minx > maxx || miny > maxy) return;
+
+    /* Coeffs des fonctions de bord */
+    A01 = (long)(y0 - y1); B01 = (long)(x1 - x0);
+    A12 = (long)(y1 - y2); B12 = (long)(x2 - x1);
+    A20 = (long)(y2 - y0); B20 = (long)(x0 - x2);
+
+    rgb[0] = (unsigned char)ir_clamp8(r);
+    rgb[1] = (unsigned char)ir_clamp8(g);
+    rgb[2] = (unsigned char)ir_clamp8(b);
+    KN.tri_fill(fb + ((size_t)miny * (size_t)W + (size_t)minx) * 3, (size_t)W * 3,
+                maxx - minx + 1, maxy - miny + 1,
+                (long)(minx - x1) * A12 + (long)(miny - y1) * B12,
+                (long)(minx - x2) * A20 + (long)(miny - y2) * B20,
+                (long)(minx - x0) * A01 + (long)(miny - y0) * B01,
+                A12, A20, A01, B12, B20, B01, rgb);
+}
+
+/* Remplit un quadrilatere convexe en 2 triangles */
+IR_FN void ir_fill_quad(unsigned char *fb, int W, int H,
+                        int x0, int y0, int x1, int y1,
+                        int x2, int y2, int x3, int y3,
+                        int r, int g, int b)
+{
+    ir_fill_tri(fb, W, H, x0, y0, x1, y1, x2, y2, r, g, b);
+    ir_fill_tri(fb, W, H, x0, y0, x2, y2, x3, y3, r, g, b);
+}
+
+/* Dimensions de l'image pour une grille W x H, tuiles tw x th, echelle
+   verticale zs. Retourne 0, ou -1 si l'image depasse les int. */
+IR_FN int ir_size(int W, int H, int tw, int th, int zs, int *fbw, int *fbh) {
+    double fw = (double)(W + (double)H) * (double)(tw / 2) + 3.0 * tw;
+    double fh = (double)(W + (double)H) * (double)(th / 2) + zs + 2.0 * tw + th;
+    int margin = tw;               /* marge visuelle */
+    if (fw > 2147483647.0 || fh > 2147483647.0) return -1;
+    *fbw = (W + H) * (tw / 2) + margin * 2 + tw;
+    *fbh = (W + H) * (th / 2) + zs + margin * 2 + th;
+    return 0;
+}
+
+/* Fond bg sur toute l'image */
+IR_FN void ir_clear(unsigned char *fb, int fbw, int fbh, const unsigned char *bg) {
+    size_t i2, total = (size_t)fbw * (size_t)fbh * 3;
+    for (i2 = 0; i2 < total; i2 += 3) {
+        fb[i2+0] = bg[0];
+        fb[i2+1] = bg[1];
+        fb[i2+2] = bg[2];
+    }
+}
+
+/* Colonnes de la grille W x H peintes sur fb (fbw x fbh, dimensions de
+   ir_size), fond deja en place */
+IR_FN void ir_draw(unsigned char *fb, int fbw, int fbh,
+                   const void *grid, double (*get)(const void *, size_t), int W, int H,
+                   int tw, int th, int zs)
+{
+    int x;
+
+    /* Offsets pour centrer */
+    {
+        /* On decale de H * (tw/2) a gauche pour bien placer l'origine */
+        int off_x = tw + (H * (tw / 2));
+        int off_y = tw + zs; /* marge, puis place pour l'elevation */
+
+        /* Peinture du fond vers l'avant: s = x + y */
+        int s, sx, sy;
+
+        for (s = 0; s <= (W - 1) + (H - 1); ++s) {
+            for (x = 0; x < W; ++x) {
+                int gy = s - x;
+                int gx = x;
+                if (gy < 0 || gy >= H) continue;
+
+                /* valeur de hauteur 0..1 */
+                {
+                    double h = get(grid, (size_t)gy * (size_t)W + (size_t)gx);
+                    int z = (int)(h * (double)zs + 0.5);
+
+                    /* Centre iso au niveau du sommet (haut de la colonne) */
+                    sx = off_x + (gx - gy) * (tw / 2);
+                    sy = off_y + (gx + gy) * (th / 2);
+
+                    /* Points du losange sommet (au niveau eleve sy - z) */
+                    {
+                        int cx = sx;
+                        int cy = sy - z;
+
+                        int top_x    = cx;
+                        int top_y    = cy - (th / 2);
+                        int left_x   = cx - (tw / 2);
+                        int left_y   = cy;
+                        int right_x  = cx + (tw / 2);
+                        int right_y  = cy;
+                        int bot_x    = cx;
+                        int bot_y    = cy + (th / 2);
+
+                        /* Points du losange au sol (base) */
+                        int base_cx  = sx;
+                        int base_cy  = sy;
+                        int b_left_x = base_cx - (tw / 2);
+                        int b_left_y = base_cy;
+                        int b_right_x= base_cx + (tw / 2);
+                        int b_right_y= base_cy;
+                        int b_bot_x  = base_cx;
+                        int b_bot_y  = base_cy + (th / 2);
+
+                        /* Couleurs en niveaux de gris, faces differenciees */
+                        {
+                            int g_top   = ir_clamp8((int)(h * 255.0 + 0.5));
+                            int g_left  = ir_clamp8((int)(g_top * 80 / 100));
+                            int g_right = ir_clamp8((int)(g_top * 60 / 100));
+
+                            /* Faces laterales (gauche et droite) */
+                            ir_fill_quad(fb, fbw, fbh,
+                                         left_x,  left_y,
+                                         b_left_x,b_left_y,
+                                         b_bot_x, b_bot_y,
+                                         bot_x,   bot_y,
+                                         g_left, g_left, g_left);
+
+                            ir_fill_quad(fb, fbw, fbh,
+                                         right_x,  right_y,
+                                         bot_x,    bot_y,
+                                         b_bot_x,  b_bot_y,
+                                         b_right_x,b_right_y,
+                                         g_right, g_right, g_right);
+
+                            /* Dessus (losange) en deux triangles */
+                            ir_fill_tri(fb, fbw, fbh, top_x, top_y, left_x, left_y, right_x, right_y,
+                                        g_top, g_top, g_top);
+                            ir_fill_tri(fb, fbw, fbh, bot_x, bot_y, right_x, right_y, left_x, left_y,
+                                        g_top, g_top, g_top);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Rendu complet : fond bg, puis colonnes */
+IR_FN void ir_render(unsigned char *fb, int fbw, int fbh,
+                     const void *grid, double (*get)(const void *, size_t), int W, int H,
+                     int tw, int th, int zs, const unsigned char *bg)
+{
+    ir_clear(fb, fbw, fbh, bg);
+    ir_draw(fb, fbw, fbh, grid, get, W, H, tw, th, zs);
+}
+
+#endif /* ISORENDER_H */
@@ -0,0 +1,77 @@
+/*
+ * memsize.h — tailles de grilles en size_t et budget memoire
+ * C ANSI C89, en-tete seul (fonctions static), partage par plasma.c,
+ * geo.c et iso.c.
+ *
+ * Les indices de grille sont calcules en size_t : W*H depasse INT_MAX
+ * des 46341 x 46341. Avant d'allouer, chaque outil additionne ses besoins
+ * avec mem_mul / mem_add (echec si le produit ne tient pas dans l'espace
+ * d'adressage) et les compare au budget : --max-mem en Mio s'il est donne,
+ * sinon la memoire physique de la machine quand le systeme la fournit.
+ */
+
+#ifndef MEMSIZE_H
+#define MEMSIZE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#define MEM_SIZE_MAX ((size_t)-1)
+#define MEM_MIB      ((size_t)1 << 20)
+
+/* *acc += a * b ; retourne -1 (et *acc = MEM_SIZE_MAX) en cas de debordement */
+static int mem_add_mul(size_t *acc, size_t a, size_t b) {
+    size_t p;
+    if (*acc == MEM_SIZE_MAX) return -1;
+    if (a != 0 && b > MEM_SIZE_MAX / a) { *acc = MEM_SIZE_MAX; return -1; }
+    p = a * b;
+    if (p > MEM_SIZE_MAX - *acc) { *acc = MEM_SIZE_MAX; return -1; }
+    *acc += p;
+    return 0;
+}
+
+/* Memoire physique en octets, 0 si inconnue */
+static size_t mem_physical(void) {
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page > 0) {
+        if ((size_t)pages > MEM_SIZE_MAX / (size_t)page) return MEM_SIZE_MAX;
+        return (size_t)pages * (size_t)page;
+    }
+#endif
+    return 0;
+}
+
+/* Lecture de --max-mem (Mio, 0 = sans limite). Retourne -1 si invalide. */
+static int mem_parse_mib(const char *s, size_t *limit) {
+    char *e = 0;
+    unsigned long v = strtoul(s, &e, 10);
+    if (*s == '\0' || *e != '\0') return -1;
+    if (v == 0 || (size_t)v > MEM_SIZE_MAX / MEM_MIB) *limit = MEM_SIZE_MAX;
+    else *limit = (size_t)v * MEM_MIB;
+    return 0;
+}
+
+/* Verifie need (octets) contre le budget : limit si non nul, sinon la
+   memoire physique. Message sur stderr et -1 si la demande est refusee. */
+static int mem_check(size_t need, size_t limit) {
+    size_t budget = limit ? limit : mem_physical();
+    if (need == MEM_SIZE_MAX) {
+        fprintf(stderr, "Taille invalide : depasse l'espace d'adressage.\n");
+        return -1;
+    }
+    if (budget && need > budget) {
+        fprintf(stderr, "Taille trop grande : %lu Mio requis, budget %lu Mio (--max-mem).\n",
+                (unsigned long)((need + MEM_MIB - 1) / MEM_MIB),
+                (unsigned long)(budget / MEM_MIB));
+        return -1;
+    }
+    return 0;
+}
+
+#endif /* MEMSIZE_H */
@@ -1,5 +1,5 @@
 /*
- * Plasma fractal ASCII + export des valeurs (Diamond-Square)
+ * Plasma fractal ASCII + export des valeurs (Diamond-Square ou bruit fBm)
  * C ANSI C89 uniquement
  *
  * Options:
@@ -13,24 +13,129 @@
  *   -g, --gamma R          correction gamma (double, defaut 1.0)
  *       --values           imprime la grille normalisee apres l'ASCII
  *       --only-values      n'imprime que la grille normalisee
+ *       --generator G      ds (diamond-square, defaut), fbm (bruit simplex)
+ *                          ou fft (synthese spectrale)
+ *       --beta R           exposant spectral pour fft (defaut deduit de -k)
+ *       --wrap             carte periodique (tuilable sans raccord), ds ou fft
+ *       --precision P      stockage des grilles : f64 (defaut), f32, u16
+ *       --ds-layout L      level (defaut) ou strided : disposition memoire ds
+ *       --max-mem MIB      budget memoire (defaut : memoire physique)
+ *       --mem-stats        empreinte memoire par etape sur stderr
+ *       --timings[=json]   temps par etape (tableau ou JSON) sur stderr
+ *       --trace PATH       evenements de trace Chrome (JSON) dans PATH
+ *       --counters         compteurs materiels par etape (Linux, counters.h)
+ *       --bench[=k1,k2]    microbenchmarks des noyaux, JSON sur stdout (bench.h)
+ *       --checksum[=Q]     CRC-32 de la grille finale (quantifiee a 1/Q) sur stderr
+ *       --numa P           bands (defaut) : pages placees par les threads
+ *                          qui traitent chaque bande ; off : sans preparation
+ *       --force-isa I      noyaux scalar, sse2, avx2 ou avx512 (defaut : le
+ *                          meilleur du processeur, voir isa.h)
+ *       --progressive PATH apercus PPM des niveaux du diamond-square dans
+ *                          PATH (preview.h), pendant la generation
+ *       --deadline MS      budget de temps : grille ds plus grossiere, puis
+ *                          moins de passes de flou si l'estimation deborde
+ *                          (deadline.h) ; --deadline-model F : couts mesures
+ *       --animate N        N images animees dans le terminal (0 : jusqu'a
+ *                          Ctrl-C), palette cyclique, redessin differentiel
+ *       --fps F            images par seconde de --animate (defaut 60)
+ *       --term M           truecolor ou 256 : demi-blocs colores (degrade)
+ *                          au lieu de l'ASCII, deux lignes par caractere
+ *       --tune             mesure threads et bandes de lignes sur cette
+ *                          machine et les range dans le profil (tune.h)
+ *   -j, --threads N        threads (si compile avec -fopenmp ; defaut : le
+ *                          profil de fractale-tune.sh s'il existe)
  *   -h, --help             aide
  *
  * Compilation:
  *   cc -std=c89 -Wall -Wextra -O2 plasma.c -o plasma -lm
+ *   cc -std=c89 -Wall -Wextra -O2 -fopenmp plasma.c -o plasma -lm
+ *
+ * Generateur fbm : somme d'octaves de bruit simplex 2D. L'octave l a la
+ * frequence 2^l / (n-1) et l'amplitude a * k^l, comme les niveaux du
+ * diamond-square sur la grille n x n equivalente. Chaque point ne depend
+ * que de ses coordonnees et d'une table de permutation tiree de la graine :
+ * la carte s'evalue par ligne, par tuile ou par pixel, en parallele, sans
+ * grille intermediaire 2^n+1 ni artefacts alignes sur les axes.
+ * Une octave est evaluee le long d'une ligne par le noyau fbm_octave
+ * (simd_kernels.h) : coins et contributions vectorises sur x, seul le
+ * hachage dans la table de permutation reste scalaire.
+ *
+ * Precision : tout le pipeline (grille source, carte, flou, normalisation)
+ * est instancie pour trois types de stockage (plasma_pipeline.h). f32 divise
+ * la memoire par deux, u16 par quatre (valeurs quantifiees sur [0,1], pas
+ * 1/65535, la generation est remise a l'echelle pour tenir dans [0,1]).
+ * Ecart maximal sur les valeurs normalisees par rapport a f64 (ds, fbm, fft,
+ * wrap, flou ; mesure jusqu'a 1000x800) : f32 <= 1e-5, u16 <= 5e-4. Avec
+ * -g > 1, v^(1/g) amplifie l'ecart pres de 0 : u16 reste sous 5e-3. Cote
+ * ASCII, au plus un caractere de palette voisin a la frontiere de 2 niveaux.
+ *
+ * Jeux d'instructions : compile sans -march, le binaire contient les
+ * boucles internes (diamond-square, reechantillonnage, flou, normalisation,
+ * palette) en variantes scalar, SSE2, AVX2 et AVX-512, choisies au
+ * demarrage par cpuid (isa.h, simd_kernels.h). Resultats identiques.
+ *
+ * Animation (--animate) : la carte est calculee une fois, puis chaque image
+ * la traduit par une palette qui glisse d'un cran (aller-retour sur les
+ * niveaux, PLASMA_CYCLE caracteres par image) ; term.h n'envoie que les
+ * cellules modifiees, en un write par image. 200x60 a 60 images/s : moins
+ * de 0.1 ms de calcul et quelques Kio par image.
+ *
+ * Terminal couleur (--term) : la carte passe par un degrade (PLASMA_GRAD
+ * couleurs cles) et s'affiche en demi-blocs (term.h), 24 bits ou 256
+ * couleurs, sequences emises seulement aux changements de couleur.
+ *
+ * Reglage : au demarrage, le profil de la machine (tune.h, ecrit par
+ * fractale-tune.sh ou --tune) fixe le nombre de threads et la hauteur des
+ * bandes des boucles de lignes OpenMP. -j prime ; resultats identiques.
  */
 
+/* madvise (arena.h) */
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "fft.h"
+#include "memsize.h"
+#include "arena.h"
+#include "timing.h"
+#include "bench.h"
+#include "checksum.h"
+#include "isa.h"
+#include "fcore.h"
+#include "preview.h"
+#include "deadline.h"
+#include "tune.h"
+#include "term.h"
 
 /* Valeurs par defaut */
 #define DEFAULT_WIDTH   20
 #define DEFAULT_HEIGHT  20
 #define DEFAULT_PALETTE " .:-=+*#%@"
 
-/* Limite pour eviter des allocations immenses */
-#define MAX_CELLS 2000000L
+/* Animation : niveaux de la palette cyclique, pas de phase par image */
+#define PLASMA_LEVELS 256
+#define PLASMA_CYCLE  (1.0 / 60.0)
+
+/* --term : couleurs cles du degrade, de 0 a 1 */
+#define PLASMA_GRAD 5
+
+/* Cote maximal : la grille DS 2^k + 1 doit rester indexable en int */
+#define MAX_SIDE (1L << 30)
+
+/* Generateurs */
+#define GEN_DS  0
+#define GEN_FBM 1
+#define GEN_FFT 2
+
+/* Precisions de stockage des grilles */
+#define PREC_F64 0
+#define PREC_F32 1
+#define PREC_U16 2
 
 /* Etat global des options */
 static int width  = DEFAULT_WIDTH;
@@ -44,6 +149,27 @@ static const char *PALETTE = DEFAULT_PALETTE;
 static double GAMMA_CORR = 1.0;
 static int PRINT_VALUES = 0;
 static int ONLY_VALUES  = 0;
+static int GENERATOR = GEN_DS;
+static double BETA = 0.0;
+static int BETA_SET = 0;
+static int WRAP = 0;
+static int PRECISION = PREC_F64;
+static int DS_STRIDED = 0;
+static size_t MAX_MEM = 0;             /* --max-mem, 0 : memoire physique */
+static int MEM_STATS = 0;
+static int NUMA_BANDS = 1;             /* --numa bands|off */
+static Arena ARENA;                    /* toutes les grilles du pipeline */
+static int TIMINGS_MODE = TM_OFF;      /* --timings[=table|json] */
+static Timings TIMINGS;
+static const char *TRACE_PATH = 0;     /* --trace PATH */
+static int COUNTERS_ON = 0;            /* --counters */
+static double CHECKSUM_Q = 0.0;        /* --checksum[=Q], 0 : sans */
+static const char *FORCE_ISA = 0;      /* --force-isa, 0 : detection */
+static int DS_DROP = 0;                /* --deadline : niveaux ds retires */
+static int TUNE_RUN = 0;               /* --tune */
+static long ANIMATE = -1;              /* --animate N, -1 : sans, 0 : sans fin */
+static double FPS = 60.0;              /* --fps */
+static int TERM_MODE = TT_NONE;        /* --term */
 
 /* Aide */
 static void print_usage(const char *prog) {
@@ -59,6 +185,44 @@ static void print_usage(const char *prog) {
         "  -g, --gamma R          correction gamma (double)\n"
         "      --values           imprimer aussi la grille normalisee\n"
         "      --only-values      imprimer uniquement la grille normalisee\n"
+        "      --generator G      ds (defaut), fbm ou fft\n"
+        "      --beta R           exposant spectral pour fft (defaut 2 - 2 log2 k)\n"
+        "      --wrap             carte periodique, raccord parfait (ds, fft)\n"
+        "      --precision P      stockage des grilles : f64 (defaut), f32 ou u16\n"
+        "      --ds-layout L      level (defaut, par niveaux) ou strided (en place)\n"
+        "      --max-mem MIB      budget memoire (defaut memoire physique, 0 = aucun)\n"
+        "      --mem-stats        memoire par etape (arene) sur stderr\n"
+        "      --timings[=json]   temps mur/CPU et debit par etape sur stderr\n"
+        "      --trace PATH       trace Chrome (chrome://tracing, Perfetto) dans PATH\n"
+        "      --counters         cycles, instructions, defauts de cache/TLB/page par\n"
+        "                         etape (perf_event_open, Linux), avec --timings\n"
+        "      --checksum[=Q]     CRC-32 de la grille finale a la resolution 1/Q\n"
+        "                         (defaut 1e6) sur stderr\n"
+        "      --bench[=k1,k2]    microbenchmarks des noyaux (JSON sur stdout) :\n"
+        "                         diamond_square, resample_bilinear, box_blur,\n"
+        "                         normalize01, apply_gamma, print_values, print_ascii\n"
+        "      --bench-sizes L    cotes des grilles mesurees (defaut 256,1024,4096)\n"
+        "      --bench-reps N     repetitions mesurees (defaut 5) ; --bench-warmup N (1)\n"
+        "      --bench-baseline F reference JSON : regression si mediane > +10 %%\n"
+        "                         (--bench-tolerance PCT), code de sortie 1\n"
+        "      --numa P           pages des grilles : bands (defaut, 1er contact\n"
+        "                         par le thread de chaque bande) ou off\n"
+        "      --force-isa I      noyaux scalar, sse2, avx2 ou avx512 (defaut :\n"
+        "                         detection cpuid)\n"
+        "      --progressive PATH apercu PPM apres chaque niveau du diamond-square,\n"
+        "                         PATH remplace, ou un fichier par niveau si PATH\n"
+        "                         contient %%d\n"
+        "      --deadline MS      budget de temps (ms) : grille ds plus grossiere\n"
+        "                         puis moins de passes de flou si necessaire\n"
+        "      --deadline-model F couts mesures (JSON de --bench), sinon reference\n"
+        "      --animate N        N images animees dans le terminal (0 : jusqu'a Ctrl-C),\n"
+        "                         palette cyclique, seules les cellules changees partent\n"
+        "      --fps F            images par seconde de --animate (defaut 60)\n"
+        "      --term M           demi-blocs colores : truecolor (24 bits) ou 256\n"
+        "                         couleurs, au lieu de l'ASCII\n"
+        "      --tune             mesurer threads et bandes de lignes, les ranger\n"
+        "                         dans le profil ($FRACTALE_TUNE, ~/.fractale-tune)\n"
+        "  -j, --threads N        nombre de threads (avec -fopenmp ; defaut : profil)\n"
         "  -h, --help             cette aide\n", prog);
 }
 
@@ -81,11 +245,6 @@ static double frand01(void) {
     return (double)rand() / (double)(RAND_MAX);
 }
 
-/* Random double dans [-amp, +amp] */
-static double frand_symmetric(double amp) {
-    return (frand01() * 2.0 - 1.0) * amp;
-}
-
 /* Calcule le plus petit m = 2^n + 1 tel que m >= need */
 static int pow2plus1_at_least(int need) {
     long side = 1; /* representera (m - 1) */
@@ -94,203 +253,230 @@ static int pow2plus1_at_least(int need) {
     return (int)(side + 1);
 }
 
-/* Acces securise dans une grille carree n x n */
-static double get_src(double *src, int n, int x, int y) {
-    if (x < 0) { x = 0; }
-    else if (x >= n) { x = n - 1; }
-
-    if (y < 0) { y = 0; }
-    else if (y >= n) { y = n - 1; }
-
-    return src[y * n + x];
+/* Quantification [0,1] -> 0..65535, arrondi au plus proche */
+static unsigned short u16_store(float x) {
+    if (!(x > 0.0f)) return 0;
+    if (x >= 1.0f) return 65535;
+    return (unsigned short)(x * 65535.0f + 0.5f);
 }
 
-static void set_src(double *src, int n, int x, int y, double v) {
-    src[y * n + x] = v;
-}
+/* ----- Bruit fBm (simplex 2D) ----- */
 
-/* Diamond-Square sur une grille n x n, n = 2^k + 1 */
-static void diamond_square(double *src, int n, double amp, double decay) {
-    int step = n - 1;
-    int half;
-    double scale = amp;
-
-    /* coins */
-    set_src(src, n, 0,     0,     frand_symmetric(scale));
-    set_src(src, n, step,  0,     frand_symmetric(scale));
-    set_src(src, n, 0,     step,  frand_symmetric(scale));
-    set_src(src, n, step,  step,  frand_symmetric(scale));
-
-    while (step > 1) {
-        int x, y;
-        half = step / 2;
-
-        /* Diamond */
-        for (y = half; y < n; y += step) {
-            for (x = half; x < n; x += step) {
-                double a = get_src(src, n, x - half, y - half);
-                double b = get_src(src, n, x + half, y - half);
-                double c = get_src(src, n, x - half, y + half);
-                double d = get_src(src, n, x + half, y + half);
-                double avg = (a + b + c + d) * 0.25;
-                double off = frand_symmetric(scale);
-                set_src(src, n, x, y, avg + off);
-            }
-        }
+typedef struct {
+    unsigned char perm[512];   /* permutation doublee, tiree de la graine */
+    int octaves;
+    double freq0;              /* frequence de l'octave 0 */
+    double amp0, gain;         /* amplitude initiale et facteur par octave */
+} FbmCtx;
 
-        /* Square */
-        for (y = 0; y < n; y += half) {
-            int xstart = ((y / half) % 2) ? 0 : half;
-            for (x = xstart; x < n; x += step) {
-                double sum = 0.0;
-                int cnt = 0;
-                if (y - half >= 0) { sum += get_src(src, n, x, y - half); cnt++; }
-                if (y + half < n)  { sum += get_src(src, n, x, y + half); cnt++; }
-                if (x - half >= 0) { sum += get_src(src, n, x - half, y); cnt++; }
-                if (x + half < n)  { sum += get_src(src, n, x + half, y); cnt++; }
-                if (cnt > 0) {
-                    double avg = sum / (double)cnt;
-                    double off = frand_symmetric(scale);
-                    set_src(src, n, x, y, avg + off);
-                } else {
-                    set_src(src, n, x, y, frand_symmetric(scale));
-                }
-            }
-        }
-
-        step = half;
-        scale *= decay;
+/* Prepare le contexte pour une grille DS equivalente n x n.
+   Consomme le generateur rand() comme le ferait diamond_square. */
+static void fbm_init(FbmCtx *c, int n, double amp, double decay) {
+    int i;
+    for (i = 0; i < 256; ++i) c->perm[i] = (unsigned char)i;
+    for (i = 255; i > 0; --i) {
+        int j = rand() % (i + 1);
+        unsigned char t = c->perm[i]; c->perm[i] = c->perm[j]; c->perm[j] = t;
     }
+    for (i = 0; i < 256; ++i) c->perm[256 + i] = c->perm[i];
+
+    c->octaves = 0;
+    for (i = n - 1; i > 1; i >>= 1) c->octaves++;
+    if (c->octaves < 1) c->octaves = 1;
+    c->freq0 = 1.0 / (double)((n > 1) ? n - 1 : 1);
+    c->amp0 = amp;
+    c->gain = decay;
 }
 
-/* Bilinear sample src[n x n] vers dst[W x H] */
-static void resample_bilinear(double *src, int n, double *dst, int W, int H) {
-    int y, x;
+/* Evalue les pixels [x0,x1) de la ligne y d'une carte W x H, aux memes
+   coordonnees que resample_bilinear depuis la grille n x n. Chaque octave
+   est un appel du noyau vectoriel oct (fbm_octave de simd_kernels.h, table
+   PX_FN(KN)) sur toute la portion de ligne, sans dependance entre pixels ;
+   un intervalle d'un seul pixel ou une suite de lignes courtes donne
+   l'evaluation par pixel ou par tuile. */
+static void fbm_row(const FbmCtx *c, int n, int W, int H, int y, int x0, int x1,
+                    void (*oct)(const unsigned char *, double, double, double, double,
+                                int, int, double, double *),
+                    double *out) {
+    int x, l;
     double denomX = (W > 1) ? (double)(W - 1) : 1.0;
     double denomY = (H > 1) ? (double)(H - 1) : 1.0;
-    for (y = 0; y < H; ++y) {
-        double v = ((double)y) * (double)(n - 1) / denomY;
-        int v0 = (int)floor(v);
-        int v1 = v0 + 1; if (v1 >= n) v1 = n - 1;
-        double fy = v - (double)v0;
-        for (x = 0; x < W; ++x) {
-            double u = ((double)x) * (double)(n - 1) / denomX;
-            int u0 = (int)floor(u);
-            int u1 = u0 + 1; if (u1 >= n) u1 = n - 1;
-            double fx = u - (double)u0;
-
-            double p00 = get_src(src, n, u0, v0);
-            double p10 = get_src(src, n, u1, v0);
-            double p01 = get_src(src, n, u0, v1);
-            double p11 = get_src(src, n, u1, v1);
-
-            double a = p00 * (1.0 - fx) + p10 * fx;
-            double b = p01 * (1.0 - fx) + p11 * fx;
-            dst[y * W + x] = a * (1.0 - fy) + b * fy;
-        }
+    double sx = (double)(n - 1) / denomX;
+    double v = (double)y * (double)(n - 1) / denomY;
+    double f = c->freq0, a = c->amp0;
+
+    for (x = x0; x < x1; ++x) out[x - x0] = 0.0;
+    for (l = 0; l < c->octaves; ++l) {
+        double oy = v * f + 31.77 * (double)l;
+        double ox = 17.31 * (double)l;
+        oct(c->perm, sx, f, ox, oy, x0, x1 - x0, a, out);
+        f *= 2.0;
+        a *= c->gain;
     }
 }
 
-/* Box blur rayon r, p passes, resultat final garanti dans 'grid' */
-static void box_blur(double *grid, int W, int H, int r, int p) {
-    int pass, y, x, dy, dx;
-    if (r <= 0 || p <= 0) return;
-
-    {
-        double *tmp = (double*)malloc((size_t)W * (size_t)H * sizeof(double));
-        if (!tmp) return;
-
-        for (pass = 0; pass < p; ++pass) {
-            double *src = (pass % 2 == 0) ? grid : tmp;
-            double *dst = (pass % 2 == 0) ? tmp  : grid;
-
-            for (y = 0; y < H; ++y) {
-                for (x = 0; x < W; ++x) {
-                    double sum = 0.0;
-                    int cnt = 0;
-                    for (dy = -r; dy <= r; ++dy) {
-                        int yy = y + dy; if (yy < 0) yy = 0; if (yy >= H) yy = H - 1;
-                        for (dx = -r; dx <= r; ++dx) {
-                            int xx = x + dx; if (xx < 0) xx = 0; if (xx >= W) xx = W - 1;
-                            sum += src[yy * W + xx];
-                            cnt++;
-                        }
-                    }
-                    dst[y * W + x] = sum / (double)cnt;
-                }
-            }
+/* Capacite d'arene pour plasma_run avec les options courantes : carte
+   finale, plus le plus gros des deux etages temporaires (generation, ou
+   flou) qui reutilisent la meme zone. MEM_SIZE_MAX hors espace d'adressage. */
+static size_t plasma_mem_need(void) {
+    size_t cell = (PRECISION == PREC_U16) ? sizeof(unsigned short)
+                : (PRECISION == PREC_F32) ? sizeof(float) : sizeof(double);
+    size_t W = (size_t)width, H = (size_t)height, need = 0, gen = 0, blur = 0;
+    int side = (width > height) ? width : height;
+
+    if (GENERATOR == GEN_FBM) {
+        mem_add_mul(&gen, (size_t)fft_max_threads() * sizeof(double), W);
+    } else if (GENERATOR == GEN_FFT) {
+        size_t n = 2;
+        while (n < (size_t)side) n <<= 1;
+        mem_add_mul(&gen, n * cell, n);
+        if (cell != sizeof(double)) mem_add_mul(&gen, n * sizeof(double), n);
+        mem_add_mul(&gen, spectral_fbm_work((int)n), sizeof(double));
+    } else {
+        size_t n = (((size_t)pow2plus1_at_least(side) - 1) >> DS_DROP) + 1;
+        mem_add_mul(&gen, n * cell, n);
+        if (!DS_STRIDED) mem_add_mul(&gen, ((n - 1) / 2 + 1) * cell, (n - 1) / 2 + 1);
+        if (PREVIEW.path) {
+            /* apercu reechantillonne et ses pixels, pendant le DS */
+            mem_add_mul(&gen, pv_cells(width, height), cell + 3);
+            mem_add_mul(&gen, 2, ARENA_ALIGN);
         }
+    }
+    if (FILT_RADIUS > 0 && FILT_PASSES > 0) mem_add_mul(&blur, W * cell, H);
 
-        /* Si p est impair, le dernier ecrit a ete fait dans tmp -> recopier vers grid */
-        if ((p % 2) == 1) {
-            int i2, N = W * H;
-            for (i2 = 0; i2 < N; ++i2) grid[i2] = tmp[i2];
-        }
+    /* chaque bloc est arrondi a ARENA_ALIGN dans l'arene */
+    mem_add_mul(&need, W * cell, H);
+    mem_add_mul(&need, (gen > blur) ? gen : blur, 1);
+    mem_add_mul(&need, 4 * ARENA_ALIGN, 1);
+    return need;
+}
 
-        free(tmp);
-    }
+/* Duree estimee (ms) du pipeline ds sur une grille n x n avec passes
+   passes de flou : couts par cellule de deadline.h (noyaux de --bench) */
+static double plasma_estimate(int n, int passes) {
+    double cells = (double)width * (double)height;
+    double r = (2.0 * FILT_RADIUS + 1.0) / 5.0;   /* box_blur mesure au rayon 2 */
+    double ms = dl_touch_ms(plasma_mem_need())   /* majorant : grille complete */
+              + dl_ms("plasma", "diamond_square", (double)n * (double)n)
+              + dl_ms("plasma", "resample_bilinear", cells)
+              + dl_ms("plasma", "normalize01", cells);
+    if (FILT_RADIUS > 0) ms += passes * r * r * dl_ms("plasma", "box_blur", cells);
+    if (GAMMA_CORR > 0.0 && fabs(GAMMA_CORR - 1.0) >= 1e-12) ms += dl_ms("plasma", "apply_gamma", cells);
+    if (!ONLY_VALUES) ms += dl_ms("plasma", "print_ascii", cells);
+    if (PRINT_VALUES || ONLY_VALUES) ms += dl_ms("plasma", "print_values", cells);
+    return ms;
 }
 
-/* Normalisation vers [0,1] */
-static void normalize01(double *grid, int N) {
-    int i;
-    double mn = grid[0], mx = grid[0];
-    for (i = 1; i < N; ++i) {
-        if (grid[i] < mn) mn = grid[i];
-        if (grid[i] > mx) mx = grid[i];
-    }
-    if (mx - mn <= 1e-12) {
-        for (i = 0; i < N; ++i) grid[i] = 0.5;
-        return;
-    }
-    for (i = 0; i < N; ++i) grid[i] = (grid[i] - mn) / (mx - mn);
+/* Cout avec d niveaux du diamond-square retires (dl_degrade) */
+static double plasma_cost(int d, int passes) {
+    int n = pow2plus1_at_least((width > height) ? width : height);
+    return plasma_estimate(((n - 1) >> d) + 1, passes);
 }
 
-/* Applique gamma > 0 */
-static void apply_gamma(double *grid, int N, double gamma) {
-    int i;
-    if (gamma <= 0.0 || fabs(gamma - 1.0) < 1e-12) return;
-    for (i = 0; i < N; ++i) {
-        double v = grid[i];
-        if (v < 0.0) v = 0.0;
-        if (v > 1.0) v = 1.0;
-        grid[i] = pow(v, 1.0 / gamma);
+/* --deadline : niveaux fins du diamond-square (grille de cote au moins 9,
+   reechantillonnee a la taille demandee) et passes de flou, par les
+   paliers de dl_degrade. Fixe DS_DROP et FILT_PASSES. */
+static void plasma_deadline(void) {
+    int n = pow2plus1_at_least((width > height) ? width : height);
+    int d = 0, dmax = 0, passes = (FILT_RADIUS > 0) ? FILT_PASSES : 0;
+    double est;
+    char what[96];
+
+    while (((n - 1) >> (dmax + 1)) >= 8) dmax++;
+    est = dl_degrade(plasma_cost, dmax, &d, &passes);
+    what[0] = '\0';
+    if (d) sprintf(what, "grille ds %d -> %d", n, ((n - 1) >> d) + 1);
+    if (FILT_RADIUS > 0 && passes < FILT_PASSES) {
+        sprintf(what + strlen(what), "%sflou %d -> %d passes", d ? ", " : "", FILT_PASSES, passes);
+        FILT_PASSES = passes;
     }
+    DS_DROP = d;
+    dl_report("plasma", est, what);
 }
 
-/* Impression ASCII selon palette */
-static void print_ascii(double *grid, int W, int H, const char *palette) {
-    int y, x, plen = 0;
-    while (palette[plen] != '\0') plen++;
-    if (plen < 1) { palette = DEFAULT_PALETTE; plen = 10; }
+/* Parametres du diamond-square (fcore.h) pour les options courantes */
+static void plasma_ds_params(FcDs *p, double amp, double bias) {
+    p->amp = amp;
+    p->decay = DECAY;
+    p->bias = bias;
+    p->wrap = WRAP;
+    p->clamp01 = 0;
+    p->rand01 = frand01;
+    p->level = 0;
+    p->level_ctx = 0;
+}
 
-    for (y = 0; y < H; ++y) {
-        for (x = 0; x < W; ++x) {
-            double v = grid[y * W + x];
-            int idx = (int)(v * (double)(plen - 1) + 0.5);
-            if (idx < 0) idx = 0;
-            if (idx >= plen) idx = plen - 1;
-            putchar(palette[idx]);
-        }
-        putchar('\n');
+/* Palette cyclique de PLASMA_LEVELS caracteres pour la phase ph : la
+   valeur v montre le caractere de v + ph replie en aller-retour sur [0,1]
+   (ph = 0 : image fixe, a un niveau pres) */
+static void plasma_cycle(char *cyc, const char *palette, double ph) {
+    int j, plen = (int)strlen(palette);
+    if (plen < 1) { palette = DEFAULT_PALETTE; plen = 10; }
+    for (j = 0; j < PLASMA_LEVELS; ++j) {
+        double u = fmod((double)j / (double)(PLASMA_LEVELS - 1) + ph, 2.0);
+        int i;
+        if (u > 1.0) u = 2.0 - u;
+        i = (int)(u * (double)(plen - 1) + 0.5);
+        cyc[j] = palette[(i >= plen) ? plen - 1 : i];
     }
 }
 
-/* Impression des valeurs normalisees 0..1 */
-static void print_values(double *grid, int W, int H) {
-    int y, x;
-    for (y = 0; y < H; ++y) {
-        for (x = 0; x < W; ++x) {
-            double v = grid[y * W + x];
-            printf("%.6f", v);
-            if (x + 1 < W) putchar(' ');
-        }
-        putchar('\n');
+/* Couleur du degrade de --term pour v dans [0,1] */
+static void plasma_rgb(double v, unsigned char *px) {
+    static const unsigned char keys[PLASMA_GRAD][3] = {
+        {  8,   8,  64}, { 84,  16, 140}, {200,  48, 110}, {250, 150,  30}, {255, 250, 190}
+    };
+    double t;
+    int k, c;
+    v = (v < 0.0) ? 0.0 : (v > 1.0) ? 1.0 : v;
+    t = v * (double)(PLASMA_GRAD - 1);
+    k = (int)t;
+    if (k > PLASMA_GRAD - 2) k = PLASMA_GRAD - 2;
+    t -= (double)k;
+    for (c = 0; c < 3; ++c) {
+        px[c] = (unsigned char)((1.0 - t) * keys[k][c] + t * keys[k + 1][c] + 0.5);
     }
 }
 
+/* Echec d'allocation dans le pipeline */
+static int plasma_oom(void) {
+    fprintf(stderr, "Allocation memoire impossible.\n");
+    return 1;
+}
+
+/* ----- Pipeline, une instance par precision de stockage ----- */
+
+/* f64 : double, reference */
+#define PX_T double
+#define PX_C double
+#define PX_LOAD(v) (v)
+#define PX_STORE(x) (x)
+#define PX_UNIT 0
+#define PX_FN(name) name##_f64
+#include "plasma_pipeline.h"
+
+/* f32 : float, calcul en float */
+#define PX_T float
+#define PX_C float
+#define PX_LOAD(v) (v)
+#define PX_STORE(x) ((float)(x))
+#define PX_UNIT 0
+#define PX_FN(name) name##_f32
+#include "plasma_pipeline.h"
+
+/* u16 : entier 16 bits, valeur v/65535 dans [0,1], calcul en float */
+#define PX_T unsigned short
+#define PX_C float
+#define PX_LOAD(v) ((float)(v) * (1.0f / 65535.0f))
+#define PX_STORE(x) u16_store(x)
+#define PX_UNIT 1
+#define PX_FN(name) name##_u16
+#include "plasma_pipeline.h"
+
 int main(int argc, char **argv) {
-    int i;
+    int i, rc;
+
+    tn_init("plasma");
 
     /* Parsing simple */
     for (i = 1; i < argc; ) {
@@ -301,12 +487,12 @@ int main(int argc, char **argv) {
 
         } else if ((strcmp(a, "-x") == 0 || strcmp(a, "--width") == 0) && i + 1 < argc) {
             char *e = 0; long v = strtol(argv[i+1], &e, 10);
-            if (*e != '\0' || v <= 0) { print_usage(argv[0]); return 1; }
+            if (*e != '\0' || v <= 0 || v > MAX_SIDE) { print_usage(argv[0]); return 1; }
             width = (int)v; i += 2; continue;
 
         } else if ((strcmp(a, "-y") == 0 || strcmp(a, "--height") == 0) && i + 1 < argc) {
             char *e = 0; long v = strtol(argv[i+1], &e, 10);
-            if (*e != '\0' || v <= 0) { print_usage(argv[0]); return 1; }
+            if (*e != '\0' || v <= 0 || v > MAX_SIDE) { print_usage(argv[0]); return 1; }
             height = (int)v; i += 2; continue;
 
         } else if ((strcmp(a, "-s") == 0 || strcmp(a, "--seed") == 0) && i + 1 < argc) {
@@ -345,56 +531,178 @@ int main(int argc, char **argv) {
         } else if (strcmp(a, "--only-values") == 0) {
             ONLY_VALUES = 1; i += 1; continue;
 
+        } else if (strcmp(a, "--generator") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i+1], "ds") == 0) GENERATOR = GEN_DS;
+            else if (strcmp(argv[i+1], "fbm") == 0) GENERATOR = GEN_FBM;
+            else if (strcmp(argv[i+1], "fft") == 0) GENERATOR = GEN_FFT;
+            else { print_usage(argv[0]); return 1; }
+            i += 2; continue;
+
+        } else if (strcmp(a, "--wrap") == 0) {
+            WRAP = 1; i += 1; continue;
+
+        } else if (strcmp(a, "--precision") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i+1], "f64") == 0) PRECISION = PREC_F64;
+            else if (strcmp(argv[i+1], "f32") == 0) PRECISION = PREC_F32;
+            else if (strcmp(argv[i+1], "u16") == 0) PRECISION = PREC_U16;
+            else { print_usage(argv[0]); return 1; }
+            i += 2; continue;
+
+        } else if (strcmp(a, "--ds-layout") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i+1], "level") == 0) DS_STRIDED = 0;
+            else if (strcmp(argv[i+1], "strided") == 0) DS_STRIDED = 1;
+            else { print_usage(argv[0]); return 1; }
+            i += 2; continue;
+
+        } else if (strcmp(a, "--max-mem") == 0 && i + 1 < argc) {
+            if (mem_parse_mib(argv[i+1], &MAX_MEM) != 0) { print_usage(argv[0]); return 1; }
+            i += 2; continue;
+
+        } else if (strcmp(a, "--mem-stats") == 0) {
+            MEM_STATS = 1; i += 1; continue;
+
+        } else if (strncmp(a, "--timings", 9) == 0) {
+            if (tm_parse(a, &TIMINGS_MODE) != 1) { print_usage(argv[0]); return 1; }
+            i += 1; continue;
+
+        } else if (strcmp(a, "--trace") == 0 && i + 1 < argc) {
+            TRACE_PATH = argv[i+1]; i += 2; continue;
+
+        } else if (strcmp(a, "--counters") == 0) {
+            COUNTERS_ON = 1; i += 1; continue;
+
+        } else if (strncmp(a, "--checksum", 10) == 0) {
+            if (ck_parse(a, &CHECKSUM_Q) != 1) { print_usage(argv[0]); return 1; }
+            i += 1; continue;
+
+        } else if (strncmp(a, "--bench", 7) == 0) {
+            if (bench_parse(argc, argv, &i) != 1) { print_usage(argv[0]); return 1; }
+            continue;
+
+        } else if (strcmp(a, "--numa") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i+1], "bands") == 0) NUMA_BANDS = 1;
+            else if (strcmp(argv[i+1], "off") == 0) NUMA_BANDS = 0;
+            else { print_usage(argv[0]); return 1; }
+            i += 2; continue;
+
+        } else if (strcmp(a, "--force-isa") == 0 && i + 1 < argc) {
+            FORCE_ISA = argv[i+1]; i += 2; continue;
+
+        } else if (strcmp(a, "--progressive") == 0 && i + 1 < argc) {
+            PREVIEW.path = argv[i+1]; i += 2; continue;
+
+        } else if (strncmp(a, "--deadline", 10) == 0) {
+            if (dl_parse(argc, argv, &i) != 1) { print_usage(argv[0]); return 1; }
+            continue;
+
+        } else if (strcmp(a, "--animate") == 0 && i + 1 < argc) {
+            char *e = 0; long v = strtol(argv[i+1], &e, 10);
+            if (*e != '\0' || v < 0) { print_usage(argv[0]); return 1; }
+            ANIMATE = v; i += 2; continue;
+
+        } else if (strcmp(a, "--fps") == 0 && i + 1 < argc) {
+            char *e = 0; double v = strtod(argv[i+1], &e);
+            if (*e != '\0' || v <= 0.0) { print_usage(argv[0]); return 1; }
+            FPS = v; i += 2; continue;
+
+        } else if (strcmp(a, "--term") == 0 && i + 1 < argc) {
+            TERM_MODE = tt_mode(argv[i+1]);
+            if (TERM_MODE == TT_NONE) { print_usage(argv[0]); return 1; }
+            i += 2; continue;
+
+        } else if (strcmp(a, "--tune") == 0) {
+            TUNE_RUN = 1; i += 1; continue;
+
+        } else if (strcmp(a, "--beta") == 0 && i + 1 < argc) {
+            char *e = 0; double v = strtod(argv[i+1], &e);
+            if (*e != '\0') { print_usage(argv[0]); return 1; }
+            BETA = v; BETA_SET = 1; i += 2; continue;
+
+        } else if ((strcmp(a, "-j") == 0 || strcmp(a, "--threads") == 0) && i + 1 < argc) {
+            char *e = 0; long v = strtol(argv[i+1], &e, 10);
+            if (*e != '\0' || v <= 0) { print_usage(argv[0]); return 1; }
+#ifdef _OPENMP
+            omp_set_num_threads((int)v);
+#endif
+            i += 2; continue;
+
         } else {
             print_usage(argv[0]); return 1;
         }
     }
 
-    /* Checks de taille et allocations */
-    {
-        long total = (long)width * (long)height;
-        if (total <= 0 || total > MAX_CELLS) {
-            fprintf(stderr, "Taille invalide ou trop grande.\n");
-            return 1;
-        }
+    if (TRACE_PATH && tr_init(TRACE_PATH, "plasma") != 0) {
+        fprintf(stderr, "Impossible d'ouvrir '%s' en ecriture.\n", TRACE_PATH);
+        return 1;
     }
 
-    srand((unsigned)SEED);
+    if (isa_init(FORCE_ISA) != 0) return 1;
+    kernels_select_f64(ISA.level);
+    kernels_select_f32(ISA.level);
+    kernels_select_u16(ISA.level);
 
-    /* Grille source carree n x n pour DS */
-    {
-        int need = (width > height) ? width : height;
-        int n = pow2plus1_at_least(need);
-        double *src = (double*)malloc((size_t)n * (size_t)n * sizeof(double));
-        double *dst = (double*)malloc((size_t)width * (size_t)height * sizeof(double));
-        if (!src || !dst) {
-            fprintf(stderr, "Allocation memoire impossible.\n");
-            if (src) free(src);
-            if (dst) free(dst);
-            return 1;
+    if (TUNE_RUN) {
+        switch (PRECISION) {
+        case PREC_F32: return plasma_tune_f32();
+        case PREC_U16: return plasma_tune_u16();
+        default:       return plasma_tune_f64();
         }
+    }
 
-        diamond_square(src, n, AMP, DECAY);
-        resample_bilinear(src, n, dst, width, height);
-
-        if (FILT_RADIUS > 0 && FILT_PASSES > 0) {
-            box_blur(dst, width, height, FILT_RADIUS, FILT_PASSES);
+    if (BENCH.on) {
+        /* noyaux seuls : -x/-y ignores, tailles de --bench-sizes */
+        if (FILT_RADIUS <= 0 || FILT_PASSES <= 0) { FILT_RADIUS = 2; FILT_PASSES = 1; }
+        if (fabs(GAMMA_CORR - 1.0) < 1e-12) GAMMA_CORR = 2.2;
+        switch (PRECISION) {
+        case PREC_F32: return plasma_bench_f32("f32");
+        case PREC_U16: return plasma_bench_u16("u16");
+        default:       return plasma_bench_f64("f64");
         }
+    }
 
-        normalize01(dst, width * height);
-        apply_gamma(dst, width * height, GAMMA_CORR);
+    if (WRAP && GENERATOR == GEN_FBM) {
+        fprintf(stderr, "--wrap n'est disponible qu'avec les generateurs ds et fft.\n");
+        return 1;
+    }
 
-        if (!ONLY_VALUES) {
-            print_ascii(dst, width, height, PALETTE);
-        }
-        if (PRINT_VALUES || ONLY_VALUES) {
-            if (!ONLY_VALUES) putchar('\n');
-            print_values(dst, width, height);
-        }
+    if (PREVIEW.path && (GENERATOR != GEN_DS || DS_STRIDED)) {
+        fprintf(stderr, "--progressive n'est disponible qu'avec le generateur ds (--ds-layout level).\n");
+        return 1;
+    }
 
-        free(src);
-        free(dst);
+    if (TERM_MODE != TT_NONE && (ANIMATE >= 0 || ONLY_VALUES)) {
+        fprintf(stderr, "--term n'est pas compatible avec --animate ni --only-values.\n");
+        return 1;
     }
 
-    return 0;
+    if (ANIMATE >= 0 && (PRINT_VALUES || ONLY_VALUES)) {
+        fprintf(stderr, "--animate n'est pas compatible avec --values ni --only-values.\n");
+        return 1;
+    }
+
+    if (DEADLINE.ms > 0.0) {
+        if (GENERATOR != GEN_DS) {
+            fprintf(stderr, "--deadline n'est disponible qu'avec le generateur ds.\n");
+            return 1;
+        }
+        plasma_deadline();
+    }
+
+    if (mem_check(plasma_mem_need(), MAX_MEM) != 0) return 1;
+
+    srand((unsigned)SEED);
+
+    if (COUNTERS_ON && ct_init() == 0 && TIMINGS_MODE == TM_OFF) TIMINGS_MODE = TM_TABLE;
+    tm_init(&TIMINGS, "plasma", TIMINGS_MODE);
+    if (arena_init(&ARENA, plasma_mem_need()) != 0) return plasma_oom();
+    ARENA.first_touch = NUMA_BANDS && fft_max_threads() > 1;
+    switch (PRECISION) {
+    case PREC_F32: rc = plasma_run_f32(); break;
+    case PREC_U16: rc = plasma_run_u16(); break;
+    default:       rc = plasma_run_f64(); break;
+    }
+    if (MEM_STATS) arena_report(&ARENA, stderr);
+    arena_free(&ARENA);
+    tm_report(&TIMINGS, stderr);
+    return rc;
 }
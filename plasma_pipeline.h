@@ -0,0 +1,493 @@
+/*
+ * plasma_pipeline.h — noyaux du pipeline plasma, generiques sur la precision
+ * C ANSI C89
+ *
+ * Ce fichier est inclus plusieurs fois par plasma.c, une fois par precision
+ * de stockage (pas de garde d'inclusion, c'est voulu). Avant chaque
+ * inclusion, plasma.c definit :
+ *   PX_T         type de stockage des grilles (double, float, unsigned short)
+ *   PX_C         type de calcul (double ou float)
+ *   PX_LOAD(v)   valeur stockee -> PX_C
+ *   PX_STORE(x)  PX_C -> valeur stockee
+ *   PX_UNIT      1 si le stockage n'accepte que [0,1] (entiers quantifies)
+ *   PX_FN(nom)   nom de la fonction generee pour cette precision
+ * Les macros sont retirees a la fin du fichier.
+ *
+ * Avec PX_UNIT, la generation travaille dans le domaine [0,1] : amplitude
+ * divisee par 2B (B borne des valeurs atteignables) et biais 0.5. Cette
+ * transformation affine est annulee par fc_normalize01.
+ *
+ * Diamond-square, reechantillonnage, flou et normalisation : noyaux
+ * communs de fcore.h, les memes que geo. La palette passe par la table
+ * PX_FN(KN) de simd_dispatch.h, remplie selon le jeu d'instructions.
+ */
+
+#include "fcore.h"
+
+/* Remplit dst[W x H] par le bruit fBm, lignes reparties entre threads.
+   scratch : W doubles par thread. */
+static void PX_FN(fbm_generate)(const FbmCtx *c, int n, PX_T *dst, int W, int H,
+                                double bias, double *scratch)
+{
+    int y;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        double t0 = tr_begin();
+        long first = -1, count = 0;
+#ifdef _OPENMP
+#pragma omp for schedule(static, tn_rows(H)) nowait
+#endif
+        for (y = 0; y < H; ++y) {
+            double *row = scratch + (size_t)fft_thread_id() * (size_t)W;
+            PX_T *out = dst + (size_t)y * (size_t)W;
+            int x;
+            fbm_row(c, n, W, H, y, 0, W, PX_FN(KN).fbm_octave, row);
+            for (x = 0; x < W; ++x) out[x] = PX_STORE((PX_C)(bias + row[x]));
+            if (count++ == 0) first = y;
+        }
+        tr_end("band", "fbm", t0, first, count);
+    }
+}
+
+/* Applique gamma > 0 */
+static void PX_FN(apply_gamma)(PX_T *grid, size_t N, double gamma) {
+    size_t i;
+    if (gamma <= 0.0 || fabs(gamma - 1.0) < 1e-12) return;
+    for (i = 0; i < N; ++i) {
+        double v = (double)PX_LOAD(grid[i]);
+        if (v < 0.0) v = 0.0;
+        if (v > 1.0) v = 1.0;
+        grid[i] = PX_STORE((PX_C)pow(v, 1.0 / gamma));
+    }
+}
+
+/* Impression ASCII selon palette sur f */
+static void PX_FN(print_ascii)(const PX_T *grid, int W, int H, const char *palette, FILE *f) {
+    int y, x, plen = 0;
+    char buf[ISA_CHUNK];
+    while (palette[plen] != '\0') plen++;
+    if (plen < 1) { palette = DEFAULT_PALETTE; plen = 10; }
+
+    for (y = 0; y < H; ++y) {
+        const PX_T *row = grid + (size_t)y * (size_t)W;
+        for (x = 0; x < W; x += ISA_CHUNK) {
+            int len = (W - x < ISA_CHUNK) ? W - x : ISA_CHUNK;
+            PX_FN(KN).palette_row(row + x, len, palette, plen, buf);
+            fwrite(buf, 1, (size_t)len, f);
+        }
+        putc('\n', f);
+    }
+}
+
+/* Ligne y de la carte en couleurs du degrade (--term) */
+static void PX_FN(term_row)(void *ctx, int y, unsigned char *rgb) {
+    const PX_T *row = (const PX_T*)ctx + (size_t)y * (size_t)width;
+    int x;
+    for (x = 0; x < width; ++x) plasma_rgb((double)PX_LOAD(row[x]), rgb + 3 * x);
+}
+
+/* Animation dans le terminal (--animate) : palette cyclique, une image
+   toutes les 1/FPS s, redessin differentiel (term.h). Bilan sur stderr. */
+static int PX_FN(animate)(const PX_T *grid, int W, int H) {
+    TtFrame t;
+    char cyc[PLASMA_LEVELS];
+    long f;
+    int y, x;
+
+    if (tt_open(&t, W, H) != 0) return plasma_oom();
+    for (f = 0; (ANIMATE == 0 || f < ANIMATE) && !TT_STOP; ++f) {
+        double t0 = tr_wall();
+        plasma_cycle(cyc, PALETTE, (double)f * PLASMA_CYCLE);
+        for (y = 0; y < H; ++y) {
+            const PX_T *row = grid + (size_t)y * (size_t)W;
+            char *out = t.cur + (size_t)y * (size_t)W;
+            for (x = 0; x < W; x += ISA_CHUNK) {
+                int len = (W - x < ISA_CHUNK) ? W - x : ISA_CHUNK;
+                PX_FN(KN).palette_row(row + x, len, cyc, PLASMA_LEVELS, out + x);
+            }
+        }
+        tt_flush(&t);
+        tt_sleep(1.0 / FPS - (tr_wall() - t0));
+    }
+    tt_close(&t);
+    if (t.frames > 0) {
+        fprintf(stderr, "plasma : %ld images, %.3f ms et %.0f octets par image\n",
+                t.frames, 1e3 * t.secs / (double)t.frames, t.bytes / (double)t.frames);
+    }
+    return 0;
+}
+
+/* Impression des valeurs normalisees 0..1 sur f */
+static void PX_FN(print_values)(const PX_T *grid, int W, int H, FILE *f) {
+    int y, x;
+    for (y = 0; y < H; ++y) {
+        const PX_T *row = grid + (size_t)y * (size_t)W;
+        for (x = 0; x < W; ++x) {
+            double v = (double)PX_LOAD(row[x]);
+            fprintf(f, "%.6f", v);
+            if (x + 1 < W) putc(' ', f);
+        }
+        putc('\n', f);
+    }
+}
+
+#if PX_UNIT
+/* Borne B des valeurs brutes du generateur (|v| <= B) */
+static double PX_FN(gen_bound)(int n) {
+    double b = fabs(AMP), s = fabs(AMP);
+    int step;
+    if (GENERATOR == GEN_FBM) {
+        b = 0.0;
+        for (step = n - 1; step > 1; step >>= 1) { b += s; s *= DECAY; }
+        return (b > 0.0) ? b : fabs(AMP);
+    }
+    /* coins, puis un decalage par niveau */
+    for (step = n - 1; step > 1; step >>= 1) { b += s; s *= DECAY; }
+    return b;
+}
+#endif
+
+/* Apercu du niveau de cote side (crochet FcDs.level, preview.h) : grille
+   compacte reechantillonnee, en gris de son minimum a son maximum.
+   Tampons pris dans l'arene ctx et rendus aussitot. */
+static void PX_FN(plasma_preview)(void *ctx, const void *grid, int side) {
+    Arena *A = (Arena*)ctx;
+    size_t mark = arena_mark(A), N, i;
+    double t0 = tr_begin();
+    int pw, ph;
+    PX_T *g;
+    unsigned char *rgb;
+    PX_C mn, mx, d;
+    if (!pv_dims(side, &pw, &ph)) return;
+    N = (size_t)pw * (size_t)ph;
+    g = (PX_T*)arena_alloc(A, N * sizeof(PX_T));
+    rgb = (unsigned char*)arena_alloc(A, N * 3);
+    if (g && rgb) {
+        PX_FN(fc_resample)((const PX_T*)grid, side, WRAP ? side - 1 : 0, g, pw, ph);
+        PX_FN(KN).minmax(g, N, &mn, &mx);
+        d = (mx - mn > (PX_C)0) ? mx - mn : (PX_C)1;
+        for (i = 0; i < N; ++i) {
+            unsigned char v = (unsigned char)((PX_LOAD(g[i]) - mn) / d * (PX_C)255 + (PX_C)0.5);
+            rgb[3 * i] = rgb[3 * i + 1] = rgb[3 * i + 2] = v;
+        }
+        pv_write(rgb, pw, ph, side);
+    }
+    arena_release(A, mark);
+    tr_end("preview", "level", t0, (long)side, (long)N);
+}
+
+/* Pipeline complet : generation, reechantillonnage, flou, normalisation,
+   gamma, sorties. Retourne le code de sortie du programme. */
+static int PX_FN(plasma_run)(void) {
+    Arena *A = &ARENA;
+    int need = (width > height) ? width : height;
+    int n = pow2plus1_at_least(need);
+    double amp = AMP, bias = 0.0;
+    size_t cells = (size_t)width * (size_t)height;
+    size_t mark;
+    PX_T *src = 0, *dst;
+
+    if (GENERATOR == GEN_FFT) {
+        /* grille periodique N x N, N puissance de 2 >= need */
+        n = 2;
+        while (n < need) n <<= 1;
+    }
+    if (GENERATOR == GEN_DS) n = ((n - 1) >> DS_DROP) + 1;   /* --deadline */
+#if PX_UNIT
+    {
+        double B = PX_FN(gen_bound)(n);
+        if (B > 0.0) amp = AMP / (2.0 * B);
+        bias = 0.5;
+    }
+#endif
+
+    arena_stage(A, "generation");
+    dst = (PX_T*)arena_alloc_rows(A, (size_t)height, (size_t)width * sizeof(PX_T));
+    if (!dst) return plasma_oom();
+    mark = arena_mark(A);
+
+    tm_begin(&TIMINGS, "generate");
+    if (GENERATOR == GEN_FBM) {
+        /* Evaluation directe aux coordonnees du reechantillonnage */
+        FbmCtx fbm;
+        double *scratch = (double*)arena_alloc(A, (size_t)fft_max_threads() * (size_t)width * sizeof(double));
+        if (!scratch) return plasma_oom();
+        fbm_init(&fbm, n, amp, DECAY);
+        PX_FN(fbm_generate)(&fbm, n, dst, width, height, bias, scratch);
+        tm_end(&TIMINGS, (double)cells, (double)cells * sizeof(PX_T));
+    } else {
+        size_t N2 = (size_t)n * (size_t)n, grid;
+        /* DS sequentiel ; la FFT remplit ses lignes par bandes */
+        src = (GENERATOR == GEN_FFT && sizeof(PX_T) == sizeof(double))
+            ? (PX_T*)arena_alloc_rows(A, (size_t)n, (size_t)n * sizeof(PX_T))
+            : (PX_T*)arena_alloc(A, N2 * sizeof(PX_T));
+        if (!src) return plasma_oom();
+        grid = arena_mark(A);
+
+        if (GENERATOR == GEN_FFT) {
+            double beta = BETA;
+            double *spec = (double*)src, *work;
+            size_t i2;
+            if (!BETA_SET) beta = 2.0 - 2.0 * log((DECAY > 1e-6) ? DECAY : 1e-6) / log(2.0);
+            /* la FFT calcule en double ; sortie convertie vers la precision de stockage */
+            if (sizeof(PX_T) != sizeof(double)) spec = (double*)arena_alloc_rows(A, (size_t)n, (size_t)n * sizeof(double));
+            work = (double*)arena_alloc(A, spectral_fbm_work(n) * sizeof(double));
+            if (!spec || !work || spectral_fbm(spec, n, beta, AMP, frand01, work) != 0) {
+                return plasma_oom();
+            }
+            if (spec != (double*)src) {
+#if PX_UNIT
+                double mn = spec[0], mx = spec[0];
+                for (i2 = 1; i2 < N2; ++i2) {
+                    if (spec[i2] < mn) mn = spec[i2];
+                    if (spec[i2] > mx) mx = spec[i2];
+                }
+                if (mx - mn <= 1e-300) mx = mn + 1.0;
+                for (i2 = 0; i2 < N2; ++i2) src[i2] = PX_STORE((PX_C)((spec[i2] - mn) / (mx - mn)));
+#else
+                for (i2 = 0; i2 < N2; ++i2) src[i2] = PX_STORE((PX_C)spec[i2]);
+#endif
+            }
+        } else {
+            FcDs ds;
+            plasma_ds_params(&ds, amp, bias);
+            if (PREVIEW.path) {
+                pv_begin(n, width, height);
+                ds.level = PX_FN(plasma_preview);
+                ds.level_ctx = A;
+            }
+            if (DS_STRIDED) {
+                PX_FN(fc_ds_strided)(src, n, &ds);
+            } else {
+                PX_T *aux = (PX_T*)arena_alloc(A, fc_ds_aux_cells(n) * sizeof(PX_T));
+                if (!aux) return plasma_oom();
+                PX_FN(fc_ds)(src, n, &ds, aux);
+            }
+        }
+        arena_release(A, grid);
+        tm_end(&TIMINGS, (double)N2, (double)N2 * sizeof(PX_T));
+
+        arena_stage(A, "reechantillonnage");
+        tm_begin(&TIMINGS, "resample");
+        PX_FN(fc_resample)(src, n, WRAP ? (GENERATOR == GEN_FFT ? n : n - 1) : 0,
+                           dst, width, height);
+        tm_end(&TIMINGS, (double)cells, (double)(cells + N2) * sizeof(PX_T));
+    }
+    arena_release(A, mark);
+
+    if (FILT_RADIUS > 0 && FILT_PASSES > 0) {
+        PX_T *tmp;
+        arena_stage(A, "flou");
+        tmp = (PX_T*)arena_alloc_rows(A, (size_t)height, (size_t)width * sizeof(PX_T));
+        if (!tmp) return plasma_oom();
+        tm_begin(&TIMINGS, "blur");
+        PX_FN(fc_blur)(dst, width, height, FILT_RADIUS, FILT_PASSES, WRAP, tmp);
+        tm_end(&TIMINGS, (double)cells * FILT_PASSES, 2.0 * (double)cells * sizeof(PX_T) * FILT_PASSES);
+        arena_release(A, mark);
+    }
+
+    arena_stage(A, "normalisation");
+    tm_begin(&TIMINGS, "normalise");
+    PX_FN(fc_normalize01)(dst, cells);
+    tm_end(&TIMINGS, (double)cells, 2.0 * (double)cells * sizeof(PX_T));
+    if (GAMMA_CORR > 0.0 && fabs(GAMMA_CORR - 1.0) >= 1e-12) {
+        tm_begin(&TIMINGS, "gamma");
+        PX_FN(apply_gamma)(dst, cells, GAMMA_CORR);
+        tm_end(&TIMINGS, (double)cells, (double)cells * sizeof(PX_T));
+    }
+
+    if (CHECKSUM_Q > 0.0) {
+        Crc ck;
+        size_t i2;
+        ck_init(&ck);
+        for (i2 = 0; i2 < cells; ++i2) ck_quant(&ck, (double)PX_LOAD(dst[i2]), CHECKSUM_Q);
+        ck_report("plasma", "grille", &ck, CHECKSUM_Q);
+    }
+
+    arena_stage(A, "sortie");
+    tm_begin(&TIMINGS, "write");
+    if (ANIMATE >= 0) {
+        if (PX_FN(animate)(dst, width, height) != 0) return 1;
+    } else if (TERM_MODE != TT_NONE) {
+        if (tt_blocks(width, height, PX_FN(term_row), dst, TERM_MODE) != 0) return plasma_oom();
+    } else if (!ONLY_VALUES) {
+        PX_FN(print_ascii)(dst, width, height, PALETTE, stdout);
+    }
+    if (PRINT_VALUES || ONLY_VALUES) {
+        if (!ONLY_VALUES) putchar('\n');
+        PX_FN(print_values)(dst, width, height, stdout);
+    }
+    fflush(stdout);
+    tm_end(&TIMINGS, (double)cells, (double)cells * sizeof(PX_T));
+    return 0;
+}
+
+/* ----- Microbenchmarks (--bench) : noyaux seuls, sur des grilles S x S ----- */
+
+typedef struct {
+    PX_T *src, *aux, *dst, *tmp;
+    int n, S;
+    FcDs ds;
+    FILE *sink;
+} PX_FN(PlasmaBench);
+
+static void PX_FN(bench_ds)(void *ctx) {
+    PX_FN(PlasmaBench) *b = (PX_FN(PlasmaBench)*)ctx;
+    srand((unsigned)SEED);
+    PX_FN(fc_ds)(b->src, b->n, &b->ds, b->aux);
+}
+
+static void PX_FN(bench_resample)(void *ctx) {
+    PX_FN(PlasmaBench) *b = (PX_FN(PlasmaBench)*)ctx;
+    PX_FN(fc_resample)(b->src, b->n, 0, b->dst, b->S, b->S);
+}
+
+static void PX_FN(bench_blur)(void *ctx) {
+    PX_FN(PlasmaBench) *b = (PX_FN(PlasmaBench)*)ctx;
+    PX_FN(fc_blur)(b->dst, b->S, b->S, FILT_RADIUS, FILT_PASSES, WRAP, b->tmp);
+}
+
+static void PX_FN(bench_normalize)(void *ctx) {
+    PX_FN(PlasmaBench) *b = (PX_FN(PlasmaBench)*)ctx;
+    PX_FN(fc_normalize01)(b->dst, (size_t)b->S * (size_t)b->S);
+}
+
+static void PX_FN(bench_gamma)(void *ctx) {
+    PX_FN(PlasmaBench) *b = (PX_FN(PlasmaBench)*)ctx;
+    PX_FN(apply_gamma)(b->dst, (size_t)b->S * (size_t)b->S, GAMMA_CORR);
+}
+
+static void PX_FN(bench_ascii)(void *ctx) {
+    PX_FN(PlasmaBench) *b = (PX_FN(PlasmaBench)*)ctx;
+    PX_FN(print_ascii)(b->dst, b->S, b->S, PALETTE, b->sink);
+    fflush(b->sink);
+}
+
+static void PX_FN(bench_values)(void *ctx) {
+    PX_FN(PlasmaBench) *b = (PX_FN(PlasmaBench)*)ctx;
+    PX_FN(print_values)(b->dst, b->S, b->S, b->sink);
+    fflush(b->sink);
+}
+
+/* Mesure les noyaux pour chaque cote de BENCH.sizes. Le flou utilise -f
+   (defaut rayon 2, une passe), gamma -g (defaut 2.2). */
+static int PX_FN(plasma_bench)(const char *precision) {
+    int k;
+    bench_begin("plasma", precision);
+    for (k = 0; k < BENCH.nsizes; ++k) {
+        PX_FN(PlasmaBench) b;
+        int S = BENCH.sizes[k];
+        size_t cells = (size_t)S * (size_t)S, N2, need = 0;
+        double amp = AMP, bias = 0.0;
+        double c = (double)cells, sz = (double)sizeof(PX_T);
+
+        b.S = S;
+        b.n = pow2plus1_at_least(S);
+        N2 = (size_t)b.n * (size_t)b.n;
+        mem_add_mul(&need, N2, sizeof(PX_T));
+        mem_add_mul(&need, fc_ds_aux_cells(b.n), sizeof(PX_T));
+        mem_add_mul(&need, 2 * cells, sizeof(PX_T));
+        mem_add_mul(&need, 4 * ARENA_ALIGN, 1);
+        if (mem_check(need, MAX_MEM) != 0 || arena_init(&ARENA, need) != 0) {
+            bench_skip(S, "memoire");
+            continue;
+        }
+        ARENA.first_touch = NUMA_BANDS && fft_max_threads() > 1;
+        b.src = (PX_T*)arena_alloc(&ARENA, N2 * sizeof(PX_T));
+        b.aux = (PX_T*)arena_alloc(&ARENA, fc_ds_aux_cells(b.n) * sizeof(PX_T));
+        b.dst = (PX_T*)arena_alloc_rows(&ARENA, (size_t)S, (size_t)S * sizeof(PX_T));
+        b.tmp = (PX_T*)arena_alloc_rows(&ARENA, (size_t)S, (size_t)S * sizeof(PX_T));
+        b.sink = fopen(BENCH_NULL, "w");
+#if PX_UNIT
+        {
+            double B = PX_FN(gen_bound)(b.n);
+            if (B > 0.0) amp = AMP / (2.0 * B);
+            bias = 0.5;
+        }
+#endif
+        plasma_ds_params(&b.ds, amp, bias);
+        if (!b.src || !b.aux || !b.dst || !b.tmp || !b.sink) {
+            if (b.sink) fclose(b.sink);
+            arena_free(&ARENA);
+            bench_skip(S, "memoire");
+            continue;
+        }
+
+        bench_run("diamond_square", S, (double)N2, (double)N2 * sz, PX_FN(bench_ds), &b);
+        PX_FN(bench_ds)(&b);
+        bench_run("resample_bilinear", S, c, (c + (double)N2) * sz, PX_FN(bench_resample), &b);
+        PX_FN(bench_resample)(&b);
+        bench_run("box_blur", S, c * FILT_PASSES, 2.0 * c * sz * FILT_PASSES, PX_FN(bench_blur), &b);
+        bench_run("normalize01", S, c, 2.0 * c * sz, PX_FN(bench_normalize), &b);
+        PX_FN(bench_normalize)(&b);
+        bench_run("apply_gamma", S, c, 2.0 * c * sz, PX_FN(bench_gamma), &b);
+        bench_run("print_values", S, c, c * sz, PX_FN(bench_values), &b);
+        bench_run("print_ascii", S, c, c * sz, PX_FN(bench_ascii), &b);
+
+        fclose(b.sink);
+        arena_free(&ARENA);
+    }
+    return bench_end();
+}
+
+/* ----- Reglage (--tune) : boucles de lignes, reechantillonnage et flou ----- */
+
+static void PX_FN(tune_rows)(void *ctx) {
+    PX_FN(PlasmaBench) *b = (PX_FN(PlasmaBench)*)ctx;
+    PX_FN(fc_resample)(b->src, b->n, 0, b->dst, b->S, b->S);
+    PX_FN(fc_blur)(b->dst, b->S, b->S, 2, 1, 0, b->tmp);
+}
+
+/* Grille ds TN_SIDE^2, puis threads et hauteur de bande les plus rapides
+   pour reechantillonnage + flou, ranges dans le profil (tune.h) */
+static int PX_FN(plasma_tune)(void) {
+    static const int bands[] = { 0, 8, 32, 128 };
+    PX_FN(PlasmaBench) b;
+    size_t need = 0, N2;
+    double amp = AMP, bias = 0.0;
+    int t, band = 0;
+
+    b.S = TN_SIDE;
+    b.n = pow2plus1_at_least(TN_SIDE);
+    N2 = (size_t)b.n * (size_t)b.n;
+    mem_add_mul(&need, N2, sizeof(PX_T));
+    mem_add_mul(&need, fc_ds_aux_cells(b.n), sizeof(PX_T));
+    mem_add_mul(&need, 2 * (size_t)b.S * (size_t)b.S, sizeof(PX_T));
+    mem_add_mul(&need, 4 * ARENA_ALIGN, 1);
+    if (mem_check(need, MAX_MEM) != 0) return 1;
+    if (arena_init(&ARENA, need) != 0) return plasma_oom();
+    b.src = (PX_T*)arena_alloc(&ARENA, N2 * sizeof(PX_T));
+    b.aux = (PX_T*)arena_alloc(&ARENA, fc_ds_aux_cells(b.n) * sizeof(PX_T));
+    b.dst = (PX_T*)arena_alloc(&ARENA, (size_t)b.S * (size_t)b.S * sizeof(PX_T));
+    b.tmp = (PX_T*)arena_alloc(&ARENA, (size_t)b.S * (size_t)b.S * sizeof(PX_T));
+    if (!b.src || !b.aux || !b.dst || !b.tmp) {
+        arena_free(&ARENA);
+        return plasma_oom();
+    }
+#if PX_UNIT
+    {
+        double B = PX_FN(gen_bound)(b.n);
+        if (B > 0.0) amp = AMP / (2.0 * B);
+        bias = 0.5;
+    }
+#endif
+    plasma_ds_params(&b.ds, amp, bias);
+    PX_FN(bench_ds)(&b);
+
+    TUNE.band = 0;
+    t = tn_tune_threads("plasma", PX_FN(tune_rows), &b);
+    if (t > 1) band = tn_tune_int("plasma", "band", &TUNE.band, bands, 4, PX_FN(tune_rows), &b);
+    arena_free(&ARENA);
+    fprintf(stderr, "plasma : threads.rows %d, band %d\n", t, band);
+    if (tn_store("threads.rows", t) != 0 || tn_store("band", band) != 0) return 1;
+    return 0;
+}
+
+#undef PX_T
+#undef PX_C
+#undef PX_LOAD
+#undef PX_STORE
+#undef PX_UNIT
+#undef PX_FN
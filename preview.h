@@ -0,0 +1,133 @@
+/*
+ * preview.h — apercus progressifs du diamond-square (--progressive PATH)
+ * C ANSI C89, en-tete seul (fonctions static), utilise par plasma.c et
+ * geo.c.
+ *
+ * fc_ds (fcore.h) construit la grille niveau par niveau ; chaque niveau
+ * est deja une carte complete, grossiere, de cote 2^l + 1. Le crochet
+ * FcDs.level de chaque outil la reechantillonne a l'echelle de la carte
+ * finale (cote au plus PV_MAX) et l'ecrit en PPM P6 avec pv_write, avant
+ * de laisser le diamond-square continuer. Une carte 16k^2 a ainsi un
+ * premier apercu en quelques millisecondes.
+ *
+ * PATH contenant %d (ou %0Nd, N < 10) : un fichier par niveau, numerote
+ * par le niveau l. Sinon le meme fichier est remplace a chaque niveau :
+ * ecriture dans PATH.tmp puis renommage, un lecteur (ppm_viewer.html, mode
+ * suivi) ne voit jamais d'image partielle. Une ligne de commentaire de l'en-tete
+ * donne le niveau, la taille de la carte finale et le temps ecoule :
+ *   # fractale apercu 6/14 carte 16384x16384 3.2 ms
+ */
+
+#ifndef PREVIEW_H
+#define PREVIEW_H
+
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+#define PV_MIN 8                   /* premier niveau montre : cote >= PV_MIN + 1 */
+#define PV_MAX 1024                /* cote max. d'un apercu */
+#define PV_PATH 1024
+
+#if defined(__GNUC__)
+#define PV_FN static __attribute__((unused))
+#else
+#define PV_FN static
+#endif
+
+typedef struct {
+    const char *path;          /* 0 : sans apercu */
+    int W, H;                  /* carte finale */
+    int n;                     /* cote de la grille DS */
+    int levels;                /* niveaux de la grille DS */
+    int count;                 /* apercus ecrits */
+    int failed;                /* un seul message d'ecriture impossible */
+    double t0;                 /* debut de la generation */
+} Preview;
+
+static Preview PREVIEW;
+
+/* Cellules du plus grand apercu pour une carte W x H (memoire) */
+PV_FN size_t pv_cells(int W, int H) {
+    size_t w = (size_t)((W < PV_MAX) ? W : PV_MAX);
+    size_t h = (size_t)((H < PV_MAX) ? H : PV_MAX);
+    return w * h;
+}
+
+/* Debut d'une generation sur une grille DS n x n, carte W x H */
+PV_FN void pv_begin(int n, int W, int H) {
+    int t;
+    PREVIEW.n = n;
+    PREVIEW.W = W;
+    PREVIEW.H = H;
+    PREVIEW.levels = 0;
+    for (t = n - 1; t > 1; t >>= 1) PREVIEW.levels++;
+    PREVIEW.count = 0;
+    PREVIEW.t0 = tr_wall();
+}
+
+/* Taille pw x ph de l'apercu du niveau de cote side, a la meme echelle
+   que la carte finale. Retourne 0 si ce niveau n'est pas montre : trop
+   grossier, trop grand, ou dernier niveau (la carte elle-meme). */
+PV_FN int pv_dims(int side, int *pw, int *ph) {
+    double f;
+    if (side - 1 < PV_MIN || side >= PREVIEW.n) return 0;
+    f = (double)(side - 1) / (double)(PREVIEW.n - 1);
+    *pw = (int)((double)PREVIEW.W * f + 0.999999);
+    *ph = (int)((double)PREVIEW.H * f + 0.999999);
+    if (*pw < 1) *pw = 1;
+    if (*ph < 1) *ph = 1;
+    return *pw <= PV_MAX && *ph <= PV_MAX;
+}
+
+/* Nom du fichier du niveau l : %d ou %0Nd (N de 1 a 9) remplace par l */
+PV_FN void pv_name(char *name, int l) {
+    const char *path = PREVIEW.path;
+    const char *pc = strchr(path, '%');
+    if (pc) {
+        const char *q = pc + 1;
+        int width = 0;
+        if (q[0] == '0' && q[1] >= '1' && q[1] <= '9') { width = q[1] - '0'; q += 2; }
+        if (*q == 'd' && !strchr(q, '%')) {
+            sprintf(name, "%.*s%0*d%s", (int)(pc - path), path, width, l, q + 1);
+            return;
+        }
+    }
+    strcpy(name, path);
+}
+
+/* Ecrit l'apercu rgb (pw x ph, 3 octets par pixel) du niveau de cote side.
+   Retourne 0, ou -1 (message sur stderr la premiere fois). */
+PV_FN int pv_write(const unsigned char *rgb, int pw, int ph, int side) {
+    char name[PV_PATH + 32], tmp[PV_PATH + 40];
+    int l = 0, t, ok;
+    FILE *f;
+    for (t = side - 1; t > 1; t >>= 1) l++;
+    if (strlen(PREVIEW.path) >= PV_PATH) ok = 0;
+    else {
+        pv_name(name, l);
+        sprintf(tmp, "%s.tmp", name);
+        f = fopen(tmp, "wb");
+        ok = f && fprintf(f, "P6\n# fractale apercu %d/%d carte %dx%d %.1f ms\n%d %d\n255\n",
+                          l, PREVIEW.levels, PREVIEW.W, PREVIEW.H,
+                          1e3 * (tr_wall() - PREVIEW.t0), pw, ph) > 0
+                && fwrite(rgb, 3, (size_t)pw * (size_t)ph, f) == (size_t)pw * (size_t)ph;
+        if (f && fclose(f) != 0) ok = 0;
+        if (ok) {
+#if !(defined(__unix__) || defined(__APPLE__))
+            remove(name);
+#endif
+            ok = (rename(tmp, name) == 0);
+        }
+        if (!ok && f) remove(tmp);
+    }
+    if (!ok) {
+        if (!PREVIEW.failed) fprintf(stderr, "apercu : ecriture impossible (%s).\n", PREVIEW.path);
+        PREVIEW.failed = 1;
+        return -1;
+    }
+    PREVIEW.count++;
+    return 0;
+}
+
+#endif /* PREVIEW_H */
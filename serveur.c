@@ -0,0 +1,803 @@
+/*
+ * serveur.c — serveur local de tuiles : heightmaps, cartes geo, rendus iso
+ * C ANSI C89 + POSIX (sockets, pthreads).
+ *
+ * Un editeur de niveaux demande beaucoup de petites regions : lancer geo ou
+ * iso a chaque fois coute le demarrage du processus et la generation de
+ * toute la carte. serveur reste en memoire et sert les tuiles en HTTP/1.0
+ * sur 127.0.0.1 (--port) ou sur une socket UNIX (--unix), uniquement en
+ * local :
+ *   GET /height?...   tuile de hauteurs : PGM 16 bits (fmt=pgm, defaut) ou
+ *                     texte 0..1 (fmt=txt, le format lu par iso -i)
+ *   GET /geo?...      tuile couleur, palette et rivages de geo (PPM)
+ *   GET /iso?...      rendu isometrique de la tuile, comme iso (PPM)
+ *   GET /stats        compteurs du cache (JSON)
+ * Parametres (tous facultatifs) :
+ *   seed=N a=R k=R f=N   graine, amplitude, rugosite, passes de lissage
+ *   n=N                  monde periodique de 2^n x 2^n cellules (4..12, 10)
+ *   x=N y=N size=N       tuile (x, y) de size x size cellules (defaut 0 0 256)
+ *   sea=R                niveau d'eau (geo : cellules <= R en eau ;
+ *                        iso : eau aplatie au niveau R)
+ *   tw=N th=N zs=N       tuiles isometriques et echelle verticale (iso)
+ * Une image iso de plus de 128 Mio, ou plus grosse que le cache, est
+ * refusee (400), comme les valeurs non finies (nan, inf).
+ *
+ * Le monde est un diamond-square periodique (fcore.h, memes tirages que
+ * geo --wrap), lisse si f > 0 ; les tuiles en sont des extraits, repliees
+ * au bord : les tuiles voisines se raccordent, a toutes les positions.
+ *
+ * Cache : mondes et reponses completes dans une liste LRU en memoire,
+ * bornee en octets (--cache-mb) ; la cle est la liste canonique des
+ * parametres, dans un ordre fixe. Une entree en cours d'envoi n'est
+ * liberee qu'apres son dernier lecteur.
+ *
+ * Ordonnancement : le thread principal accepte les connexions et les place
+ * dans une file bornee ; -j threads de travail les servent. File pleine :
+ * reponse 503 immediate. Une connexion muette ou qui ne lit pas sa reponse
+ * rend son thread apres CONN_TIMEOUT s (408 si la requete n'est pas
+ * arrivee), pour qu'aucun client ne bloque le pool. Les generations de monde sont faites une a une
+ * (le diamond-square tire dans un generateur global), en parallele par
+ * OpenMP si compile avec -fopenmp ; les extraits, couleurs et rendus iso
+ * se font en parallele dans les threads de travail. Le profil de la
+ * machine (tune.h, fractale-tune.sh) fixe les threads OpenMP et la hauteur
+ * des bandes de lignes de chaque generation.
+ *
+ * Compilation :
+ *   cc -std=c89 -Wall -Wextra -O2 -pthread serveur.c -o serveur -lm
+ *   cc -std=c89 -Wall -Wextra -O2 -pthread -fopenmp serveur.c -o serveur -lm
+ *
+ * Exemples :
+ *   ./serveur --port 8088 -j 4 &
+ *   curl -o t.ppm 'http://127.0.0.1:8088/geo?seed=42&x=1&y=0&sea=0.45'
+ *   curl -o i.ppm 'http://127.0.0.1:8088/iso?seed=42&size=64&sea=0.45'
+ *   curl 'http://127.0.0.1:8088/stats'
+ *   ./serveur --unix /tmp/fractale.sock &
+ *   curl --unix-socket /tmp/fractale.sock -o h.pgm 'http://x/height?seed=7'
+ */
+
+/* sockets, pthreads, sigaction */
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "isa.h"
+#include "isorender.h"
+#include "geocolor.h"
+#include "tune.h"
+
+/* ----- Options et etat ----- */
+static int PORT = 8088;                /* --port, sur 127.0.0.1 */
+static const char *UNIX_PATH = 0;      /* --unix PATH, remplace --port */
+static int THREADS = 4;                /* -j */
+static size_t CACHE_BYTES = (size_t)256 << 20; /* --cache-mb */
+static long MAX_REQUESTS = 0;          /* --max-requests, 0 : sans limite */
+static int VERBOSE = 0;                /* -v : une ligne par requete */
+static const char *FORCE_ISA = 0;      /* --force-isa, 0 : detection */
+
+#define MAX_N      12                  /* monde de 4096 x 4096 au plus */
+#define MAX_TILE   2048
+#define MAX_ISO    512                 /* cote max. d'une tuile iso */
+#define MAX_ISO_BYTES ((size_t)128 << 20) /* image iso max. (et au plus le cache) */
+#define QUEUE_CAP  64                  /* connexions en attente */
+#define REQ_MAX    4096                /* octets lus de la requete */
+#define CONN_TIMEOUT 5                 /* s : lecture ou envoi bloque (SO_RCVTIMEO) */
+
+static volatile sig_atomic_t STOP = 0;
+
+/* ----- Noyaux de generation (fcore.h), stockage float ----- */
+
+#define PX_T float
+#define PX_C float
+#define PX_LOAD(v) (v)
+#define PX_STORE(x) ((float)(x))
+#define PX_FN(name) name##_f32
+#include "fcore.h"
+#undef PX_T
+#undef PX_C
+#undef PX_LOAD
+#undef PX_STORE
+#undef PX_FN
+
+/* RNG de geo (LCG), global : les generations sont serialisees par GEN_LOCK */
+static unsigned long rng_state = 1;
+static void rng_srand(unsigned long s) { if (s == 0) s = 1; rng_state = s; }
+static unsigned long rng_nextu(void) { rng_state = rng_state * 1664525UL + 1013904223UL; return rng_state; }
+/* [0,1) */
+static double rng_rand01(void) {
+    unsigned long u = rng_nextu();
+    return (double)(u & 0xFFFFFF) / (double)0x1000000; /* 24 bits */
+}
+
+/* ----- Cache LRU ----- */
+
+#define LRU_KEY     256
+#define LRU_BUCKETS 1024
+
+typedef struct Entry {
+    struct Entry *prev, *next;         /* liste LRU, tete = plus recent */
+    struct Entry *hnext;               /* chaine de la table */
+    unsigned long hash;
+    int refs;                          /* lecteurs en cours */
+    int dead;                          /* hors du cache, libere au dernier lecteur */
+    const char *type;                  /* Content-Type, 0 pour un monde */
+    size_t len;
+    unsigned char *data;               /* len octets, a la suite de l'entree */
+    char key[LRU_KEY];
+} Entry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    Entry *head, *tail;
+    Entry *table[LRU_BUCKETS];
+    size_t bytes, cap;
+    long entries, evictions;
+    long requests, hits, misses, worlds;   /* connexions, tuiles, mondes generes */
+} Lru;
+
+static Lru CACHE;
+static pthread_mutex_t GEN_LOCK = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned long lru_hash(const char *s) {
+    unsigned long h = 2166136261UL;
+    for (; *s; ++s) h = ((h ^ (unsigned char)*s) * 16777619UL) & 0xFFFFFFFFUL;
+    return h;
+}
+
+/* Entree de len octets, hors cache (refs = 1) ; 0 si memoire insuffisante */
+static Entry *lru_new(const char *key, const char *type, size_t len) {
+    Entry *e = (Entry*)malloc(sizeof(Entry) + len);
+    if (!e) return 0;
+    memset(e, 0, sizeof(Entry));
+    strncpy(e->key, key, LRU_KEY - 1);
+    e->hash = lru_hash(e->key);
+    e->type = type;
+    e->len = len;
+    e->data = (unsigned char*)(e + 1);
+    e->refs = 1;
+    e->dead = 1;
+    return e;
+}
+
+static void lru_unlink(Lru *c, Entry *e) {
+    if (e->prev) e->prev->next = e->next; else c->head = e->next;
+    if (e->next) e->next->prev = e->prev; else c->tail = e->prev;
+    e->prev = e->next = 0;
+}
+
+static void lru_push_front(Lru *c, Entry *e) {
+    e->prev = 0;
+    e->next = c->head;
+    if (c->head) c->head->prev = e; else c->tail = e;
+    c->head = e;
+}
+
+/* Retire e du cache ; liberee tout de suite si personne ne la lit */
+static void lru_drop(Lru *c, Entry *e) {
+    Entry **p = &c->table[e->hash % LRU_BUCKETS];
+    while (*p != e) p = &(*p)->hnext;
+    *p = e->hnext;
+    lru_unlink(c, e);
+    c->bytes -= e->len;
+    c->entries--;
+    e->dead = 1;
+    if (e->refs == 0) free(e);
+}
+
+/* Entree de cle key, refs + 1, ou 0 (verrou pris par l'appelant) */
+static Entry *lru_find(Lru *c, const char *key) {
+    unsigned long h = lru_hash(key);
+    Entry *e;
+    for (e = c->table[h % LRU_BUCKETS]; e; e = e->hnext) {
+        if (e->hash == h && strcmp(e->key, key) == 0) {
+            lru_unlink(c, e);
+            lru_push_front(c, e);
+            e->refs++;
+            return e;
+        }
+    }
+    return 0;
+}
+
+static Entry *lru_get(Lru *c, const char *key) {
+    Entry *e;
+    pthread_mutex_lock(&c->lock);
+    e = lru_find(c, key);
+    pthread_mutex_unlock(&c->lock);
+    return e;
+}
+
+/* Compteur du cache (requests, hits...) + 1 */
+static void lru_count(Lru *c, long *counter) {
+    pthread_mutex_lock(&c->lock);
+    (*counter)++;
+    pthread_mutex_unlock(&c->lock);
+}
+
+/* Range e (retournee par lru_new, refs = 1) et retourne l'entree a lire :
+   e, ou celle qu'un autre thread a rangee entre-temps sous la meme cle.
+   Les entrees les moins recentes et non lues sortent jusqu'a repasser sous
+   cap ; une entree plus grosse que cap n'entre pas. */
+static Entry *lru_put(Lru *c, Entry *e) {
+    Entry *old, *v;
+    pthread_mutex_lock(&c->lock);
+    old = lru_find(c, e->key);
+    if (old) {
+        pthread_mutex_unlock(&c->lock);
+        free(e);
+        return old;
+    }
+    if (e->len <= c->cap) {
+        e->dead = 0;
+        e->hnext = c->table[e->hash % LRU_BUCKETS];
+        c->table[e->hash % LRU_BUCKETS] = e;
+        lru_push_front(c, e);
+        c->bytes += e->len;
+        c->entries++;
+        for (v = c->tail; v && c->bytes > c->cap; ) {
+            Entry *prev = v->prev;
+            if (v != e && v->refs == 0) { lru_drop(c, v); c->evictions++; }
+            v = prev;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return e;
+}
+
+static void lru_release(Lru *c, Entry *e) {
+    int gone;
+    pthread_mutex_lock(&c->lock);
+    gone = (--e->refs == 0 && e->dead);
+    pthread_mutex_unlock(&c->lock);
+    if (gone) free(e);
+}
+
+/* ----- Requetes ----- */
+
+typedef struct {
+    int kind;                          /* REQ_HEIGHT, REQ_GEO, REQ_ISO, REQ_STATS */
+    unsigned long seed;
+    double amp, rough, sea;
+    int sea_set;
+    int n, smooth;
+    long tx, ty;
+    int size, txt;
+    int tw, th, zs;
+} Req;
+
+#define REQ_HEIGHT 0
+#define REQ_GEO    1
+#define REQ_ISO    2
+#define REQ_STATS  3
+
+/* Parametre name=value de la requete. Retourne 0, ou -1 si inconnu ou
+   invalide. Les valeurs non finies (nan, inf) sont refusees : elles
+   passeraient les tests d'intervalle, puis (long)d ou la quantification
+   16 bits du PGM seraient indefinis. */
+static int req_param(Req *r, const char *name, const char *val) {
+    char *e = 0;
+    double d = strtod(val, &e);
+    long l;
+    if (e == val || *e != '\0') {
+        if (strcmp(name, "fmt") == 0 && strcmp(val, "txt") == 0) { r->txt = 1; return 0; }
+        if (strcmp(name, "fmt") == 0 && strcmp(val, "pgm") == 0) { r->txt = 0; return 0; }
+        return -1;
+    }
+    if (d != d || d - d != 0.0) return -1;
+    l = (d > -2e9 && d < 2e9) ? (long)d : -1;
+    if (strcmp(name, "seed") == 0) { if (d < 0.0 || d > 4294967295.0) return -1; r->seed = (unsigned long)d; }
+    else if (strcmp(name, "a") == 0) r->amp = d;
+    else if (strcmp(name, "k") == 0) { if (d <= 0.0) return -1; r->rough = d; }
+    else if (strcmp(name, "f") == 0) { if (l < 0 || l > 64) return -1; r->smooth = (int)l; }
+    else if (strcmp(name, "n") == 0) { if (l < 4 || l > MAX_N) return -1; r->n = (int)l; }
+    else if (strcmp(name, "x") == 0) { if (d < -1e9 || d > 1e9) return -1; r->tx = l; }
+    else if (strcmp(name, "y") == 0) { if (d < -1e9 || d > 1e9) return -1; r->ty = l; }
+    else if (strcmp(name, "size") == 0) { if (l < 2 || l > MAX_TILE) return -1; r->size = (int)l; }
+    else if (strcmp(name, "sea") == 0) { if (d < 0.0 || d > 1.0) return -1; r->sea = d; r->sea_set = 1; }
+    else if (strcmp(name, "tw") == 0) { if (l < 2 || l > 256) return -1; r->tw = (int)l; }
+    else if (strcmp(name, "th") == 0) { if (l < 2 || l > 256) return -1; r->th = (int)l; }
+    else if (strcmp(name, "zs") == 0) { if (l < 0 || l > 4096) return -1; r->zs = (int)l; }
+    else return -1;
+    return 0;
+}
+
+/* Chemin et parametres de "GET /chemin?a=1&b=2 HTTP/1.x" (modifie line).
+   Retourne 0, 404 (chemin inconnu) ou 400 (requete invalide). */
+static int req_parse(char *line, Req *r) {
+    char *path, *q, *end;
+    memset(r, 0, sizeof(*r));
+    r->seed = 1; r->amp = 1.0; r->rough = 0.65; r->n = 10;
+    r->size = 256; r->tw = 16; r->th = 8; r->zs = 64;
+    path = line + 4;
+    end = strchr(path, ' ');
+    if (!end) return 400;
+    *end = '\0';
+    q = strchr(path, '?');
+    if (q) *q++ = '\0';
+    if (strcmp(path, "/height") == 0) r->kind = REQ_HEIGHT;
+    else if (strcmp(path, "/geo") == 0) r->kind = REQ_GEO;
+    else if (strcmp(path, "/iso") == 0) r->kind = REQ_ISO;
+    else if (strcmp(path, "/stats") == 0) r->kind = REQ_STATS;
+    else return 404;
+    while (q && *q) {
+        char *amp = strchr(q, '&'), *eq;
+        if (amp) *amp = '\0';
+        eq = strchr(q, '=');
+        if (!eq) return 400;
+        *eq = '\0';
+        if (req_param(r, q, eq + 1) != 0) return 400;
+        q = amp ? amp + 1 : 0;
+    }
+    if (r->kind == REQ_ISO) {
+        /* l'image depend aussi de tw, th et zs : bornee avant lru_new */
+        int fbw, fbh;
+        double bytes;
+        if (r->size > MAX_ISO) return 400;
+        if (ir_size(r->size, r->size, r->tw, r->th, r->zs, &fbw, &fbh) != 0) return 400;
+        bytes = (double)fbw * (double)fbh * 3.0;
+        if (bytes > (double)MAX_ISO_BYTES || bytes > (double)CACHE.cap) return 400;
+    }
+    return 0;
+}
+
+/* Cles canoniques : tous les parametres utiles, ordre fixe */
+static void world_key(const Req *r, char *key) {
+    sprintf(key, "world n=%d seed=%lu a=%.17g k=%.17g f=%d", r->n, r->seed, r->amp, r->rough, r->smooth);
+}
+
+static void tile_key(const Req *r, char *key) {
+    static const char *const kinds[3] = { "height", "geo", "iso" };
+    char *k = key;
+    k += sprintf(k, "%s n=%d seed=%lu a=%.17g k=%.17g f=%d x=%ld y=%ld size=%d", kinds[r->kind],
+                 r->n, r->seed, r->amp, r->rough, r->smooth, r->tx, r->ty, r->size);
+    if (r->kind == REQ_HEIGHT) sprintf(k, " fmt=%s", r->txt ? "txt" : "pgm");
+    else if (r->sea_set) k += sprintf(k, " sea=%.17g", r->sea);
+    if (r->kind == REQ_ISO) sprintf(k, " tw=%d th=%d zs=%d", r->tw, r->th, r->zs);
+}
+
+/* ----- Generation ----- */
+
+/* Monde periodique de cote 2^n : diamond-square torique (parametres de
+   geo --wrap), puis f passes de flou replie. Grille float m x m. */
+static Entry *world_build(const Req *r, const char *key) {
+    int m = 1 << r->n, P = m + 1, y;
+    size_t cells = (size_t)m * (size_t)m;
+    Entry *w = lru_new(key, 0, cells * sizeof(float));
+    float *ds = (float*)malloc(((size_t)P * (size_t)P + fc_ds_aux_cells(P)) * sizeof(float));
+    float *grid;
+    FcDs p;
+    if (!w || !ds) { free(w); free(ds); return 0; }
+    grid = (float*)w->data;
+    p.amp = r->amp;
+    p.decay = r->rough;
+    p.bias = 0.5;
+    p.wrap = 1;
+    p.clamp01 = 1;
+    p.rand01 = rng_rand01;
+    p.level = 0;
+    p.level_ctx = 0;
+    rng_srand(r->seed);
+    fc_ds_f32(ds, P, &p, ds + (size_t)P * (size_t)P);
+    for (y = 0; y < m; ++y) memcpy(grid + (size_t)y * (size_t)m, ds + (size_t)y * (size_t)P, (size_t)m * sizeof(float));
+    if (r->smooth > 0) fc_blur_f32(grid, m, m, 1, r->smooth, 1, ds);
+    free(ds);
+    return w;
+}
+
+/* Monde de la requete, depuis le cache ou genere (une generation a la fois) */
+static Entry *world_get(const Req *r) {
+    char key[LRU_KEY];
+    Entry *w;
+    world_key(r, key);
+    w = lru_get(&CACHE, key);
+    if (w) return w;
+    pthread_mutex_lock(&GEN_LOCK);
+    w = lru_get(&CACHE, key);          /* genere pendant l'attente ? */
+    if (!w) {
+        w = world_build(r, key);
+        if (w) w = lru_put(&CACHE, w);
+        if (w) lru_count(&CACHE, &CACHE.worlds);
+    }
+    pthread_mutex_unlock(&GEN_LOCK);
+    return w;
+}
+
+/* Hauteur du monde w (cote m) en (x, y), repliee */
+static float world_at(const float *w, int m, long x, long y) {
+    x %= m; if (x < 0) x += m;
+    y %= m; if (y < 0) y += m;
+    return w[(size_t)y * (size_t)m + (size_t)x];
+}
+
+static double tile_get(const void *grid, size_t i) { return (double)((const float*)grid)[i]; }
+
+/* Reponse de la requete r (tuile), a partir du monde w */
+static Entry *tile_build(const Req *r, const char *key, const Entry *w) {
+    const float *world = (const float*)w->data;
+    int m = 1 << r->n, S = r->size, x, y;
+    long x0 = r->tx * (long)S, y0 = r->ty * (long)S;
+    char hdr[64];
+    size_t hl, i;
+    Entry *t;
+
+    if (r->kind == REQ_HEIGHT && r->txt) {
+        /* "%.6f" et separateur : 9 octets par valeur au plus */
+        char *p;
+        t = lru_new(key, "text/plain", (size_t)S * (size_t)S * 9 + 1);
+        if (!t) return 0;
+        p = (char*)t->data;
+        for (y = 0; y < S; ++y) {
+            for (x = 0; x < S; ++x) {
+                p += sprintf(p, "%.6f%s", world_at(world, m, x0 + x, y0 + y), (x == S - 1) ? "\n" : " ");
+            }
+        }
+        t->len = (size_t)(p - (char*)t->data);
+        return t;
+    }
+    if (r->kind == REQ_HEIGHT) {
+        /* PGM binaire 16 bits, octet fort d'abord */
+        sprintf(hdr, "P5\n%d %d\n65535\n", S, S);
+        hl = strlen(hdr);
+        t = lru_new(key, "image/x-portable-graymap", hl + (size_t)S * (size_t)S * 2);
+        if (!t) return 0;
+        memcpy(t->data, hdr, hl);
+        for (y = 0, i = hl; y < S; ++y) {
+            for (x = 0; x < S; ++x, i += 2) {
+                unsigned v = (unsigned)(world_at(world, m, x0 + x, y0 + y) * 65535.0f + 0.5f);
+                t->data[i] = (unsigned char)(v >> 8);
+                t->data[i + 1] = (unsigned char)(v & 0xFF);
+            }
+        }
+        return t;
+    }
+    if (r->kind == REQ_GEO) {
+        /* eau : cellules <= sea ; rivage teste sur le monde, sans couture */
+        sprintf(hdr, "P6\n%d %d\n255\n", S, S);
+        hl = strlen(hdr);
+        t = lru_new(key, "image/x-portable-pixmap", hl + (size_t)S * (size_t)S * 3);
+        if (!t) return 0;
+        memcpy(t->data, hdr, hl);
+        for (y = 0, i = hl; y < S; ++y) {
+            for (x = 0; x < S; ++x, i += 3) {
+                double v = world_at(world, m, x0 + x, y0 + y);
+                int wet = r->sea_set && v <= r->sea;
+                int cr, cg, cb;
+                gc_color(v, wet, r->sea, &cr, &cg, &cb);
+                if (r->sea_set) {
+                    int k;
+                    static const int dx[4] = {1,-1,0,0};
+                    static const int dy[4] = {0,0,1,-1};
+                    for (k = 0; k < 4; ++k) {
+                        int wet2 = world_at(world, m, x0 + x + dx[k], y0 + y + dy[k]) <= r->sea;
+                        if (wet2 != wet) { gc_shore(&cr, &cg, &cb); break; }
+                    }
+                }
+                t->data[i] = (unsigned char)ir_clamp8(cr);
+                t->data[i + 1] = (unsigned char)ir_clamp8(cg);
+                t->data[i + 2] = (unsigned char)ir_clamp8(cb);
+            }
+        }
+        return t;
+    }
+    /* REQ_ISO : extrait (eau aplatie au niveau sea), puis rendu d'iso */
+    {
+        static const unsigned char bg[3] = { 16, 16, 24 };
+        float *h = (float*)malloc((size_t)S * (size_t)S * sizeof(float));
+        int fbw, fbh;
+        if (!h || ir_size(S, S, r->tw, r->th, r->zs, &fbw, &fbh) != 0) { free(h); return 0; }
+        for (y = 0; y < S; ++y) {
+            for (x = 0; x < S; ++x) {
+                float v = world_at(world, m, x0 + x, y0 + y);
+                if (r->sea_set && v < (float)r->sea) v = (float)r->sea;
+                h[(size_t)y * (size_t)S + (size_t)x] = v;
+            }
+        }
+        sprintf(hdr, "P6\n%d %d\n255\n", fbw, fbh);
+        hl = strlen(hdr);
+        t = lru_new(key, "image/x-portable-pixmap", hl + (size_t)fbw * (size_t)fbh * 3);
+        if (t) {
+            memcpy(t->data, hdr, hl);
+            ir_render(t->data + hl, fbw, fbh, h, tile_get, S, S, r->tw, r->th, r->zs, bg);
+        }
+        free(h);
+        return t;
+    }
+}
+
+/* ----- Reseau ----- */
+
+static int send_all(int fd, const void *buf, size_t len) {
+    const char *p = (const char*)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void send_response(int fd, int status, const char *type, const void *body, size_t len, const char *cache) {
+    char hdr[256];
+    const char *text = (status == 200) ? "OK" : (status == 400) ? "Bad Request"
+                     : (status == 404) ? "Not Found" : (status == 405) ? "Method Not Allowed"
+                     : (status == 408) ? "Request Timeout"
+                     : (status == 503) ? "Service Unavailable" : "Internal Server Error";
+    sprintf(hdr, "HTTP/1.0 %d %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\n%s%s%sConnection: close\r\n\r\n",
+            status, text, type, (unsigned long)len,
+            cache ? "X-Cache: " : "", cache ? cache : "", cache ? "\r\n" : "");
+    if (send_all(fd, hdr, strlen(hdr)) == 0 && len > 0) send_all(fd, body, len);
+}
+
+static void send_error(int fd, int status) {
+    char body[64];
+    sprintf(body, "erreur %d\n", status);
+    send_response(fd, status, "text/plain", body, strlen(body), 0);
+}
+
+static void send_stats(int fd) {
+    char body[512];
+    pthread_mutex_lock(&CACHE.lock);
+    sprintf(body, "{\"requests\":%ld,\"hits\":%ld,\"misses\":%ld,\"worlds\":%ld,\"entries\":%ld,"
+                  "\"bytes\":%lu,\"cap\":%lu,\"evictions\":%ld,\"threads\":%d,\"isa\":\"%s\"}\n",
+            CACHE.requests, CACHE.hits, CACHE.misses, CACHE.worlds, CACHE.entries,
+            (unsigned long)CACHE.bytes, (unsigned long)CACHE.cap, CACHE.evictions, THREADS, isa_name());
+    pthread_mutex_unlock(&CACHE.lock);
+    send_response(fd, 200, "application/json", body, strlen(body), 0);
+}
+
+/* Lit la requete, repond, ferme la connexion */
+static void serve(int fd) {
+    char buf[REQ_MAX + 1], key[LRU_KEY], *eol;
+    size_t got = 0;
+    Req r;
+    int status;
+    Entry *t, *w;
+    const char *how = "hit";
+
+    /* ligne de requete ; les en-tetes qui suivent sont ignores */
+    while (got < REQ_MAX) {
+        ssize_t n = read(fd, buf + got, REQ_MAX - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { send_error(fd, 408); return; }
+        if (n <= 0) break;
+        got += (size_t)n;
+        buf[got] = '\0';
+        if (strchr(buf, '\n')) break;
+    }
+    buf[got] = '\0';
+    eol = strpbrk(buf, "\r\n");
+    if (!eol) { send_error(fd, 400); return; }
+    *eol = '\0';
+    if (VERBOSE) fprintf(stderr, "serveur : %s\n", buf);
+    if (strncmp(buf, "GET ", 4) != 0) { send_error(fd, 405); return; }
+    status = req_parse(buf, &r);
+    if (status != 0) { send_error(fd, status); return; }
+    if (r.kind == REQ_STATS) { send_stats(fd); return; }
+
+    tile_key(&r, key);
+    t = lru_get(&CACHE, key);
+    lru_count(&CACHE, t ? &CACHE.hits : &CACHE.misses);
+    if (!t) {
+        how = "miss";
+        w = world_get(&r);
+        if (!w) { send_error(fd, 500); return; }
+        t = tile_build(&r, key, w);
+        lru_release(&CACHE, w);
+        if (!t) { send_error(fd, 500); return; }
+        t = lru_put(&CACHE, t);
+    }
+    send_response(fd, 200, t->type, t->data, t->len, how);
+    lru_release(&CACHE, t);
+}
+
+/* File des connexions acceptees */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    int fds[QUEUE_CAP];
+    int head, count, closed;
+} QUEUE = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, {0}, 0, 0, 0 };
+
+static int queue_push(int fd) {
+    int ok;
+    pthread_mutex_lock(&QUEUE.lock);
+    ok = QUEUE.count < QUEUE_CAP;
+    if (ok) {
+        QUEUE.fds[(QUEUE.head + QUEUE.count) % QUEUE_CAP] = fd;
+        QUEUE.count++;
+        pthread_cond_signal(&QUEUE.ready);
+    }
+    pthread_mutex_unlock(&QUEUE.lock);
+    return ok ? 0 : -1;
+}
+
+/* Prochaine connexion, -1 quand la file est fermee et vide */
+static int queue_pop(void) {
+    int fd = -1;
+    pthread_mutex_lock(&QUEUE.lock);
+    while (QUEUE.count == 0 && !QUEUE.closed) pthread_cond_wait(&QUEUE.ready, &QUEUE.lock);
+    if (QUEUE.count > 0) {
+        fd = QUEUE.fds[QUEUE.head];
+        QUEUE.head = (QUEUE.head + 1) % QUEUE_CAP;
+        QUEUE.count--;
+    }
+    pthread_mutex_unlock(&QUEUE.lock);
+    return fd;
+}
+
+static void *worker(void *arg) {
+    int fd;
+    (void)arg;
+#ifdef _OPENMP
+    if (TUNE.threads > 0) omp_set_num_threads(TUNE.threads);  /* reglage par thread */
+#endif
+    while ((fd = queue_pop()) >= 0) {
+        serve(fd);
+        close(fd);
+    }
+    return 0;
+}
+
+static void on_signal(int sig) { (void)sig; STOP = 1; }
+
+/* Socket d'ecoute : UNIX_PATH, sinon 127.0.0.1:PORT. -1 si impossible. */
+static int listen_socket(void) {
+    int fd;
+    if (UNIX_PATH) {
+        struct sockaddr_un sa;
+        if (strlen(UNIX_PATH) >= sizeof(sa.sun_path)) {
+            fprintf(stderr, "Chemin de socket trop long : %s\n", UNIX_PATH);
+            return -1;
+        }
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        strcpy(sa.sun_path, UNIX_PATH);
+        unlink(UNIX_PATH);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || listen(fd, QUEUE_CAP) != 0) {
+            fprintf(stderr, "Impossible d'ecouter sur %s : %s\n", UNIX_PATH, strerror(errno));
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+    } else {
+        struct sockaddr_in sa;
+        int one = 1;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons((unsigned short)PORT);
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (fd < 0 || bind(fd, (struct sockaddr*)&sa, sizeof(sa)) != 0 || listen(fd, QUEUE_CAP) != 0) {
+            fprintf(stderr, "Impossible d'ecouter sur 127.0.0.1:%d : %s\n", PORT, strerror(errno));
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --port N         ecoute sur 127.0.0.1:N (defaut 8088)\n"
+        "  --unix PATH      ecoute sur la socket UNIX PATH au lieu du port\n"
+        "  -j N             threads de travail (defaut 4)\n"
+        "  --cache-mb MIB   taille du cache LRU (defaut 256)\n"
+        "  --max-requests N s'arreter apres N connexions (essais)\n"
+        "  --force-isa I    noyaux scalar, sse2, avx2 ou avx512 (defaut : cpuid)\n"
+        "  -v               une ligne par requete sur stderr\n"
+        "Requetes : GET /height, /geo, /iso, /stats (voir l'en-tete de serveur.c)\n",
+        prog);
+}
+
+int main(int argc, char **argv) {
+    int i, lfd, started;
+    long served = 0;
+    pthread_t *pool;
+    struct sigaction sa;
+
+    tn_init("serveur");
+    for (i = 1; i < argc; ) {
+        const char *a = argv[i];
+        if (strcmp(a, "--port") == 0 && i + 1 < argc) {
+            char *e = 0; long v = strtol(argv[i+1], &e, 10);
+            if (*e != '\0' || v <= 0 || v > 65535) { print_usage(argv[0]); return 1; }
+            PORT = (int)v; i += 2; continue;
+        } else if (strcmp(a, "--unix") == 0 && i + 1 < argc) {
+            UNIX_PATH = argv[i+1]; i += 2; continue;
+        } else if (strcmp(a, "-j") == 0 && i + 1 < argc) {
+            char *e = 0; long v = strtol(argv[i+1], &e, 10);
+            if (*e != '\0' || v <= 0 || v > 256) { print_usage(argv[0]); return 1; }
+            THREADS = (int)v; i += 2; continue;
+        } else if (strcmp(a, "--cache-mb") == 0 && i + 1 < argc) {
+            char *e = 0; long v = strtol(argv[i+1], &e, 10);
+            if (*e != '\0' || v < 0 || (unsigned long)v > ((size_t)-1 >> 20)) { print_usage(argv[0]); return 1; }
+            CACHE_BYTES = (size_t)v << 20; i += 2; continue;
+        } else if (strcmp(a, "--max-requests") == 0 && i + 1 < argc) {
+            char *e = 0; long v = strtol(argv[i+1], &e, 10);
+            if (*e != '\0' || v < 0) { print_usage(argv[0]); return 1; }
+            MAX_REQUESTS = v; i += 2; continue;
+        } else if (strcmp(a, "--force-isa") == 0 && i + 1 < argc) {
+            FORCE_ISA = argv[i+1]; i += 2; continue;
+        } else if (strcmp(a, "-v") == 0) {
+            VERBOSE = 1; i += 1; continue;
+        } else {
+            print_usage(argv[0]); return 1;
+        }
+    }
+
+    if (isa_init(FORCE_ISA) != 0) return 1;
+    kernels_select(ISA.level);
+    kernels_select_f32(ISA.level);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;         /* sans SA_RESTART : accept s'interrompt */
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, 0);
+    sigaction(SIGTERM, &sa, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_mutex_init(&CACHE.lock, 0);
+    CACHE.cap = CACHE_BYTES;
+    lfd = listen_socket();
+    if (lfd < 0) return 1;
+    pool = (pthread_t*)malloc((size_t)THREADS * sizeof(pthread_t));
+    if (!pool) { fprintf(stderr, "Allocation impossible.\n"); close(lfd); return 1; }
+    for (started = 0; started < THREADS; ++started) {
+        if (pthread_create(&pool[started], 0, worker, 0) != 0) break;
+    }
+    if (started == 0) { fprintf(stderr, "Impossible de creer les threads.\n"); close(lfd); return 1; }
+    if (UNIX_PATH) fprintf(stderr, "serveur : %s, %d threads, cache %lu Mio\n", UNIX_PATH, started, (unsigned long)(CACHE_BYTES >> 20));
+    else fprintf(stderr, "serveur : http://127.0.0.1:%d/, %d threads, cache %lu Mio\n", PORT, started, (unsigned long)(CACHE_BYTES >> 20));
+
+    while (!STOP && (MAX_REQUESTS == 0 || served < MAX_REQUESTS)) {
+        int fd = accept(lfd, 0, 0);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            fprintf(stderr, "accept : %s\n", strerror(errno));
+            break;
+        }
+        {
+            struct timeval tv;
+            tv.tv_sec = CONN_TIMEOUT;
+            tv.tv_usec = 0;
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        }
+        served++;
+        lru_count(&CACHE, &CACHE.requests);
+        if (queue_push(fd) != 0) {
+            send_error(fd, 503);
+            close(fd);
+        }
+    }
+
+    /* arret : les connexions deja acceptees sont servies */
+    close(lfd);
+    if (UNIX_PATH) unlink(UNIX_PATH);
+    pthread_mutex_lock(&QUEUE.lock);
+    QUEUE.closed = 1;
+    pthread_cond_broadcast(&QUEUE.ready);
+    pthread_mutex_unlock(&QUEUE.lock);
+    for (i = 0; i < started; ++i) pthread_join(pool[i], 0);
+    free(pool);
+    {
+        Entry *e = CACHE.head;
+        while (e) { Entry *n = e->next; free(e); e = n; }
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * simd_dispatch.h — table des noyaux de simd_kernels.h selon isa.h
+ * C ANSI C89
+ *
+ * Inclus sans garde, comme simd_kernels.h : par fcore.h pour chaque
+ * precision de plasma et geo (PX_FN defini : table PX_FN(KN) de type
+ * PX_FN(Kernels)), et par iso.c sans PX_T (table KN, rasterisation).
+ * Instancie les quatre variantes des noyaux, puis :
+ *   KN_NAME(kernels_select)(isa)   remplit la table pour la variante isa
+ * a appeler au demarrage apres isa_init ; les appels passent ensuite par
+ * la table, sans test a chaque ligne.
+ */
+
+#ifdef PX_FN
+#define KN_NAME(name) PX_FN(name)
+#else
+#define KN_NAME(name) name
+#endif
+
+#define KN_TARGET ISA_TARGET_SCALAR
+#define KN_FN(name) KN_NAME(name##_scalar)
+#include "simd_kernels.h"
+#if ISA_X86
+#define KN_TARGET ISA_TARGET_SSE2
+#define KN_FN(name) KN_NAME(name##_sse2)
+#include "simd_kernels.h"
+#define KN_TARGET ISA_TARGET_AVX2
+#define KN_FN(name) KN_NAME(name##_avx2)
+#include "simd_kernels.h"
+#define KN_TARGET ISA_TARGET_AVX512
+#define KN_FN(name) KN_NAME(name##_avx512)
+#include "simd_kernels.h"
+#endif
+
+#ifdef PX_T
+
+typedef struct {
+    void (*resample_row)(const PX_T *r0, const PX_T *r1, int n, int period,
+                         double spanX, double denomX, PX_C fy, PX_T *out, int W);
+    void (*blur_row)(const PX_T *src, int W, int H, int y, int r, int wrap,
+                     int x0, int x1, PX_T *out);
+    void (*ds_diamond_avg)(const PX_T *row0, const PX_T *row1, int len, PX_C *avg);
+    void (*ds_square_avg)(const PX_T *up, const PX_T *row, const PX_T *down, int len, PX_C *avg);
+    void (*minmax)(const PX_T *g, size_t N, PX_C *mn, PX_C *mx);
+    void (*rescale)(PX_T *g, size_t N, PX_C mn, PX_C d);
+    void (*palette_row)(const PX_T *row, int n, const char *palette, int plen, char *out);
+    void (*fbm_octave)(const unsigned char *perm, double sx, double f, double ox, double oy,
+                       int x0, int n, double a, double *out);
+} KN_NAME(Kernels);
+
+#define KN_FILL(sfx) \
+    k->resample_row   = KN_NAME(resample_row##sfx); \
+    k->blur_row       = KN_NAME(blur_row##sfx); \
+    k->ds_diamond_avg = KN_NAME(ds_diamond_avg##sfx); \
+    k->ds_square_avg  = KN_NAME(ds_square_avg##sfx); \
+    k->minmax         = KN_NAME(minmax##sfx); \
+    k->rescale        = KN_NAME(rescale##sfx); \
+    k->palette_row    = KN_NAME(palette_row##sfx); \
+    k->fbm_octave     = KN_NAME(fbm_octave##sfx)
+
+#else /* !PX_T */
+
+typedef struct {
+    void (*tri_fill)(unsigned char *fb, size_t stride, int n, int h,
+                     long e0, long e1, long e2, long a0, long a1, long a2,
+                     long b0, long b1, long b2, const unsigned char *rgb);
+} KN_NAME(Kernels);
+
+#define KN_FILL(sfx) \
+    k->tri_fill = KN_NAME(tri_fill##sfx)
+
+#endif /* PX_T */
+
+static KN_NAME(Kernels) KN_NAME(KN);
+
+ISA_FN void KN_NAME(kernels_select)(int isa) {
+    KN_NAME(Kernels) *k = &KN_NAME(KN);
+    switch (isa) {
+#if ISA_X86
+    case ISA_AVX512: KN_FILL(_avx512); break;
+    case ISA_AVX2:   KN_FILL(_avx2); break;
+    case ISA_SSE2:   KN_FILL(_sse2); break;
+#endif
+    default:         KN_FILL(_scalar); break;
+    }
+}
+
+#undef KN_FILL
+#undef KN_NAME
@@ -0,0 +1,275 @@
+/*
+ * simd_kernels.h — noyaux chauds, une instance par jeu d'instructions
+ * C ANSI C89
+ *
+ * Inclus quatre fois par simd_dispatch.h (pas de garde d'inclusion), une
+ * fois par variante de isa.h. Macros attendues, retirees en fin de fichier :
+ *   KN_FN(nom)   nom de la fonction generee (suffixe de la variante)
+ *   KN_TARGET    attribut de la variante (ISA_TARGET_AVX2...)
+ * Avec PX_T defini (instance par precision de fcore.h, pour plasma
+ * et geo), noyaux de grille generiques sur PX_T / PX_C / PX_LOAD /
+ * PX_STORE ; sans PX_T, noyaux sur entiers et octets (rasterisation d'iso).
+ *
+ * Chaque noyau traite une ligne ou une portion de ligne sans cas de bord,
+ * en boucles simples sur x que le compilateur vectorise pour la variante.
+ * Les bords, le hasard et les tirages restent dans l'appelant. Pour chaque
+ * cellule, memes operations et meme ordre que le code scalaire d'origine.
+ */
+
+#define KN_LANES 16                /* voies independantes des reductions */
+
+#ifndef SIMPLEX_F2
+#define SIMPLEX_F2 0.36602540378443865   /* (sqrt(3)-1)/2 */
+#define SIMPLEX_G2 0.21132486540518713   /* (3-sqrt(3))/6 */
+#endif
+
+#ifdef PX_T
+
+/* Reechantillonnage bilineaire d'une ligne de sortie : r0 / r1 lignes
+   source encadrantes (n cellules), fy poids de r1. period > 0 : colonne
+   repliee, sinon bornee a n - 1. u >= 0 : la troncature vaut floor. */
+KN_TARGET static void KN_FN(resample_row)(const PX_T *r0, const PX_T *r1, int n, int period,
+                                          double spanX, double denomX, PX_C fy, PX_T *ISA_RESTRICT out, int W) {
+    int x;
+    /* bornes de colonne : repli (wrap = period) ou bord (wrap = n) */
+    int wrap = (period > 0) ? period : n;
+    int edge = (period > 0) ? 0 : n - 1;
+    for (x = 0; x < W; ++x) {
+        double u = ((double)x) * spanX / denomX;
+        int u0 = (int)u;
+        int u1 = u0 + 1;
+        PX_C fx = (PX_C)(u - (double)u0);
+        PX_C a, b;
+        u0 = (u0 >= wrap) ? u0 - wrap : u0;
+        u1 = (u1 >= wrap) ? edge : u1;
+        a = PX_LOAD(r0[u0]) * ((PX_C)1 - fx) + PX_LOAD(r0[u1]) * fx;
+        b = PX_LOAD(r1[u0]) * ((PX_C)1 - fx) + PX_LOAD(r1[u1]) * fx;
+        out[x] = PX_STORE(a * ((PX_C)1 - fy) + b * fy);
+    }
+}
+
+/* Flou boite de rayon r, ligne y, colonnes [x0, x1) dont le voisinage
+   reste dans la ligne (r <= x0, x1 + r <= W). Lignes voisines bornees ou
+   repliees (wrap). Somme dans l'ordre dy puis dx, comme le code d'origine. */
+KN_TARGET static void KN_FN(blur_row)(const PX_T *src, int W, int H, int y, int r, int wrap,
+                                      int x0, int x1, PX_T *out) {
+    PX_C acc[ISA_CHUNK];
+    PX_C cnt = (PX_C)((2 * r + 1) * (2 * r + 1));
+    int c0, k, dy, dx;
+    for (c0 = x0; c0 < x1; c0 += ISA_CHUNK) {
+        int len = (x1 - c0 < ISA_CHUNK) ? x1 - c0 : ISA_CHUNK;
+        for (k = 0; k < len; ++k) acc[k] = 0;
+        for (dy = -r; dy <= r; ++dy) {
+            int yy = y + dy;
+            const PX_T *row;
+            if (wrap) { yy %= H; if (yy < 0) yy += H; }
+            else { if (yy < 0) yy = 0; if (yy >= H) yy = H - 1; }
+            row = src + (size_t)yy * (size_t)W + (size_t)c0;
+            for (dx = -r; dx <= r; ++dx) {
+                const PX_T *p = row + dx;
+                for (k = 0; k < len; ++k) acc[k] += PX_LOAD(p[k]);
+            }
+        }
+        for (k = 0; k < len; ++k) out[c0 + k] = PX_STORE(acc[k] / cnt);
+    }
+}
+
+/* Diamond-square, losanges : moyenne des 4 coins de chaque carre,
+   row0[j], row0[j+1], row1[j], row1[j+1] pour j < len */
+KN_TARGET static void KN_FN(ds_diamond_avg)(const PX_T *row0, const PX_T *row1, int len, PX_C *avg) {
+    int j;
+    for (j = 0; j < len; ++j) {
+        avg[j] = (PX_LOAD(row0[j]) + PX_LOAD(row0[j + 1])
+                + PX_LOAD(row1[j]) + PX_LOAD(row1[j + 1])) * (PX_C)0.25;
+    }
+}
+
+/* Diamond-square, carres interieurs : row[2k] a pour voisins up[2k],
+   down[2k], row[2k-1], row[2k+1], pour k < len */
+KN_TARGET static void KN_FN(ds_square_avg)(const PX_T *up, const PX_T *row, const PX_T *down,
+                                           int len, PX_C *avg) {
+    int k;
+    for (k = 0; k < len; ++k) {
+        PX_C sum = PX_LOAD(up[2 * k]) + PX_LOAD(down[2 * k])
+                 + PX_LOAD(row[2 * k - 1]) + PX_LOAD(row[2 * k + 1]);
+        avg[k] = sum / (PX_C)4;
+    }
+}
+
+/* Minimum et maximum de N > 0 cellules (KN_LANES voies, puis reduction) */
+KN_TARGET static void KN_FN(minmax)(const PX_T *g, size_t N, PX_C *mn, PX_C *mx) {
+    PX_C lo[KN_LANES], hi[KN_LANES];
+    size_t i = 0;
+    int l;
+    for (l = 0; l < KN_LANES; ++l) lo[l] = hi[l] = PX_LOAD(g[0]);
+    for (; i + KN_LANES <= N; i += KN_LANES) {
+        for (l = 0; l < KN_LANES; ++l) {
+            PX_C v = PX_LOAD(g[i + (size_t)l]);
+            lo[l] = (v < lo[l]) ? v : lo[l];
+            hi[l] = (v > hi[l]) ? v : hi[l];
+        }
+    }
+    for (; i < N; ++i) {
+        PX_C v = PX_LOAD(g[i]);
+        if (v < lo[0]) lo[0] = v;
+        if (v > hi[0]) hi[0] = v;
+    }
+    for (l = 1; l < KN_LANES; ++l) {
+        if (lo[l] < lo[0]) lo[0] = lo[l];
+        if (hi[l] > hi[0]) hi[0] = hi[l];
+    }
+    *mn = lo[0];
+    *mx = hi[0];
+}
+
+/* g[i] = (g[i] - mn) / d */
+KN_TARGET static void KN_FN(rescale)(PX_T *g, size_t N, PX_C mn, PX_C d) {
+    size_t i;
+    for (i = 0; i < N; ++i) g[i] = PX_STORE((PX_LOAD(g[i]) - mn) / d);
+}
+
+/* Caracteres de palette (plen >= 1) des n valeurs de row */
+KN_TARGET static void KN_FN(palette_row)(const PX_T *row, int n, const char *palette, int plen, char *out) {
+    int idx[ISA_CHUNK];
+    int c0, k;
+    for (c0 = 0; c0 < n; c0 += ISA_CHUNK) {
+        int len = (n - c0 < ISA_CHUNK) ? n - c0 : ISA_CHUNK;
+        for (k = 0; k < len; ++k) {
+            double v = (double)PX_LOAD(row[c0 + k]);
+            int i = (int)(v * (double)(plen - 1) + 0.5);
+            i = (i < 0) ? 0 : i;
+            idx[k] = (i >= plen) ? plen - 1 : i;
+        }
+        for (k = 0; k < len; ++k) out[c0 + k] = palette[idx[k]];
+    }
+}
+
+/* Une octave de bruit simplex 2D sur n pixels consecutifs d'une ligne :
+   out[k] += a * simplex(x * sx * f + ox, oy), x = x0 + k. perm : table de
+   permutation doublee (512). Par tampons de ISA_CHUNK pixels, en trois
+   boucles : coins et cellules (vectorisee, floor), hachage dans perm
+   (scalaire, acces indirects), puis contributions des trois coins
+   (vectorisee). Memes operations et meme ordre pour chaque ISA : resultat
+   identique bit a bit. */
+KN_TARGET static void KN_FN(fbm_octave)(const unsigned char *perm, double sx, double f,
+                                        double ox, double oy, int x0, int n, double a,
+                                        double *ISA_RESTRICT out) {
+    static const double grad[8][2] = {
+        { 1.0, 1.0}, {-1.0, 1.0}, { 1.0,-1.0}, {-1.0,-1.0},
+        { 1.0, 0.0}, {-1.0, 0.0}, { 0.0, 1.0}, { 0.0,-1.0}
+    };
+    double px[ISA_CHUNK], py[ISA_CHUNK];
+    double g0x[ISA_CHUNK], g0y[ISA_CHUNK], g1x[ISA_CHUNK], g1y[ISA_CHUNK];
+    double g2x[ISA_CHUNK], g2y[ISA_CHUNK];
+    int ci[ISA_CHUNK], cj[ISA_CHUNK], up[ISA_CHUNK];
+    int c0, k;
+    for (c0 = 0; c0 < n; c0 += ISA_CHUNK) {
+        int len = (n - c0 < ISA_CHUNK) ? n - c0 : ISA_CHUNK;
+        for (k = 0; k < len; ++k) {
+            double xin = (double)(x0 + c0 + k) * sx * f + ox, yin = oy;
+            double s = (xin + yin) * SIMPLEX_F2;
+            double fi = floor(xin + s), fj = floor(yin + s);
+            double t = (fi + fj) * SIMPLEX_G2;
+            px[k] = xin - (fi - t);
+            py[k] = yin - (fj - t);
+            up[k] = (px[k] > py[k]) ? 1 : 0;
+            ci[k] = (int)fi & 255;
+            cj[k] = (int)fj & 255;
+        }
+        for (k = 0; k < len; ++k) {
+            int ii = ci[k], jj = cj[k], i1 = up[k], j1 = 1 - i1;
+            const double *g0 = grad[perm[ii + perm[jj]] & 7];
+            const double *g1 = grad[perm[ii + i1 + perm[jj + j1]] & 7];
+            const double *g2 = grad[perm[ii + 1 + perm[jj + 1]] & 7];
+            g0x[k] = g0[0]; g0y[k] = g0[1];
+            g1x[k] = g1[0]; g1y[k] = g1[1];
+            g2x[k] = g2[0]; g2y[k] = g2[1];
+        }
+        for (k = 0; k < len; ++k) {
+            double X0 = px[k], Y0 = py[k];
+            double i1 = (double)up[k], j1 = 1.0 - i1;
+            double X1 = X0 - i1 + SIMPLEX_G2, Y1 = Y0 - j1 + SIMPLEX_G2;
+            double X2 = X0 - 1.0 + 2.0 * SIMPLEX_G2, Y2 = Y0 - 1.0 + 2.0 * SIMPLEX_G2;
+            double t0 = 0.5 - X0 * X0 - Y0 * Y0;
+            double t1 = 0.5 - X1 * X1 - Y1 * Y1;
+            double t2 = 0.5 - X2 * X2 - Y2 * Y2;
+            t0 = (t0 < 0.0) ? 0.0 : t0;
+            t1 = (t1 < 0.0) ? 0.0 : t1;
+            t2 = (t2 < 0.0) ? 0.0 : t2;
+            t0 *= t0; t1 *= t1; t2 *= t2;
+            out[c0 + k] += a * (70.0 * (t0 * t0 * (g0x[k] * X0 + g0y[k] * Y0) +
+                                        t1 * t1 * (g1x[k] * X1 + g1y[k] * Y1) +
+                                        t2 * t2 * (g2x[k] * X2 + g2y[k] * Y2)));
+        }
+    }
+}
+
+#else /* !PX_T */
+
+/* Pixels pleins d'une ligne de triangle, colonnes [0, n) : fonctions de
+   bord e* en colonne 0, pas a* par colonne. Plein si les trois sont >= 0
+   ou les trois <= 0 ; dans un triangle, ces pixels sont contigus.
+   Premier et dernier dans *lo / *hi (*lo > *hi si aucun). Calcul sur
+   64 bits, ou 32 bits (deux fois plus de voies) quand tri_fill l'autorise. */
+KN_TARGET static void KN_FN(tri_span64)(long e0, long e1, long e2, long a0, long a1, long a2,
+                                        int n, int *lo, int *hi) {
+    int i, first = n, last = -1;
+    for (i = 0; i < n; ++i) {
+        long w0 = e0 + (long)i * a0;
+        long w1 = e1 + (long)i * a1;
+        long w2 = e2 + (long)i * a2;
+        int in = ((w0 >= 0) & (w1 >= 0) & (w2 >= 0)) | ((w0 <= 0) & (w1 <= 0) & (w2 <= 0));
+        int f = in ? i : n, l = in ? i : -1;
+        first = (f < first) ? f : first;
+        last = (l > last) ? l : last;
+    }
+    *lo = first;
+    *hi = last;
+}
+
+KN_TARGET static void KN_FN(tri_span32)(int e0, int e1, int e2, int a0, int a1, int a2,
+                                        int n, int *lo, int *hi) {
+    int i, first = n, last = -1;
+    for (i = 0; i < n; ++i) {
+        int w0 = e0 + i * a0;
+        int w1 = e1 + i * a1;
+        int w2 = e2 + i * a2;
+        int in = ((w0 >= 0) & (w1 >= 0) & (w2 >= 0)) | ((w0 <= 0) & (w1 <= 0) & (w2 <= 0));
+        int f = in ? i : n, l = in ? i : -1;
+        first = (f < first) ? f : first;
+        last = (l > last) ? l : last;
+    }
+    *lo = first;
+    *hi = last;
+}
+
+/* Triangle sur h lignes de fb (pas stride octets) et n colonnes : e* au
+   coin, a* par colonne, b* par ligne ; pixels pleins mis a rgb */
+KN_TARGET static void KN_FN(tri_fill)(unsigned char *fb, size_t stride, int n, int h,
+                                      long e0, long e1, long e2, long a0, long a1, long a2,
+                                      long b0, long b1, long b2, const unsigned char *rgb) {
+    unsigned char pat[3 * 16];     /* 16 pixels rgb, recopies par blocs */
+    long m0 = (e0 < 0 ? -e0 : e0) + (long)n * (a0 < 0 ? -a0 : a0) + (long)h * (b0 < 0 ? -b0 : b0);
+    long m1 = (e1 < 0 ? -e1 : e1) + (long)n * (a1 < 0 ? -a1 : a1) + (long)h * (b1 < 0 ? -b1 : b1);
+    long m2 = (e2 < 0 ? -e2 : e2) + (long)n * (a2 < 0 ? -a2 : a2) + (long)h * (b2 < 0 ? -b2 : b2);
+    int small = m0 < 2147483647L && m1 < 2147483647L && m2 < 2147483647L;
+    int y, i;
+    for (i = 0; i < 3 * 16; ++i) pat[i] = rgb[i % 3];
+    for (y = 0; y < h; ++y) {
+        int first, last;
+        unsigned char *p;
+        if (small) KN_FN(tri_span32)((int)e0, (int)e1, (int)e2, (int)a0, (int)a1, (int)a2, n, &first, &last);
+        else KN_FN(tri_span64)(e0, e1, e2, a0, a1, a2, n, &first, &last);
+        p = fb + (size_t)first * 3;
+        for (i = first; i + 16 <= last + 1; i += 16, p += 3 * 16) memcpy(p, pat, sizeof(pat));
+        if (i <= last) memcpy(p, pat, (size_t)(last + 1 - i) * 3);
+        fb += stride;
+        e0 += b0; e1 += b1; e2 += b2;
+    }
+}
+
+#endif /* PX_T */
+
+#undef KN_LANES
+#undef KN_FN
+#undef KN_TARGET
@@ -0,0 +1,174 @@
+/*
+ * stcache.h — cache disque des etapes de calcul (--cache DIR)
+ * C ANSI C89, en-tete seul (fonctions static), utilise par geo.c.
+ *
+ * Chaque etape (grille DS, carte reechantillonnee, carte lissee, masque
+ * d'eau) est rangee sous une cle : le texte des parametres qui l'ont
+ * produite, y compris ceux des etapes precedentes. Le fichier s'appelle
+ *   DIR/<etape>-<empreinte de la cle>.grid
+ * et commence par un en-tete texte de SC_HDR octets (version, ordre des
+ * octets, taille, cle complete), suivi des cellules brutes. Deux cles
+ * differentes de meme empreinte ne se confondent pas : l'en-tete lu doit
+ * etre identique octet pour octet a celui attendu.
+ *
+ * sc_fetch projette le fichier (mmap sous POSIX, fread ailleurs) et le
+ * recopie dans le tampon de l'appelant ; sc_store ecrit un fichier
+ * temporaire puis le renomme, un lecteur concurrent ne voit donc jamais
+ * de fichier partiel. Le cache est facultatif : toute erreur se reduit a
+ * un message sur stderr et au calcul normal de l'etape.
+ *
+ * Les cles portent un numero de version de l'outil (geo1...) : a changer
+ * quand un calcul change, les anciens fichiers sont alors ignores.
+ */
+
+#ifndef STCACHE_H
+#define STCACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define SC_POSIX 1
+#else
+#define SC_POSIX 0
+#endif
+
+#define SC_HDR  1024               /* en-tete, et aussi alignement des cellules */
+#define SC_KEY  768                /* longueur max. d'une cle, zero compris */
+#define SC_PATH 1024
+
+#if defined(__GNUC__)
+#define SC_FN static __attribute__((unused))
+#else
+#define SC_FN static
+#endif
+
+typedef struct {
+    const char *dir;           /* 0 : cache desactive */
+    int hits, stores;
+    int warned;                /* un seul message d'ecriture impossible */
+} StageCache;
+
+static StageCache SCACHE;
+
+/* Empreinte 64 bits de la cle (FNV-1a et un second melange 32 bits),
+   en 16 chiffres hexa */
+SC_FN void sc_digest(const char *key, char *hex) {
+    unsigned long h1 = 2166136261UL, h2 = 0x9E3779B9UL;
+    const unsigned char *p;
+    for (p = (const unsigned char *)key; *p; ++p) {
+        h1 = ((h1 ^ *p) * 16777619UL) & 0xFFFFFFFFUL;
+        h2 = ((h2 + *p) * 0x5BD1E995UL) & 0xFFFFFFFFUL;
+        h2 ^= h2 >> 15;
+    }
+    sprintf(hex, "%08lx%08lx", h1, h2);
+}
+
+/* Ordre des octets des cellules : "le" ou "be" */
+SC_FN const char *sc_order(void) {
+    unsigned int one = 1;
+    return (*(const unsigned char *)&one == 1) ? "le" : "be";
+}
+
+/* Chemin du fichier de l'etape ; -1 si trop long */
+SC_FN int sc_path(char *path, const char *stage, const char *key, const char *suffix) {
+    char hex[17];
+    if (strlen(SCACHE.dir) + strlen(stage) + strlen(suffix) + 24 > SC_PATH) return -1;
+    sc_digest(key, hex);
+    sprintf(path, "%s/%s-%s.grid%s", SCACHE.dir, stage, hex, suffix);
+    return 0;
+}
+
+/* En-tete attendu pour (cle, taille) ; -1 si la cle est trop longue */
+SC_FN int sc_header(char *hdr, const char *key, size_t bytes) {
+    if (strlen(key) >= SC_KEY) return -1;
+    memset(hdr, 0, SC_HDR);
+    sprintf(hdr, "fractale-stage 1 %s %lu\n%s\n", sc_order(), (unsigned long)bytes, key);
+    return 0;
+}
+
+/* Active le cache dans dir (cree s'il manque, sous POSIX) */
+SC_FN void sc_init(const char *dir) {
+    SCACHE.dir = dir;
+    SCACHE.hits = SCACHE.stores = SCACHE.warned = 0;
+#if SC_POSIX
+    mkdir(dir, 0777);
+#endif
+}
+
+/* Copie dans dst les bytes octets de l'etape (stage, key) si elle est en
+   cache. Retourne 1 si trouvee, 0 sinon (dst inchange). */
+SC_FN int sc_fetch(const char *stage, const char *key, void *dst, size_t bytes) {
+    char path[SC_PATH], hdr[SC_HDR];
+    int found = 0;
+    if (!SCACHE.dir || sc_path(path, stage, key, "") != 0 || sc_header(hdr, key, bytes) != 0) return 0;
+#if SC_POSIX
+    {
+        struct stat st;
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return 0;
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size == SC_HDR + bytes) {
+            void *m = mmap(0, SC_HDR + bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                if (memcmp(m, hdr, SC_HDR) == 0) {
+                    memcpy(dst, (const unsigned char *)m + SC_HDR, bytes);
+                    found = 1;
+                }
+                munmap(m, SC_HDR + bytes);
+            }
+        }
+        close(fd);
+    }
+#else
+    {
+        char got[SC_HDR];
+        FILE *f = fopen(path, "rb");
+        if (!f) return 0;
+        if (fread(got, 1, SC_HDR, f) == SC_HDR && memcmp(got, hdr, SC_HDR) == 0
+            && fread(dst, 1, bytes, f) == bytes && fgetc(f) == EOF) found = 1;
+        fclose(f);
+    }
+#endif
+    if (found) SCACHE.hits++;
+    return found;
+}
+
+/* Range les bytes octets de src sous (stage, key). Retourne 0, ou -1
+   (message sur stderr la premiere fois) si l'ecriture echoue. */
+SC_FN int sc_store(const char *stage, const char *key, const void *src, size_t bytes) {
+    char path[SC_PATH], tmp[SC_PATH + 32], hdr[SC_HDR];
+    FILE *f;
+    int ok;
+    if (!SCACHE.dir) return 0;
+    if (sc_path(path, stage, key, "") != 0 || sc_header(hdr, key, bytes) != 0) return -1;
+#if SC_POSIX
+    sprintf(tmp, "%s.%ld", path, (long)getpid());
+#else
+    sprintf(tmp, "%s.tmp", path);
+#endif
+    f = fopen(tmp, "wb");
+    ok = f && fwrite(hdr, 1, SC_HDR, f) == SC_HDR && fwrite(src, 1, bytes, f) == bytes;
+    if (f && fclose(f) != 0) ok = 0;
+    if (ok) {
+#if !SC_POSIX
+        remove(path);
+#endif
+        ok = (rename(tmp, path) == 0);
+    }
+    if (!ok) {
+        if (f) remove(tmp);
+        if (!SCACHE.warned) fprintf(stderr, "cache : ecriture impossible dans %s, etapes non conservees.\n", SCACHE.dir);
+        SCACHE.warned = 1;
+        return -1;
+    }
+    SCACHE.stores++;
+    return 0;
+}
+
+#endif /* STCACHE_H */
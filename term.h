@@ -0,0 +1,282 @@
+/*
+ * term.h — sorties couleur et animation dans le terminal
+ * C ANSI C89 + sequences ANSI (VT100), en-tete seul (fonctions static),
+ * utilise par plasma.c (--animate, --term), geo.c et fractale.c (--term).
+ *
+ * Demi-blocs (--term truecolor|256) : chaque caractere montre deux
+ * cellules l'une au-dessus de l'autre : demi-bloc haut (U+2580) avec la
+ * couleur de texte pour la cellule du haut et le fond pour celle du bas ;
+ * espace si les deux sont egales, demi-bloc bas (U+2584) si les couleurs
+ * courantes conviennent inversees.
+ * Couleurs 24 bits (ESC [ 38;2;r;g;b m), ou les 240 couleurs de xterm
+ * (cube 6x6x6 et gris, ESC [ 38;5;n m). Une sequence ne part que si la
+ * couleur change ; le texte est assemble dans un tampon de TT_BUF octets
+ * ecrit d'un bloc : une carte 400x200 tient en quelques write.
+ *
+ * Animation (--animate) : l'image suivante est composee dans un tampon W x H
+ * (TtFrame.cur), puis comparee a l'image affichee (TtFrame.prev) : seules
+ * les suites de cellules modifiees partent, chacune precedee d'un
+ * deplacement du curseur (ESC [ ligne ; colonne H). Deux suites separees
+ * par moins de TT_GAP cellules inchangees n'en font qu'une, le texte
+ * inchange coutant moins cher que la sequence. Toute l'image part en un
+ * seul write : pas de scintillement, un seul paquet par image sur SSH.
+ *
+ * La premiere image efface l'ecran et cache le curseur ; tt_close le
+ * rend et le place sous l'image. Ctrl-C (SIGINT) leve TT_STOP : la boucle
+ * d'animation s'arrete proprement au lieu de laisser le terminal sans
+ * curseur.
+ */
+
+#ifndef TERM_H
+#define TERM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "trace.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define TT_POSIX 1
+#else
+#define TT_POSIX 0
+#endif
+
+#define TT_GAP 8                   /* cellules inchangees reecrites plutot qu'un saut */
+#define TT_MOVE 24                 /* octets max. d'un deplacement du curseur */
+#define TT_BUF (1 << 20)           /* tampon des demi-blocs */
+
+/* Modes de --term */
+#define TT_NONE 0
+#define TT_TRUE 1
+#define TT_256  2
+
+#if defined(__GNUC__)
+#define TT_FN static __attribute__((unused))
+#else
+#define TT_FN static
+#endif
+
+typedef struct {
+    int W, H;
+    char *cur, *prev;          /* image en preparation, image affichee */
+    char *out;                 /* octets de l'image, un seul write */
+    size_t cap, len;
+    int shown;                 /* une image deja a l'ecran */
+    long frames;               /* images envoyees */
+    double bytes, secs;        /* octets et temps de tt_flush cumules */
+} TtFrame;
+
+static volatile sig_atomic_t TT_STOP = 0;
+
+static void tt_on_signal(int sig) { (void)sig; TT_STOP = 1; }
+
+/* Tampons d'une animation W x H. Retourne 0, ou -1 (memoire). */
+TT_FN int tt_open(TtFrame *t, int W, int H) {
+    size_t cells = (size_t)W * (size_t)H;
+    memset(t, 0, sizeof(*t));
+    t->W = W;
+    t->H = H;
+    /* pire cas : une suite toutes les TT_GAP + 1 cellules, chacune avec
+       son deplacement, plus l'effacement initial */
+    t->cap = cells + (size_t)H * ((size_t)W / (TT_GAP + 1) + 1) * TT_MOVE + 64;
+    t->cur = (char*)malloc(cells ? cells : 1);
+    t->prev = (char*)malloc(cells ? cells : 1);
+    t->out = (char*)malloc(t->cap);
+    if (!t->cur || !t->prev || !t->out) {
+        free(t->cur); free(t->prev); free(t->out);
+        return -1;
+    }
+    memset(t->cur, ' ', cells);
+    memset(t->prev, 0, cells);     /* jamais un caractere affiche : tout part */
+    signal(SIGINT, tt_on_signal);
+    return 0;
+}
+
+/* Envoie len octets de p sur la sortie standard, en entier */
+TT_FN void tt_write(const char *p, size_t len) {
+#if TT_POSIX
+    fflush(stdout);
+    while (len > 0) {
+        ssize_t w = write(1, p, len);
+        if (w <= 0) return;        /* terminal ferme : rien a rattraper */
+        p += w;
+        len -= (size_t)w;
+    }
+#else
+    fwrite(p, 1, len, stdout);
+    fflush(stdout);
+#endif
+}
+
+/* Compare cur a l'image affichee et envoie les differences en un write,
+   puis cur devient l'image affichee */
+TT_FN void tt_flush(TtFrame *t) {
+    double t0 = tr_wall();
+    char *o = t->out, *sw;
+    int y, x, k, e, cy = -1, cx = -1;
+
+    if (!t->shown) {
+        strcpy(o, "\033[?25l\033[H\033[2J");
+        o += strlen(o);
+        t->shown = 1;
+    }
+    for (y = 0; y < t->H; ++y) {
+        const char *c = t->cur + (size_t)y * (size_t)t->W;
+        const char *p = t->prev + (size_t)y * (size_t)t->W;
+        for (x = 0; x < t->W; ) {
+            if (c[x] == p[x]) { ++x; continue; }
+            /* suite [x, e) : s'arrete apres TT_GAP cellules inchangees */
+            e = x + 1;
+            for (k = e; k < t->W && k - e < TT_GAP; ++k) {
+                if (c[k] != p[k]) e = k + 1;
+            }
+            if (y != cy || x != cx) {
+                sprintf(o, "\033[%d;%dH", y + 1, x + 1);
+                o += strlen(o);
+            }
+            memcpy(o, c + x, (size_t)(e - x));
+            o += e - x;
+            cy = y;
+            cx = e;
+            x = e;
+        }
+    }
+    t->len = (size_t)(o - t->out);
+    if (t->len > 0) tt_write(t->out, t->len);
+    sw = t->prev; t->prev = t->cur; t->cur = sw;
+    t->frames++;
+    t->bytes += (double)t->len;
+    t->secs += tr_wall() - t0;
+}
+
+/* Attend s secondes (rien si s <= 0) */
+TT_FN void tt_sleep(double s) {
+#if TT_POSIX
+    struct timespec ts;
+    if (s <= 0.0) return;
+    ts.tv_sec = (time_t)s;
+    ts.tv_nsec = (long)((s - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, 0);
+#else
+    double end = tr_wall() + s;
+    while (tr_wall() < end) {}
+#endif
+}
+
+/* Rend le curseur, le place sous l'image et libere les tampons */
+TT_FN void tt_close(TtFrame *t) {
+    char buf[64];
+    if (t->shown) {
+        sprintf(buf, "\033[%d;1H\033[?25h", t->H + 1);
+        tt_write(buf, strlen(buf));
+    }
+    signal(SIGINT, SIG_DFL);
+    free(t->cur);
+    free(t->prev);
+    free(t->out);
+    t->cur = t->prev = t->out = 0;
+}
+
+/* Mode de --term : "truecolor" ou "256". Retourne TT_TRUE, TT_256, ou
+   TT_NONE si le nom est inconnu. */
+TT_FN int tt_mode(const char *s) {
+    if (strcmp(s, "truecolor") == 0 || strcmp(s, "24bit") == 0) return TT_TRUE;
+    if (strcmp(s, "256") == 0) return TT_256;
+    return TT_NONE;
+}
+
+/* Indice de la couleur xterm-256 la plus proche : cube 6x6x6 (16..231)
+   ou rampe de gris (232..255) */
+TT_FN int tt_256(int r, int g, int b) {
+    static const int lv[6] = { 0, 95, 135, 175, 215, 255 };
+    int c[3], q[3], k, gi, gv;
+    long dc = 0, dg = 0;
+    c[0] = r; c[1] = g; c[2] = b;
+    for (k = 0; k < 3; ++k) {
+        q[k] = (c[k] < 48) ? 0 : (c[k] < 115) ? 1 : (c[k] - 35) / 40;
+        dc += (long)(c[k] - lv[q[k]]) * (c[k] - lv[q[k]]);
+    }
+    gi = ((r + g + b) / 3 - 3) / 10;
+    gi = (gi < 0) ? 0 : (gi > 23) ? 23 : gi;
+    gv = 8 + 10 * gi;
+    for (k = 0; k < 3; ++k) dg += (long)(c[k] - gv) * (c[k] - gv);
+    if (dg < dc) return 232 + gi;
+    return 16 + 36 * q[0] + 6 * q[1] + q[2];
+}
+
+/* Ligne y de l'image, W pixels RGB (meme forme que les lignes PPM) */
+typedef void (*TtRowFn)(void *ctx, int y, unsigned char *rgb);
+
+/* Couleur d'un pixel dans le mode : 0xRRGGBB ou indice xterm */
+TT_FN long tt_key(int mode, const unsigned char *px) {
+    if (mode == TT_256) return tt_256(px[0], px[1], px[2]);
+    return ((long)px[0] << 16) | ((long)px[1] << 8) | (long)px[2];
+}
+
+/* Parametres d'une couleur (fg : 38, bg : 48) a la suite de o */
+TT_FN char *tt_sgr(char *o, int mode, int layer, long key) {
+    if (mode == TT_256) sprintf(o, "%d;5;%ld", layer, key);
+    else sprintf(o, "%d;2;%ld;%ld;%ld", layer, (key >> 16) & 255, (key >> 8) & 255, key & 255);
+    return o + strlen(o);
+}
+
+/* Image W x H en demi-blocs colores sur la sortie standard, lignes
+   fournies par row. Retourne 0, ou -1 (memoire). */
+TT_FN int tt_blocks(int W, int H, TtRowFn row, void *ctx, int mode) {
+    unsigned char *top = (unsigned char*)malloc((size_t)W * 3 + 1);
+    unsigned char *bot = (unsigned char*)malloc((size_t)W * 3 + 1);
+    char *buf = (char*)malloc(TT_BUF), *o;
+    int y, x;
+    if (!top || !bot || !buf) {
+        free(top); free(bot); free(buf);
+        return -1;
+    }
+    o = buf;
+    for (y = 0; y < H; y += 2) {
+        long fg = -1, bg = -1;         /* couleurs courantes, -1 : inconnues */
+        row(ctx, y, top);
+        if (y + 1 < H) row(ctx, y + 1, bot);
+        for (x = 0; x < W; ++x) {
+            long t = tt_key(mode, top + 3 * x);
+            long b = (y + 1 < H) ? tt_key(mode, bot + 3 * x) : -2;   /* -2 : fond du terminal */
+            const char *glyph = "\342\226\200";                     /* U+2580 */
+            int setf = 0, setb = 0;
+            if ((size_t)(o - buf) > TT_BUF - 64) {
+                tt_write(buf, (size_t)(o - buf));
+                o = buf;
+            }
+            if (t == b) {
+                glyph = " ";
+                setb = (bg != t);
+            } else if (fg == b && bg == t) {
+                glyph = "\342\226\204";                             /* U+2584 */
+            } else {
+                setf = (fg != t);
+                setb = (bg != b);
+            }
+            if (setf || setb) {
+                *o++ = '\033'; *o++ = '[';
+                if (setf) { o = tt_sgr(o, mode, 38, t); fg = t; }
+                if (setf && setb) *o++ = ';';
+                if (setb) {
+                    if (b == -2 && t != b) { strcpy(o, "49"); o += 2; bg = -2; }
+                    else { o = tt_sgr(o, mode, 48, (t == b) ? t : b); bg = (t == b) ? t : b; }
+                }
+                *o++ = 'm';
+            }
+            strcpy(o, glyph);
+            o += strlen(glyph);
+        }
+        strcpy(o, "\033[0m\n");
+        o += strlen(o);
+    }
+    tt_write(buf, (size_t)(o - buf));
+    free(top);
+    free(bot);
+    free(buf);
+    return 0;
+}
+
+#endif /* TERM_H */
@@ -0,0 +1,226 @@
+#!/bin/sh
+# test.sh — compile plasma, geo, iso, fractale et serveur puis verifie leurs
+# sorties et leur vitesse :
+#   1. chaque cas de la matrice ci-dessous (graine, generateur, precision,
+#      options) est lance avec --checksum[=Q] ; les empreintes doivent etre
+#      celles de tests/golden/<cas>.txt. Les cas f32 et u16 utilisent
+#      Q = 1000 : seule la valeur au millieme pres compte.
+#   2. compile avec OpenMP, chaque cas de plasma, geo et fractale est
+#      relance avec -j 1 et -j $TEST_THREADS : empreintes pleine resolution
+#      identiques au bit pres.
+#   3. serveur est lance sur une socket UNIX pour quelques requetes
+#      (--max-requests) : miss puis hit de la meme tuile /geo, dont
+#      l'empreinte (cksum) doit etre celle de tests/golden/serveur-geo.txt,
+#      400, 404, 405, image /iso trop grande refusee, /stats. Sans curl,
+#      l'etape est sautee.
+#   4. avec --bench seulement, bench.sh est lance contre
+#      tests/bench-baseline.json : une mediane plus lente de plus de
+#      $TEST_TOLERANCE % est une regression. Les temps de reference sont
+#      ceux d'une machine : hors de celle-ci, l'etape n'a pas de sens.
+#
+# Usage :
+#   ./test.sh                 sorties (1, 2 et 3)
+#   ./test.sh --bench         sorties et vitesse (1 a 4)
+#   ./test.sh --update-golden reecrit les empreintes, apres un changement
+#                             voulu des sorties (relire le diff de tests/golden)
+#   ./test.sh --update-bench  reecrit la reference de vitesse, sur la machine
+#                             de reference ; les empreintes restent verifiees
+#   CC=clang CFLAGS="-std=c89 -O2" ./test.sh   (sans OpenMP : pas d'etape 2)
+#
+# Code de sortie 1 si un cas echoue. Les binaires vont dans $TEST_DIR (defaut
+# test-build/). Les empreintes dependent de la libm (sin, pow, exp) : une
+# autre plateforme peut demander --update-golden.
+
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:-"-std=c89 -O2 -fopenmp"}
+TEST_DIR=${TEST_DIR:-test-build}
+TEST_THREADS=${TEST_THREADS:-4}
+TEST_TOLERANCE=${TEST_TOLERANCE:-25}
+SRC=$(cd "$(dirname "$0")" && pwd)
+export CC CFLAGS
+GOLDEN="$SRC/tests/golden"
+BASELINE="$SRC/tests/bench-baseline.json"
+
+# le profil de la machine ne doit pas changer les cas
+FRACTALE_TUNE=
+export FRACTALE_TUNE
+
+update=0                       # --update-golden
+bench=0                        # 1 : --bench, 2 : --update-bench
+for a in "$@"; do
+    case "$a" in
+        --update-golden) update=1 ;;
+        --bench) bench=1 ;;
+        --update-bench) bench=2 ;;
+        *) echo "test.sh : option inconnue '$a'" >&2; exit 1 ;;
+    esac
+done
+
+mkdir -p "$TEST_DIR" || exit 1
+for t in plasma geo iso fractale; do
+    $CC $CFLAGS "$SRC/$t.c" -o "$TEST_DIR/$t" -lm || exit 1
+done
+$CC $CFLAGS -pthread "$SRC/serveur.c" -o "$TEST_DIR/serveur" -lm || exit 1
+case "$CFLAGS" in
+    *openmp*) omp=1 ;;
+    *) omp=0 ;;
+esac
+
+# heightmap d'entree de iso
+HMAP="$TEST_DIR/hmap.txt"
+"$TEST_DIR/plasma" -x 96 -y 64 -s 7 -f 1,1 --only-values > "$HMAP" 2>/dev/null || exit 1
+OUT="$TEST_DIR/out.ppm"
+
+# Matrice : nom | outil | Q | options
+CASES="
+plasma-ds-s1|plasma|1e6|-x 257 -y 129 -s 1 -f 1,2 --only-values
+plasma-ds-s2|plasma|1e6|-x 200 -y 300 -s 2 -a 0.7 -k 0.5 --only-values
+plasma-fbm|plasma|1e6|-x 300 -y 200 -s 3 --generator fbm -f 0,1 --only-values
+plasma-fft|plasma|1e6|-x 256 -y 256 -s 4 --generator fft -f 2,2 --only-values
+plasma-f32|plasma|1000|-x 257 -y 129 -s 1 -f 1,2 --precision f32 --only-values
+plasma-u16|plasma|1000|-x 257 -y 129 -s 1 -f 1,2 --precision u16 --only-values
+geo-s1|geo|1e6|-x 200 -y 120 -s 1 --no-values -o \$OUT
+geo-sea|geo|1e6|-x 160 -y 160 -s 5 --sea 0.45 --from-edge --no-values -o \$OUT
+geo-f32|geo|1000|-x 200 -y 120 -s 1 --precision f32 --no-values -o \$OUT
+geo-u16|geo|1000|-x 200 -y 120 -s 1 --precision u16 --no-values -o \$OUT
+iso-defaut|iso|1e6|-x 96 -y 64 -i \$HMAP -o \$OUT
+iso-tuiles|iso|1e6|-x 96 -y 64 -i \$HMAP -o \$OUT -tw 18 -th 9 -zs 120 -bg 8,8,12
+fractale-chaos|fractale|1e6|-x 80 -y 40 -s 9 -n 200000
+fractale-mandel|fractale|1e6|-x 320 -y 200 -m mandel -i 500 -o \$OUT
+fractale-julia|fractale|1e6|-x 240 -y 240 -m julia -c -0.8,0.156 -o \$OUT
+"
+
+# Empreintes d'un cas (lignes "checksum ...") : run outil Q options
+run() {
+    tool=$1 q=$2
+    shift 2
+    "$TEST_DIR/$tool" "$@" --checksum="$q" 2>&1 >/dev/null | grep '^checksum '
+}
+
+mkdir -p "$GOLDEN" || exit 1
+fail=0
+n=0
+IFS_SAVE=$IFS
+IFS='
+'
+for line in $CASES; do
+    IFS=$IFS_SAVE
+    name=${line%%|*}; rest=${line#*|}
+    tool=${rest%%|*}; rest=${rest#*|}
+    q=${rest%%|*}; args=${rest#*|}
+    eval "set -- $args"
+    n=$((n + 1))
+    got=$(run "$tool" "$q" "$@")
+    if [ -z "$got" ]; then
+        echo "ECHEC $name : pas d'empreinte"
+        fail=$((fail + 1))
+    elif [ $update -eq 1 ]; then
+        printf '%s\n' "$got" > "$GOLDEN/$name.txt"
+        echo "maj   $name"
+    elif [ ! -f "$GOLDEN/$name.txt" ]; then
+        echo "ECHEC $name : pas de tests/golden/$name.txt (./test.sh --update-golden)"
+        fail=$((fail + 1))
+    elif [ "$got" != "$(cat "$GOLDEN/$name.txt")" ]; then
+        echo "ECHEC $name : empreintes differentes"
+        printf '%s\n' "$got" | diff "$GOLDEN/$name.txt" - | sed 's/^/      /'
+        fail=$((fail + 1))
+    else
+        echo "ok    $name"
+    fi
+    if [ $omp -eq 1 ] && [ "$tool" != iso ]; then
+        j1=$(run "$tool" 1e6 "$@" -j 1)
+        jn=$(run "$tool" 1e6 "$@" -j "$TEST_THREADS")
+        if [ "$j1" != "$jn" ]; then
+            echo "ECHEC $name : -j 1 et -j $TEST_THREADS different"
+            printf '%s\n' "$j1" > "$TEST_DIR/j1.txt"
+            printf '%s\n' "$jn" | diff "$TEST_DIR/j1.txt" - | sed 's/^/      /'
+            fail=$((fail + 1))
+        else
+            echo "ok    $name -j 1 = -j $TEST_THREADS"
+        fi
+    fi
+    IFS='
+'
+done
+IFS=$IFS_SAVE
+
+# Serveur sur une socket UNIX : reponse attendue de chaque requete
+SOCK="$TEST_DIR/serveur.sock"
+GEO="/geo?seed=42&size=64&sea=0.45"
+# check nom attendu obtenu
+check() {
+    n=$((n + 1))
+    if [ "$2" = "$3" ]; then
+        echo "ok    serveur $1"
+    else
+        echo "ECHEC serveur $1 : $3 au lieu de $2"
+        fail=$((fail + 1))
+    fi
+}
+# Code HTTP et X-Cache d'une requete : req chemin [options curl]
+req() {
+    path=$1
+    shift
+    curl -s --unix-socket "$SOCK" -D "$TEST_DIR/hdr.txt" -o "$TEST_DIR/body" "$@" "http://x$path" >/dev/null
+    c=$(sed -n '1s/^HTTP[^ ]* \([0-9]*\).*/\1/p' "$TEST_DIR/hdr.txt")
+    x=$(sed -n 's/^X-Cache: \([a-z]*\).*/\1/p' "$TEST_DIR/hdr.txt")
+    echo "$c${x:+ $x}"
+}
+if command -v curl >/dev/null 2>&1; then
+    rm -f "$SOCK"
+    "$TEST_DIR/serveur" --unix "$SOCK" -j 2 --max-requests 8 2>/dev/null &
+    pid=$!
+    k=0
+    while [ ! -S "$SOCK" ] && [ $k -lt 50 ]; do sleep 0.1; k=$((k + 1)); done
+    check "$GEO (1)" "200 miss" "$(req "$GEO")"
+    got=$(cksum < "$TEST_DIR/body")
+    check "$GEO (2)" "200 hit" "$(req "$GEO")"
+    check "$GEO identique" "$got" "$(cksum < "$TEST_DIR/body")"
+    if [ $update -eq 1 ]; then
+        printf '%s\n' "$got" > "$GOLDEN/serveur-geo.txt"
+        echo "maj   serveur-geo"
+    else
+        check "$GEO empreinte" "$(cat "$GOLDEN/serveur-geo.txt" 2>/dev/null)" "$got"
+    fi
+    check "a=nan" 400 "$(req "/height?a=nan&fmt=txt")"
+    check "/inconnu" 404 "$(req /inconnu)"
+    check "POST" 405 "$(req /stats -X POST)"
+    check "/iso trop grande" 400 "$(req "/iso?size=512&tw=256&th=256&zs=4096")"
+    check "/iso" "200 miss" "$(req "/iso?seed=42&size=16")"
+    check "/stats" 200 "$(req /stats)"
+    check "/stats hits" '"hits":1' "$(grep -o '"hits":[0-9]*' "$TEST_DIR/body")"
+    # --max-requests atteint : le serveur s'arrete seul
+    k=0
+    while kill -0 $pid 2>/dev/null && [ $k -lt 50 ]; do sleep 0.1; k=$((k + 1)); done
+    kill $pid 2>/dev/null
+    wait $pid
+    check "arret" 0 "$?"
+else
+    echo "saute serveur (pas de curl)"
+fi
+
+if [ $bench -ne 0 ]; then
+    BOPT="--bench-sizes 256,1024 --bench-reps 5"
+    if [ $bench -eq 2 ]; then
+        if BENCH_DIR="$TEST_DIR" "$SRC/bench.sh" $BOPT > "$TEST_DIR/bench.json" &&
+                cp "$TEST_DIR/bench.json" "$BASELINE"; then
+            echo "maj   bench (tests/bench-baseline.json)"
+        else
+            echo "ECHEC bench"
+            fail=$((fail + 1))
+        fi
+    elif BENCH_DIR="$TEST_DIR" "$SRC/bench.sh" $BOPT --bench-baseline "$BASELINE" \
+            --bench-tolerance "$TEST_TOLERANCE" > "$TEST_DIR/bench.json"; then
+        echo "ok    bench (a $TEST_TOLERANCE % de tests/bench-baseline.json)"
+    else
+        echo "ECHEC bench : regression, voir $TEST_DIR/bench.json"
+        fail=$((fail + 1))
+    fi
+fi
+
+if [ $fail -ne 0 ]; then
+    echo "$fail echec(s), $n cas"
+    exit 1
+fi
+echo "tout est ok, $n cas"
+exit 0
@@ -0,0 +1,196 @@
+/*
+ * timing.h — temps par etape (--timings), mur et CPU, debit
+ * C ANSI C89, en-tete seul (fonctions static), partage par plasma.c,
+ * geo.c, iso.c et fractale.c.
+ *
+ * Chaque outil entoure ses etapes de tm_begin / tm_end. Noms d'etape
+ * communs : generate, resample, blur, normalise, gamma, flood, colour,
+ * parse, raster, write ; une etape executee plusieurs fois est cumulee.
+ * tm_end recoit le nombre de cellules traitees et les octets de grille lus
+ * ou ecrits, d'ou les debits cellules/s et Mo/s.
+ *
+ * Temps mur : clock_gettime(CLOCK_MONOTONIC) quand il existe, sinon clock().
+ * Temps CPU : clock(), cumule sur tous les threads du processus ; un
+ * rapport CPU/mur proche du nombre de threads indique une etape bien
+ * parallelisee.
+ *
+ * Desactive (mode TM_OFF), chaque appel se reduit a un test : aucun appel
+ * systeme. Le rapport va sur stderr, en tableau ou en JSON (une ligne).
+ * Avec --trace (trace.h), chaque etape devient aussi un evenement "stage".
+ * Avec --counters (counters.h), chaque etape cumule aussi les compteurs
+ * materiels (cycles, instructions, defauts de cache...) de tous les threads,
+ * affiches dans un second tableau ou dans le JSON de l'etape.
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "trace.h"
+#include "counters.h"
+
+#define TM_OFF    0
+#define TM_TABLE  1
+#define TM_JSON   2
+#define TM_STAGES 16
+
+#if defined(__GNUC__)
+#define TM_FN static __attribute__((unused))
+#else
+#define TM_FN static
+#endif
+
+typedef struct {
+    const char *name;
+    long calls;
+    double wall, cpu;          /* secondes cumulees */
+    double cells, bytes;
+    double ctr[CT_EVENTS];     /* compteurs cumules (--counters) */
+} TmStage;
+
+typedef struct {
+    int mode;
+    const char *tool;
+    double wall0, cpu0;        /* debut du programme */
+    double open_wall, open_cpu;
+    double open_ctr[CT_EVENTS];
+    int open;                  /* etape en cours, -1 si aucune */
+    int n;
+    TmStage st[TM_STAGES];
+} Timings;
+
+TM_FN double tm_wall(void) { return tr_wall(); }
+
+TM_FN double tm_cpu(void) { return (double)clock() / (double)CLOCKS_PER_SEC; }
+
+/* Reconnait --timings, --timings=table et --timings=json.
+   Retourne 1 si arg est l'option (mode renseigne), -1 si la valeur est
+   invalide, 0 sinon. */
+TM_FN int tm_parse(const char *arg, int *mode) {
+    if (strncmp(arg, "--timings", 9) != 0) return 0;
+    if (arg[9] == '\0' || strcmp(arg + 9, "=table") == 0) { *mode = TM_TABLE; return 1; }
+    if (strcmp(arg + 9, "=json") == 0) { *mode = TM_JSON; return 1; }
+    return (arg[9] == '=') ? -1 : 0;
+}
+
+TM_FN void tm_init(Timings *t, const char *tool, int mode) {
+    t->mode = mode;
+    t->tool = tool;
+    t->open = -1;
+    t->n = 0;
+    if (mode == TM_OFF && !TRACE.on) return;
+    t->wall0 = tm_wall();
+    t->cpu0 = tm_cpu();
+}
+
+/* Ouvre l'etape name (une seule etape ouverte a la fois) */
+TM_FN void tm_begin(Timings *t, const char *name) {
+    int i;
+    if (t->mode == TM_OFF && !TRACE.on) return;
+    for (i = 0; i < t->n; ++i) {
+        if (strcmp(t->st[i].name, name) == 0) break;
+    }
+    if (i == t->n) {
+        if (t->n >= TM_STAGES) { t->open = -1; return; }
+        t->st[i].name = name;
+        t->st[i].calls = 0;
+        t->st[i].wall = t->st[i].cpu = t->st[i].cells = t->st[i].bytes = 0.0;
+        memset(t->st[i].ctr, 0, sizeof(t->st[i].ctr));
+        t->n++;
+    }
+    t->open = i;
+    if (COUNTERS.on) ct_read(t->open_ctr);
+    t->open_cpu = tm_cpu();
+    t->open_wall = tm_wall();
+}
+
+/* Ferme l'etape ouverte ; cells cellules et bytes octets traites */
+TM_FN void tm_end(Timings *t, double cells, double bytes) {
+    TmStage *s;
+    double w;
+    if ((t->mode == TM_OFF && !TRACE.on) || t->open < 0) return;
+    w = tm_wall();
+    s = &t->st[t->open];
+    tr_end("stage", s->name, t->open_wall, (long)s->calls, (long)cells);
+    s->wall += w - t->open_wall;
+    s->cpu += tm_cpu() - t->open_cpu;
+    s->cells += cells;
+    s->bytes += bytes;
+    if (COUNTERS.on) {
+        double now[CT_EVENTS];
+        int e;
+        ct_read(now);
+        for (e = 0; e < CT_EVENTS; ++e) s->ctr[e] += now[e] - t->open_ctr[e];
+    }
+    s->calls++;
+    t->open = -1;
+}
+
+TM_FN double tm_rate(double n, double sec) { return (sec > 0.0) ? n / sec : 0.0; }
+
+/* Compteurs d'une etape : JSON, ou colonnes du second tableau */
+TM_FN void tm_report_counters(const TmStage *s, FILE *f, int json) {
+    int e;
+    if (json) {
+        int first = 1;
+        fprintf(f, ",\"counters\":{");
+        for (e = 0; e < CT_EVENTS; ++e) {
+            if (!COUNTERS.avail[e]) continue;
+            fprintf(f, "%s\"%s\":%.0f", first ? "" : ",", ct_names[e], s->ctr[e]);
+            first = 0;
+        }
+        if (COUNTERS.avail[0] && COUNTERS.avail[1] && s->ctr[0] > 0.0)
+            fprintf(f, "%s\"ipc\":%.3f", first ? "" : ",", s->ctr[1] / s->ctr[0]);
+        fprintf(f, "}");
+        return;
+    }
+    fprintf(f, "  %-10s", s->name);
+    for (e = 0; e < CT_EVENTS; ++e) {
+        if (COUNTERS.avail[e]) fprintf(f, " %12.0f", s->ctr[e]);
+        else fprintf(f, " %12s", "-");
+    }
+    if (COUNTERS.avail[0] && COUNTERS.avail[1] && s->ctr[0] > 0.0) fprintf(f, " %6.2f\n", s->ctr[1] / s->ctr[0]);
+    else fprintf(f, " %6s\n", "-");
+}
+
+/* Rapport sur f selon le mode */
+TM_FN void tm_report(const Timings *t, FILE *f) {
+    int i;
+    double wall, cpu;
+    if (t->mode == TM_OFF) return;
+    wall = tm_wall() - t->wall0;
+    cpu = tm_cpu() - t->cpu0;
+    if (t->mode == TM_JSON) {
+        fprintf(f, "{\"tool\":\"%s\",\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"stages\":[",
+                t->tool, 1e3 * wall, 1e3 * cpu);
+        for (i = 0; i < t->n; ++i) {
+            const TmStage *s = &t->st[i];
+            fprintf(f, "%s{\"stage\":\"%s\",\"calls\":%ld,\"wall_ms\":%.3f,\"cpu_ms\":%.3f,"
+                       "\"cells\":%.0f,\"cells_per_s\":%.0f,\"mb_per_s\":%.1f",
+                    i ? "," : "", s->name, s->calls, 1e3 * s->wall, 1e3 * s->cpu,
+                    s->cells, tm_rate(s->cells, s->wall), tm_rate(s->bytes / 1048576.0, s->wall));
+            if (COUNTERS.on) tm_report_counters(s, f, 1);
+            fprintf(f, "}");
+        }
+        fprintf(f, "]}\n");
+        return;
+    }
+    fprintf(f, "temps %s : %.1f ms mur, %.1f ms cpu\n", t->tool, 1e3 * wall, 1e3 * cpu);
+    fprintf(f, "  %-10s %10s %10s %6s %13s %10s\n",
+            "etape", "mur ms", "cpu ms", "%mur", "Mcellules/s", "Mo/s");
+    for (i = 0; i < t->n; ++i) {
+        const TmStage *s = &t->st[i];
+        fprintf(f, "  %-10s %10.1f %10.1f %6.1f %13.1f %10.1f\n", s->name,
+                1e3 * s->wall, 1e3 * s->cpu, (wall > 0.0) ? 100.0 * s->wall / wall : 0.0,
+                tm_rate(s->cells, s->wall) / 1e6, tm_rate(s->bytes / 1048576.0, s->wall));
+    }
+    if (!COUNTERS.on) return;
+    fprintf(f, "compteurs (%d thread%s, espace utilisateur)\n", COUNTERS.nthreads, COUNTERS.nthreads > 1 ? "s" : "");
+    fprintf(f, "  %-10s %12s %12s %12s %12s %12s %12s %6s\n", "etape",
+            "cycles", "instr.", "def. cache", "def. branch", "def. dTLB", "def. page", "IPC");
+    for (i = 0; i < t->n; ++i) tm_report_counters(&t->st[i], f, 0);
+}
+
+#endif /* TIMING_H */
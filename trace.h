@@ -0,0 +1,145 @@
+/*
+ * trace.h — evenements de trace (--trace out.json) au format Chrome
+ * C ANSI C89, en-tete seul (fonctions static), partage par plasma.c,
+ * geo.c, iso.c et fractale.c ; timing.h s'en sert pour les etapes.
+ *
+ * Chaque thread ecrit dans son propre tampon d'evenements, alloue par lui
+ * au premier evenement : pas de verrou ni d'operation atomique sur le
+ * chemin chaud, pas de faux partage (descripteurs sur 64 octets). Un
+ * tampon plein compte les evenements perdus au lieu de grossir.
+ *
+ * Evenements "X" (debut + duree, microsecondes) : cat "stage" pour les
+ * etapes (thread principal), "band" pour la bande de lignes d'un thread
+ * dans une boucle schedule(static), "tile" pour une tuile ou un bloc
+ * distribue dynamiquement. Le fichier est ecrit a la sortie du programme
+ * (atexit) et s'ouvre dans chrome://tracing ou ui.perfetto.dev.
+ *
+ * Sans --trace, tr_begin et tr_end se reduisent a un test.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define TR_THREADS 256         /* threads suivis au plus */
+#define TR_CAP     32768       /* evenements par thread */
+
+#if defined(__GNUC__)
+#define TR_FN static __attribute__((unused))
+#else
+#define TR_FN static
+#endif
+
+typedef struct {
+    const char *cat, *name;    /* chaines litterales */
+    double ts, dur;            /* secondes depuis tr_init */
+    long a0, a1;               /* premiere ligne / tuile, nombre */
+} TrEvent;
+
+typedef struct {
+    TrEvent *ev;
+    long n, dropped;
+    char pad[64 - sizeof(TrEvent*) - 2 * sizeof(long)];
+} TrBuf;
+
+typedef struct {
+    int on;
+    FILE *f;
+    const char *tool;
+    double t0;
+    TrBuf buf[TR_THREADS];
+} Trace;
+
+static Trace TRACE;
+
+TR_FN double tr_wall(void) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+#endif
+    return (double)clock() / (double)CLOCKS_PER_SEC;
+}
+
+TR_FN int tr_tid(void) {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+/* Debut d'un evenement (0 si la trace est inactive) */
+TR_FN double tr_begin(void) { return TRACE.on ? tr_wall() : 0.0; }
+
+/* Fin de l'evenement commence a t0, enregistre par le thread appelant */
+TR_FN void tr_end(const char *cat, const char *name, double t0, long a0, long a1) {
+    TrBuf *b;
+    TrEvent *e;
+    int tid;
+    if (!TRACE.on) return;
+    tid = tr_tid();
+    if (tid < 0 || tid >= TR_THREADS) return;
+    b = &TRACE.buf[tid];
+    if (!b->ev) {
+        b->ev = (TrEvent*)malloc(TR_CAP * sizeof(TrEvent));
+        if (!b->ev) { b->n = TR_CAP; }
+    }
+    if (b->n >= TR_CAP) { b->dropped++; return; }
+    e = &b->ev[b->n++];
+    e->cat = cat;
+    e->name = name;
+    e->ts = t0 - TRACE.t0;
+    e->dur = tr_wall() - t0;
+    e->a0 = a0;
+    e->a1 = a1;
+}
+
+/* Ecrit le fichier et libere les tampons (enregistre par atexit) */
+TR_FN void tr_flush(void) {
+    int t;
+    long i, lost = 0;
+    if (!TRACE.on) return;
+    TRACE.on = 0;
+    fprintf(TRACE.f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(TRACE.f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"%s\"}}",
+            TRACE.tool);
+    for (t = 0; t < TR_THREADS; ++t) {
+        TrBuf *b = &TRACE.buf[t];
+        lost += b->dropped;
+        if (!b->ev) continue;
+        fprintf(TRACE.f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                         "\"args\":{\"name\":\"thread %d\"}}", t, t);
+        for (i = 0; i < b->n; ++i) {
+            const TrEvent *e = &b->ev[i];
+            fprintf(TRACE.f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                             "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"first\":%ld,\"count\":%ld}}",
+                    e->name, e->cat, t, 1e6 * e->ts, 1e6 * e->dur, e->a0, e->a1);
+        }
+        free(b->ev);
+        b->ev = 0;
+    }
+    fprintf(TRACE.f, "\n]");
+    if (lost) fprintf(TRACE.f, ",\"otherData\":{\"dropped_events\":%ld}", lost);
+    fprintf(TRACE.f, "}\n");
+    if (fclose(TRACE.f) != 0) fprintf(stderr, "Erreur d'ecriture de la trace.\n");
+    if (lost) fprintf(stderr, "trace : %ld evenements perdus (tampons pleins).\n", lost);
+}
+
+/* Active la trace vers path. Retourne 0, ou -1 si le fichier ne s'ouvre pas. */
+TR_FN int tr_init(const char *path, const char *tool) {
+    TRACE.f = fopen(path, "w");
+    if (!TRACE.f) return -1;
+    TRACE.tool = tool;
+    TRACE.t0 = tr_wall();
+    TRACE.on = 1;
+    atexit(tr_flush);
+    return 0;
+}
+
+#endif /* TRACE_H */
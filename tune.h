@@ -0,0 +1,280 @@
+/*
+ * tune.h — profil de reglage par machine (fractale-tune.sh, --tune)
+ * C ANSI C89, en-tete seul (fonctions static), lu au demarrage par
+ * plasma.c, geo.c, fractale.c et serveur.c ; inclus aussi par fcore.h,
+ * fft.h et arena.h pour le decoupage des boucles de lignes.
+ *
+ * Le meilleur nombre de threads, la hauteur des bandes de lignes et la
+ * taille des tuiles de fractale dependent de la machine (caches, coeurs,
+ * bande passante). plasma --tune et fractale --tune mesurent leurs noyaux
+ * pour chaque reglage candidat et rangent le plus rapide dans le profil,
+ * un fichier texte "cle valeur" :
+ *
+ *   # fractale-tune 1
+ *   machine atelier/16      hote et processeurs logiques a la mesure
+ *   threads.rows 8          plasma, geo, serveur : boucles de lignes OpenMP
+ *   band 32                 lignes par bande (0 : H / threads, une par thread)
+ *   threads.escape 16       fractale
+ *   tile 64                 fractale : cote des tuiles du temps d'echappement
+ *
+ * Chemin : $FRACTALE_TUNE, sinon $HOME/.fractale-tune ; FRACTALE_TUNE vide
+ * desactive le profil. Un profil mesure sur une autre machine (hote ou
+ * nombre de processeurs differents, repertoire personnel partage) est
+ * ignore, avec un message. Les options explicites (-j) priment. Aucun
+ * reglage ne change les resultats, seulement leur duree.
+ */
+
+#ifndef TUNE_H
+#define TUNE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "trace.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define TN_POSIX 1
+#else
+#define TN_POSIX 0
+#endif
+
+#define TN_PATH 1024
+#define TN_KEYS 16
+#define TN_REPS 5                  /* mesures par reglage candidat (mediane) */
+#define TN_TIE 1.03                /* a 3 % pres, le reglage le plus simple */
+#define TN_SIDE 2048               /* cote des grilles et images mesurees */
+
+#if defined(__GNUC__)
+#define TN_FN static __attribute__((unused))
+#else
+#define TN_FN static
+#endif
+
+typedef struct {
+    int threads;               /* threads du profil pour l'outil, 0 : defaut */
+    int band;                  /* lignes par bande, 0 : H / threads */
+    int tile;                  /* tuiles de fractale, 0 : ESC_TILE */
+    int loaded;                /* profil lu et applique */
+} Tune;
+
+static Tune TUNE;
+
+/* Lignes par bande d'une boucle de n lignes, a appeler dans la region
+   parallele (omp for schedule(static, tn_rows(n))). Toutes les boucles
+   de lignes et la preparation des pages (arena.h) partagent ce decoupage. */
+TN_FN int tn_rows(long n) {
+    long t = 1;
+#ifdef _OPENMP
+    t = omp_get_num_threads();
+#endif
+    if (TUNE.band > 0) return TUNE.band;
+    n = (n + t - 1) / t;
+    return (n > 0) ? (int)n : 1;
+}
+
+/* Processeurs logiques de la machine, avec ou sans OpenMP : l'identifiant
+   du profil (tn_machine) doit etre le meme pour tous les binaires */
+TN_FN int tn_cpus(void) {
+#if TN_POSIX && defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) return (int)n;
+#endif
+#ifdef _OPENMP
+    return omp_get_num_procs();
+#else
+    return 1;
+#endif
+}
+
+/* Chemin du profil dans path ; 0 si le profil est desactive */
+TN_FN int tn_path(char *path) {
+    const char *e = getenv("FRACTALE_TUNE");
+    const char *home = getenv("HOME");
+    if (e) {
+        if (*e == '\0' || strlen(e) >= TN_PATH) return 0;
+        strcpy(path, e);
+        return 1;
+    }
+    if (!home || strlen(home) + 16 >= TN_PATH) return 0;
+    sprintf(path, "%s/.fractale-tune", home);
+    return 1;
+}
+
+/* Identifiant de la machine : hote/processeurs */
+TN_FN void tn_machine(char *id) {
+    char host[64];
+    strcpy(host, "?");
+#if TN_POSIX
+    if (gethostname(host, sizeof(host)) != 0) strcpy(host, "?");
+    host[sizeof(host) - 1] = '\0';
+#endif
+    sprintf(id, "%.63s/%d", host, tn_cpus());
+}
+
+/* Lit le profil : cles et valeurs dans keys/vals (au plus TN_KEYS).
+   Retourne leur nombre, 0 si le fichier manque, -1 s'il vient d'une
+   autre machine (machine recoit alors son identifiant). */
+TN_FN int tn_read(const char *path, char keys[][32], long *vals, char *machine) {
+    char line[256], k[32], v[80], id[96];
+    int n = 0, other = 0;
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    tn_machine(id);
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || sscanf(line, "%31s %79s", k, v) != 2) continue;
+        if (strcmp(k, "machine") == 0) {
+            if (strcmp(v, id) != 0) { strcpy(machine, v); other = 1; }
+        } else if (n < TN_KEYS) {
+            strcpy(keys[n], k);
+            vals[n++] = strtol(v, 0, 10);
+        }
+    }
+    fclose(f);
+    return other ? -1 : n;
+}
+
+/* Charge le profil pour tool et applique ses reglages : threads.escape
+   pour fractale, threads.rows pour les autres. A appeler avant la
+   lecture des options, pour que -j prime. */
+TN_FN void tn_init(const char *tool) {
+    char path[TN_PATH], keys[TN_KEYS][32], machine[80];
+    long vals[TN_KEYS];
+    const char *tkey = (strcmp(tool, "fractale") == 0) ? "threads.escape" : "threads.rows";
+    int k, n;
+    if (!tn_path(path)) return;
+    n = tn_read(path, keys, vals, machine);
+    if (n < 0) {
+        fprintf(stderr, "%s : profil %s mesure sur %s, ignore (relancer fractale-tune.sh).\n",
+                tool, path, machine);
+        return;
+    }
+    for (k = 0; k < n; ++k) {
+        if (vals[k] < 0 || vals[k] > 65536) continue;
+        if (strcmp(keys[k], tkey) == 0) TUNE.threads = (int)vals[k];
+        else if (strcmp(keys[k], "band") == 0) TUNE.band = (int)vals[k];
+        else if (strcmp(keys[k], "tile") == 0) TUNE.tile = (int)vals[k];
+    }
+#ifdef _OPENMP
+    if (TUNE.threads > 0) omp_set_num_threads(TUNE.threads);
+#endif
+    TUNE.loaded = n > 0;
+}
+
+/* Range key = val dans le profil, avec l'identifiant de cette machine ;
+   les autres cles d'un profil de la meme machine sont gardees. Ecriture
+   dans un fichier temporaire puis renommage. Retourne 0, ou -1. */
+TN_FN int tn_store(const char *key, long val) {
+    char path[TN_PATH], tmp[TN_PATH + 8], keys[TN_KEYS][32], machine[80], id[96];
+    long vals[TN_KEYS];
+    int k, n, ok;
+    FILE *f;
+    if (!tn_path(path)) {
+        fprintf(stderr, "tune : profil desactive (FRACTALE_TUNE vide ou HOME absent).\n");
+        return -1;
+    }
+    n = tn_read(path, keys, vals, machine);
+    if (n < 0) n = 0;                  /* autre machine : profil remplace */
+    for (k = 0; k < n && strcmp(keys[k], key) != 0; ++k) {}
+    if (k == n) {
+        if (n == TN_KEYS) return -1;
+        strcpy(keys[n++], key);
+    }
+    vals[k] = val;
+    tn_machine(id);
+    sprintf(tmp, "%s.tmp", path);
+    f = fopen(tmp, "w");
+    ok = f && fprintf(f, "# fractale-tune 1\nmachine %s\n", id) > 0;
+    for (k = 0; ok && k < n; ++k) ok = fprintf(f, "%s %ld\n", keys[k], vals[k]) > 0;
+    if (f && fclose(f) != 0) ok = 0;
+    if (ok) {
+#if !TN_POSIX
+        remove(path);
+#endif
+        ok = (rename(tmp, path) == 0);
+    }
+    if (!ok) {
+        if (f) remove(tmp);
+        fprintf(stderr, "tune : ecriture impossible de %s.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/* Duree mediane (s) de fn(ctx) : une execution de chauffe, TN_REPS
+   mesurees, temps mur */
+TN_FN double tn_time(void (*fn)(void *), void *ctx) {
+    double t[TN_REPS], v;
+    int r, j;
+    fn(ctx);
+    for (r = 0; r < TN_REPS; ++r) {
+        double w = tr_wall();
+        fn(ctx);
+        t[r] = tr_wall() - w;
+    }
+    for (r = 1; r < TN_REPS; ++r) {
+        v = t[r];
+        for (j = r; j > 0 && t[j - 1] > v; --j) t[j] = t[j - 1];
+        t[j] = v;
+    }
+    return t[TN_REPS / 2];
+}
+
+/* Nombres de threads candidats : 1, 2, 4... et tous les processeurs
+   (1 seul sans OpenMP). Retourne leur nombre (au plus 16). */
+TN_FN int tn_thread_list(int *list) {
+    int n = 0, t, p = 1;
+#ifdef _OPENMP
+    p = tn_cpus();
+#endif
+    for (t = 1; t < p && n < 15; t *= 2) list[n++] = t;
+    list[n++] = p;
+    return n;
+}
+
+/* Indice du reglage retenu parmi n mesures t[] rangees du plus simple au
+   plus couteux : le premier a TN_TIE du meilleur */
+TN_FN int tn_pick(const double *t, int n) {
+    int k, best = 0;
+    for (k = 1; k < n; ++k) if (t[k] < t[best]) best = k;
+    for (k = 0; k < best && t[k] > TN_TIE * t[best]; ++k) {}
+    return k;
+}
+
+/* Mesure fn(ctx) pour chaque nombre de threads de tn_thread_list, garde
+   le retenu (omp_set_num_threads) et le retourne. Progression sur stderr. */
+TN_FN int tn_tune_threads(const char *tool, void (*fn)(void *), void *ctx) {
+    int list[16], n = tn_thread_list(list), k;
+    double t[16];
+    for (k = 0; k < n; ++k) {
+#ifdef _OPENMP
+        omp_set_num_threads(list[k]);
+#endif
+        t[k] = tn_time(fn, ctx);
+        fprintf(stderr, "%s : %2d threads   %9.3f ms\n", tool, list[k], 1e3 * t[k]);
+    }
+    k = tn_pick(t, n);
+#ifdef _OPENMP
+    omp_set_num_threads(list[k]);
+#endif
+    return list[k];
+}
+
+/* Meme chose pour un reglage entier *v (TUNE.band, TUNE.tile) parmi
+   les n valeurs cand[], du plus simple au plus couteux */
+TN_FN int tn_tune_int(const char *tool, const char *key, int *v, const int *cand, int n,
+                      void (*fn)(void *), void *ctx) {
+    double t[16];
+    int k;
+    for (k = 0; k < n && k < 16; ++k) {
+        *v = cand[k];
+        t[k] = tn_time(fn, ctx);
+        fprintf(stderr, "%s : %s %-5d  %9.3f ms\n", tool, key, cand[k], 1e3 * t[k]);
+    }
+    *v = cand[tn_pick(t, k)];
+    return *v;
+}
+
+#endif /* TUNE_H */